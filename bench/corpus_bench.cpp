@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+
+#include <iostream>
+#include <streambuf>
+
+#include <driver.h>
+
+#include "programs.h"
+
+using namespace draft;
+
+namespace {
+
+// Swallows what a program prints while it is timed
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+    std::streamsize xsputn(const char *, std::streamsize count) override
+    {
+        return count;
+    }
+};
+
+// The program runs through Driver as `draft` would run it, from the lexer to the engine
+void BM_Corpus(benchmark::State &state, std::string_view name, Driver::Engine engine)
+{
+    const std::string text = bench::program(name);
+    Driver::Options options;
+    options.engine = engine;
+    Driver::configure(options);
+
+    NullBuffer null;
+    std::streambuf *previous = std::cout.rdbuf(&null);
+    for (auto _ : state) {
+        Driver::run(text);
+    }
+    std::cout.rdbuf(previous);
+    Driver::configure(Driver::Options{});
+}
+
+// Each program of the corpus on both engines, named like "BM_Corpus/fib/vm"
+const bool registered = [] {
+    for (std::string_view name : bench::corpus) {
+        for (auto [engine, suffix] : {std::pair{Driver::Engine::TreeWalker, "tree"}, std::pair{Driver::Engine::VM, "vm"}}) {
+            std::string benchmark = "BM_Corpus/" + std::string{name} + "/" + suffix;
+            benchmark::RegisterBenchmark(benchmark.c_str(), BM_Corpus, name, engine)->Unit(benchmark::kMillisecond);
+        }
+    }
+    return true;
+}();
+
+}  // namespace
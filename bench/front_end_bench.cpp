@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include <lexer.h>
+#include <parser.h>
+#include <resolver.h>
+
+#include "programs.h"
+
+using namespace draft;
+
+namespace {
+
+void BM_LexerScanTokens(benchmark::State &state)
+{
+    const std::string text = bench::corpusText();
+    for (auto _ : state) {
+        Lexer lexer{text};
+        benchmark::DoNotOptimize(lexer.scanTokens());
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_LexerScanTokens);
+
+void BM_ParserParse(benchmark::State &state)
+{
+    const std::string text = bench::corpusText();
+    Lexer lexer{text};
+    const std::vector<Token> tokens = lexer.scanTokens();
+    for (auto _ : state) {
+        Parser parser{tokens};
+        benchmark::DoNotOptimize(parser.parse());
+    }
+    state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+BENCHMARK(BM_ParserParse);
+
+void BM_ResolverResolve(benchmark::State &state)
+{
+    const std::string text = bench::corpusText();
+    Lexer lexer{text};
+    const std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser{tokens};
+    const std::vector<Stmt *> statements = parser.parse();
+    for (auto _ : state) {
+        Resolver resolver;
+        resolver.resolve(statements);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * statements.size());
+}
+BENCHMARK(BM_ResolverResolve);
+
+}  // namespace
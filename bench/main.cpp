@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <vector>
+
+// Results are reported as JSON unless another format is asked for, so they can be collected per
+// commit; the build configuration the numbers came from goes into the context
+int main(int argc, char **argv)
+{
+    std::vector<char *> arguments{argv, argv + argc};
+    bool formatted = false;
+    for (char *argument : arguments) {
+        formatted = formatted or std::strncmp(argument, "--benchmark_format=", 19) == 0;
+    }
+    char json[] = "--benchmark_format=json";
+    if (!formatted) {
+        arguments.push_back(json);
+    }
+    int count = static_cast<int>(arguments.size());
+    benchmark::Initialize(&count, arguments.data());
+    if (benchmark::ReportUnrecognizedArguments(count, arguments.data())) {
+        return 1;
+    }
+
+    benchmark::AddCustomContext("draft_build_type", DRAFT_BUILD_TYPE);
+#ifdef DRAFT_NAN_BOXING
+    benchmark::AddCustomContext("draft_nan_boxing", "on");
+#else
+    benchmark::AddCustomContext("draft_nan_boxing", "off");
+#endif
+#ifdef DRAFT_JIT
+    benchmark::AddCustomContext("draft_jit", "on");
+#else
+    benchmark::AddCustomContext("draft_jit", "off");
+#endif
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "programs.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#include <driver.h>
+
+namespace draft::bench {
+
+std::string program(std::string_view name)
+{
+    std::string path = std::string{DRAFT_BENCH_PROGRAMS} + "/" + std::string{name} + ".lox";
+    std::ifstream file{path, std::ios::binary};
+    if (file.fail()) {
+        throw std::runtime_error{"Can't read file: " + path};
+    }
+    std::string text;
+    io::read(text, file);
+    return text;
+}
+
+std::string corpusText()
+{
+    std::string text;
+    for (std::string_view name : corpus) {
+        text += program(name);
+    }
+    return text;
+}
+
+}  // namespace draft::bench
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace draft::bench {
+
+// The classic programs under bench/programs, which the corpus runs end to end
+inline const std::vector<std::string_view> corpus = {
+    "binary_trees",
+    "fib",
+    "method_call",
+    "string_concat",
+    "zoo",
+};
+
+// Text of the program called `name`
+std::string program(std::string_view name);
+
+// Every program of the corpus one after another, as input for the front-end benchmarks
+std::string corpusText();
+
+}  // namespace draft::bench
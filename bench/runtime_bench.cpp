@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+
+#include <environment.h>
+#include <interpreter.h>
+#include <lexer.h>
+#include <obj_class.h>
+#include <obj_instance.h>
+#include <parser.h>
+#include <resolver.h>
+
+using namespace draft;
+
+namespace {
+
+constexpr std::size_t SlotsPerEnvironment = 8;
+
+// Reads the last slot of an environment `state.range(0)` levels up the chain
+void BM_EnvironmentGetAt(benchmark::State &state)
+{
+    auto depth = static_cast<int>(state.range(0));
+    EnvironmentPtr env = std::make_shared<Environment>();
+    for (int i = 0; i <= depth; i++) {
+        env = std::make_shared<Environment>(env);
+        for (std::size_t slot = 0; slot < SlotsPerEnvironment; slot++) {
+            env->define(object::Number(slot));
+        }
+    }
+    Slot slot{depth, SlotsPerEnvironment - 1};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(env->getAt(slot));
+    }
+}
+BENCHMARK(BM_EnvironmentGetAt)->DenseRange(0, 3);
+
+void BM_EnvironmentGlobal(benchmark::State &state)
+{
+    Environment globals;
+    for (std::size_t i = 0; i < SlotsPerEnvironment; i++) {
+        globals.define("global" + std::to_string(i), object::Number(i));
+    }
+    Lexer lexer{"global7"};
+    Token name = lexer.next();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(globals.get(name));
+    }
+}
+BENCHMARK(BM_EnvironmentGlobal);
+
+// A parsed class with a field and a method, the statements outliving the objects made from them
+class ClassFixture : public benchmark::Fixture {
+public:
+    void SetUp(const benchmark::State &) override
+    {
+        Lexer lexer{"class Point { init() { this.x = 1; } x() { return this.x; } }"};
+        tokens = lexer.scanTokens();
+        parser = std::make_unique<Parser>(tokens);
+        auto declaration = static_cast<draft::Class *>(parser->parse().front());
+        object::Class::MethodTable methods;
+        for (FuncStmt *method : declaration->methods) {
+            methods.emplace(method->name.lexeme, std::make_shared<object::Function>(method, nullptr));
+        }
+        klass = std::make_shared<object::Class>("Point", nullptr, std::move(methods));
+        instance = std::make_shared<object::Instance>(klass);
+        instance->setProperty("y", object::Number(2));
+    }
+
+    void TearDown(const benchmark::State &) override
+    {
+        instance.reset();
+        klass.reset();
+        parser.reset();
+    }
+
+    std::vector<Token> tokens;
+    std::unique_ptr<Parser> parser;
+    object::ClassPtr klass;
+    object::InstancePtr instance;
+};
+
+BENCHMARK_F(ClassFixture, BM_InstanceField)(benchmark::State &state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(instance->getProperty("y"));
+    }
+}
+
+// Getting a method as a value binds it to the instance
+BENCHMARK_F(ClassFixture, BM_InstanceBoundMethod)(benchmark::State &state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(instance->getProperty("x"));
+    }
+}
+
+BENCHMARK_F(ClassFixture, BM_InstanceFindMethod)(benchmark::State &state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(instance->findMethod("x"));
+    }
+}
+
+// Calls made by the tree-walker, `state.range(0)` per iteration
+void BM_InterpreterMethodCall(benchmark::State &state)
+{
+    std::string code = "class Counter { init() { this.n = 0; } up() { this.n = this.n + 1; } }"
+                       "var counter = Counter();"
+                       "for (var i = 0; i < " + std::to_string(state.range(0)) + "; i = i + 1) counter.up();";
+    Lexer lexer{code};
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser{tokens};
+    std::vector<Stmt *> statements = parser.parse();
+    Resolver resolver;
+    resolver.resolve(statements);
+    Interpreter interpreter;
+    for (auto _ : state) {
+        interpreter.interpret(statements);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InterpreterMethodCall)->Arg(1000);
+
+}  // namespace
@@ -6,4 +6,14 @@ FetchContent_Declare(
 )
 FetchContent_MakeAvailable(googletest)
 
-
+# Google Benchmark for draft-bench. An installed copy is used when there is one
+find_package(benchmark QUIET)
+if(NOT benchmark_FOUND)
+    set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+    FetchContent_Declare(
+        benchmark
+        URL https://github.com/google/benchmark/archive/refs/tags/v1.8.3.tar.gz
+    )
+    FetchContent_MakeAvailable(benchmark)
+endif()
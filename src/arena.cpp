@@ -1,59 +1,155 @@
 #include "arena.h"
 
-#include <cstdint>
+#include <algorithm>
 #include <cstdlib>
 
 namespace draft::memory {
 
-Block::Block()
+// Header at the start of every block, a single allocation with the memory it hands out
+struct Arena::Block {
+    Block *next = nullptr;
+    std::size_t size = 0;
+
+    std::byte *data()
+    {
+        return reinterpret_cast<std::byte *>(this + 1);
+    }
+};
+
+struct Arena::Finalizer {
+    void (*destroy)(void *) = nullptr;
+    void *object = nullptr;
+    Finalizer *next = nullptr;
+};
+
+Arena::~Arena()
 {
-    data = reinterpret_cast<std::byte *>(std::malloc(BlockSize));
-    ptr = data;
+    finalize();
+    release(blocks);
+    release(large);
 }
 
-Block::~Block()
+void Arena::reset()
 {
-    std::free(data);
+    finalize();
+    release(large);
+    statistics.largeObjects = 0;
+    if (blocks) {
+        release(blocks->next);
+        ptr = blocks->data();
+        end = ptr + blocks->size;
+    }
+    statistics.bytesAllocated = 0;
 }
 
-std::byte *Block::aligned()
+Arena::Mark Arena::mark() const
 {
-    return reinterpret_cast<std::byte *>((std::intptr_t(ptr) + 7) & ~7);
+    return Mark{ptr, blocks, large, finalizers, statistics.bytesAllocated};
 }
 
-Arena::~Arena()
+void Arena::rewind(const Mark &mark)
 {
-    for (auto &&block : blocks) {
-        delete block;
+    while (finalizers != mark.finalizers) {
+        Finalizer *finalizer = finalizers;
+        finalizers = finalizer->next;
+        finalizer->destroy(finalizer->object);
+        statistics.destructors--;
+    }
+    while (large != mark.large) {
+        Block *block = large;
+        release(large, block->next);
+        statistics.largeObjects--;
     }
-    blocks.clear();
+    release(blocks, mark.blocks);
+    ptr = mark.ptr;
+    end = blocks ? blocks->data() + blocks->size : nullptr;
+    statistics.bytesAllocated = mark.bytesAllocated;
 }
 
-void *Arena::allocate(std::size_t size)
+const Arena::Stats &Arena::stats() const
 {
-    if (!blocks.empty()) {
-        auto block = blocks.back();
-        block->ptr = block->aligned();
-        void *addr = block->ptr;
-        block->ptr += size;
-        if (block->ptr < block->data + Block::BlockSize) {
-            return addr;
-        }
+    return statistics;
+}
+
+void *Arena::grow(std::size_t size, std::size_t alignment)
+{
+    // A request that would waste most of a fresh block gets one of its own, leaving the current
+    // block to go on serving small ones
+    std::size_t padded = size + alignment - 1;
+    if (padded > nextBlockSize / 4) {
+        Block *block = newBlock(padded);
+        block->next = large;
+        large = block;
+        statistics.largeObjects++;
+        statistics.bytesAllocated += size;
+        auto start = (reinterpret_cast<std::uintptr_t>(block->data()) + alignment - 1) & ~(alignment - 1);
+        return reinterpret_cast<void *>(start);
     }
-    blocks.emplace_back(new Block{});
-    return allocate(size);
+
+    Block *block = newBlock(nextBlockSize);
+    block->next = blocks;
+    blocks = block;
+    ptr = block->data();
+    end = ptr + block->size;
+    nextBlockSize = std::min(nextBlockSize * 2, MaxBlockSize);
+    return bump(size, alignment);
 }
 
-void *Object::operator new(std::size_t size, Arena *pool)
+Arena::Block *Arena::newBlock(std::size_t size)
 {
-    return pool->allocate(size);
+    void *memory = std::malloc(sizeof(Block) + size);
+    if (!memory) {
+        throw std::bad_alloc{};
+    }
+    statistics.blocks++;
+    statistics.bytesReserved += size;
+    return ::new (memory) Block{nullptr, size};
 }
 
-void Object::operator delete(void *)
+void Arena::adopt(void *object, void (*destroy)(void *))
+{
+    auto finalizer = ::new (bump(sizeof(Finalizer), alignof(Finalizer))) Finalizer{destroy, object, finalizers};
+    finalizers = finalizer;
+    statistics.destructors++;
+}
+
+void Arena::finalize()
+{
+    while (finalizers) {
+        Finalizer *finalizer = finalizers;
+        finalizers = finalizer->next;
+        finalizer->destroy(finalizer->object);
+    }
+    statistics.destructors = 0;
+}
+
+void Arena::release(Block *&list, const void *until)
+{
+    while (list != until) {
+        Block *block = list;
+        list = block->next;
+        statistics.blocks--;
+        statistics.bytesReserved -= block->size;
+        std::free(block);
+    }
+}
+
+void *Arena::do_allocate(std::size_t size, std::size_t alignment)
+{
+    return bump(size, alignment);
+}
+
+void Arena::do_deallocate(void *, std::size_t, std::size_t)
 {
+    // Memory is only ever reclaimed all at once
 }
 
-void Object::operator delete(void *, Arena *)
+bool Arena::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
+
+void Object::operator delete(void *)
 {
 }
 
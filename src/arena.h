@@ -1,48 +1,121 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace draft::memory {
 
-class Block {
+// Bump allocator for objects that share one lifetime, such as the nodes of an AST. Memory comes
+// from blocks that double in size up to MaxBlockSize; requests too big for that are given a block
+// of their own. Objects with a non-trivial destructor are registered when made and destroyed, newest
+// first, by reset() or by the arena's destructor. The arena is also a memory resource, so std::pmr
+// containers inside those objects allocate from it too
+class Arena : public std::pmr::memory_resource {
 public:
-    Block();
-    ~Block();
+    struct Stats {
+        // Blocks currently held, dedicated ones included
+        std::size_t blocks = 0;
+        std::size_t largeObjects = 0;
+        // Bytes obtained for the blocks and bytes handed out from them
+        std::size_t bytesReserved = 0;
+        std::size_t bytesAllocated = 0;
+        // Objects whose destructor runs on reset
+        std::size_t destructors = 0;
+    };
 
-    std::byte *aligned();
+    // Where the arena stood at some point, to be rewound to
+    struct Mark {
+        std::byte *ptr = nullptr;
+        const void *blocks = nullptr;
+        const void *large = nullptr;
+        const void *finalizers = nullptr;
+        std::size_t bytesAllocated = 0;
+    };
 
-    std::byte *data = nullptr;
-    std::byte *ptr = nullptr;
+    static constexpr std::size_t InitialBlockSize = 8 * 1024;
+    static constexpr std::size_t MaxBlockSize = 1024 * 1024;
 
-    static constexpr std::size_t BlockSize = 8 * 1024;
+    Arena() = default;
+    ~Arena() override;
 
-private:
-    Block(const Block &) = delete;
-    Block &operator=(const Block &) = delete;
-};
+    template <typename T, typename... Args>
+    T *make(Args &&...args)
+    {
+        // Constructors are preferred to list initialization, which would turn make<std::string>(3, 'x')
+        // into "\3x"; aggregates have none
+        void *memory = bump(sizeof(T), alignof(T));
+        T *object = nullptr;
+        if constexpr (std::is_constructible_v<T, Args...>) {
+            object = ::new (memory) T(std::forward<Args>(args)...);
+        } else {
+            object = ::new (memory) T{std::forward<Args>(args)...};
+        }
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            adopt(object, [](void *object) { static_cast<T *>(object)->~T(); });
+        }
+        return object;
+    }
 
-class Arena {
-public:
-    Arena() = default;
-    ~Arena();
+    // Destroys every object and releases every block except the newest, which is kept for reuse
+    void reset();
 
-    void *allocate(std::size_t size);
+    Mark mark() const;
+    // Destroys the objects made since `mark` and releases the blocks obtained since. Marks taken
+    // after it are no longer valid
+    void rewind(const Mark &mark);
+
+    const Stats &stats() const;
 
 private:
+    struct Block;
+    struct Finalizer;
+
     Arena(const Arena &other) = delete;
     Arena &operator=(const Arena &other) = delete;
 
-    std::vector<Block *> blocks;
+    void *bump(std::size_t size, std::size_t alignment)
+    {
+        auto start = (reinterpret_cast<std::uintptr_t>(ptr) + alignment - 1) & ~(alignment - 1);
+        if (ptr and start + size <= reinterpret_cast<std::uintptr_t>(end)) {
+            ptr = reinterpret_cast<std::byte *>(start + size);
+            statistics.bytesAllocated += size;
+            return reinterpret_cast<void *>(start);
+        }
+        return grow(size, alignment);
+    }
+    void *grow(std::size_t size, std::size_t alignment);
+    Block *newBlock(std::size_t size);
+    void adopt(void *object, void (*destroy)(void *));
+    void finalize();
+    // Releases the blocks from the head of `list` up to `until`, the whole list by default
+    void release(Block *&list, const void *until = nullptr);
+
+    void *do_allocate(std::size_t size, std::size_t alignment) override;
+    void do_deallocate(void *, std::size_t, std::size_t) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+    std::byte *ptr = nullptr;
+    std::byte *end = nullptr;
+    // The newest block comes first in each list
+    Block *blocks = nullptr;
+    Block *large = nullptr;
+    Finalizer *finalizers = nullptr;
+    std::size_t nextBlockSize = InitialBlockSize;
+    Stats statistics;
 };
 
+// Base of the objects made by an Arena, which alone owns their memory
 class Object {
 public:
     Object() = default;
     virtual ~Object() = default;
 
-    void *operator new(std::size_t size, Arena *pool);
+    void *operator new(std::size_t size) = delete;
     void operator delete(void *);
-    void operator delete(void *, Arena *);
 
 private:
     Object(const Object &other) = delete;
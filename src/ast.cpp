@@ -3,7 +3,7 @@
 namespace draft {
 
 Literal::Literal(object::Object value)
-    : value{value}
+    : value{std::move(value)}
 {
 }
 
@@ -73,35 +73,50 @@ Var::Var(Token name, Expr *initializer)
 {
 }
 
-Block::Block(const std::vector<Stmt *> &statements)
-    : statements{statements}
+Block::Block(AstList<Stmt *> statements)
+    : statements{std::move(statements)}
 {
+    for (Stmt *statement : this->statements) {
+        if (dynamic_cast<Var *>(statement) or dynamic_cast<FuncStmt *>(statement) or dynamic_cast<Class *>(statement)) {
+            scoped = true;
+            break;
+        }
+    }
 }
 
-Class::Class(Token name, Variable *superclass, std::vector<FuncStmt *> methods)
+Class::Class(Token name, Variable *superclass, AstList<FuncStmt *> methods)
     : name{name}
     , superclass{superclass}
-    , methods{methods}
+    , methods{std::move(methods)}
 {
 }
 
-Call::Call(Expr *callee, Token paren, std::vector<Expr *> arguments)
+Call::Call(Expr *callee, Token paren, AstList<Expr *> arguments)
     : callee{callee}
     , paren{paren}
-    , arguments{arguments}
+    , arguments{std::move(arguments)}
+    , method{dynamic_cast<Get *>(callee)}
+    , superMethod{dynamic_cast<Super *>(callee)}
 {
 }
 
-FuncStmt::FuncStmt(Token name, std::vector<Token> params, std::vector<Stmt *> body)
+FuncStmt::FuncStmt(Token name, AstList<Token> params, AstList<Stmt *> body)
     : name{name}
-    , params{params}
-    , body{body}
+    , params{std::move(params)}
+    , body{std::move(body)}
 {
 }
 
 Return::Return(Token keyword, Expr *value)
     : keyword{keyword}
     , value{value}
+    , tailCall{dynamic_cast<Call *>(value)}
+{
+}
+
+Yield::Yield(Token keyword, Expr *value)
+    : keyword{keyword}
+    , value{value}
 {
 }
 
@@ -129,4 +144,32 @@ This::This(Token keyword)
 {
 }
 
+ListExpr::ListExpr(Token bracket, AstList<Expr *> elements)
+    : bracket{bracket}
+    , elements{std::move(elements)}
+{
+}
+
+MapExpr::MapExpr(Token brace, AstList<Expr *> keys, AstList<Expr *> values)
+    : brace{brace}
+    , keys{std::move(keys)}
+    , values{std::move(values)}
+{
+}
+
+GetIndex::GetIndex(Expr *object, Token bracket, Expr *index)
+    : object{object}
+    , bracket{bracket}
+    , index{index}
+{
+}
+
+SetIndex::SetIndex(Expr *object, Token bracket, Expr *index, Expr *value)
+    : object{object}
+    , bracket{bracket}
+    , index{index}
+    , value{value}
+{
+}
+
 }  // namespace draft
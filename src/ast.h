@@ -1,11 +1,19 @@
 #pragma once
 
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
 #include "arena.h"
 #include "object.h"
 #include "token.h"
 
 namespace draft {
 
+namespace jit {
+class Code;
+}  // namespace jit
+
 class Expr;
 class Literal;
 class Logical;
@@ -19,6 +27,10 @@ class Get;
 class Set;
 class Super;
 class This;
+class ListExpr;
+class MapExpr;
+class GetIndex;
+class SetIndex;
 
 class Stmt;
 class ExprStmt;
@@ -27,10 +39,27 @@ class If;
 class Print;
 class Return;
 class While;
+class Yield;
 class Block;
 class Class;
 class Var;
 
+// Lists held by AST nodes allocate from the parser's arena, like the nodes themselves
+template <typename T>
+using AstList = std::pmr::vector<T>;
+
+// Where the Resolver found a local variable: how many environments up the chain, and which slot
+// of that environment holds it. Unresolved names are globals
+struct Slot {
+    int depth = -1;
+    std::size_t index = 0;
+
+    bool isLocal() const
+    {
+        return depth >= 0;
+    }
+};
+
 template <typename T>
 class IExprVisitor {
 public:
@@ -47,12 +76,17 @@ public:
     virtual T visit(Set *) = 0;
     virtual T visit(Super *) = 0;
     virtual T visit(This *) = 0;
+    virtual T visit(ListExpr *) = 0;
+    virtual T visit(MapExpr *) = 0;
+    virtual T visit(GetIndex *) = 0;
+    virtual T visit(SetIndex *) = 0;
 };
 
 class Expr : public memory::Object {
 public:
     virtual std::string accept(IExprVisitor<std::string> *visitor) = 0;
     virtual object::Object accept(IExprVisitor<object::Object> *visitor) = 0;
+    virtual Expr *accept(IExprVisitor<Expr *> *visitor) = 0;
 };
 
 template <typename T>
@@ -66,6 +100,10 @@ public:
     {
         return visitor->visit(static_cast<T *>(this));
     }
+    Expr *accept(IExprVisitor<Expr *> *visitor) override
+    {
+        return visitor->visit(static_cast<T *>(this));
+    }
 };
 
 class Literal : public ExprBase<Literal> {
@@ -94,19 +132,29 @@ public:
 
 class Binary : public ExprBase<Binary> {
 public:
+    // Operand types the Interpreter has seen. After the first evaluation a node whose operands were
+    // both numbers, or both strings for +, is quickened to a path with a single type guard; any
+    // other types, then or later, leave it on the generic path for good
+    enum class Feedback : std::uint8_t { Unseen, Numbers, Strings, Generic };
+
     Binary(Expr *left, Token op, Expr *right);
 
     Expr *left = nullptr;
     Token op;
     Expr *right = nullptr;
+    Feedback feedback = Feedback::Unseen;
 };
 
 class Call : public ExprBase<Call> {
 public:
-    Call(Expr *callee, Token paren, std::vector<Expr *> arguments);
+    Call(Expr *callee, Token paren, AstList<Expr *> arguments);
     Expr *callee = nullptr;
     Token paren;
-    std::vector<Expr *> arguments;
+    AstList<Expr *> arguments;
+    // Set when the callee is obj.name or super.name, so the method can be invoked on its receiver
+    // without creating a bound method first
+    Get *method = nullptr;
+    Super *superMethod = nullptr;
 };
 
 class Grouping : public ExprBase<Grouping> {
@@ -121,14 +169,21 @@ public:
     explicit Variable(Token name);
 
     Token name;
+    Slot slot;
 };
 
 class Assign : public ExprBase<Assign> {
 public:
+    // Settled by the Interpreter on first evaluation: `x = x + c` and `x = x - c`, x being a local
+    // variable and c a number, step the variable in place while it holds a number
+    enum class Shape : std::uint8_t { Unseen, Generic, Step };
+
     Assign(Token name, Expr *value);
 
     Token name;
     Expr *value = nullptr;
+    Slot slot;
+    Shape shape = Shape::Unseen;
 };
 
 class Get : public ExprBase<Get> {
@@ -154,11 +209,65 @@ public:
 
     Token keyword;
     Token method;
+    Slot slot;
 };
+
 class This : public ExprBase<This> {
 public:
     explicit This(Token keyword);
+
     Token keyword;
+    Slot slot;
+};
+
+// A list literal, [a, b, c]
+class ListExpr : public ExprBase<ListExpr> {
+public:
+    ListExpr(Token bracket, AstList<Expr *> elements);
+
+    Token bracket;
+    AstList<Expr *> elements;
+};
+
+// A map literal, {key: value, ...}; keys[i] goes with values[i]
+class MapExpr : public ExprBase<MapExpr> {
+public:
+    MapExpr(Token brace, AstList<Expr *> keys, AstList<Expr *> values);
+
+    Token brace;
+    AstList<Expr *> keys;
+    AstList<Expr *> values;
+};
+
+// Settled by the Interpreter on first evaluation of an index node: a literal index is used in place
+// and its hash as a map key computed once
+struct IndexShape {
+    enum class Kind : std::uint8_t { Unseen, Generic, Constant };
+
+    Kind kind = Kind::Unseen;
+    std::size_t hash = 0;
+};
+
+// Indexes a list by position or a map by key
+class GetIndex : public ExprBase<GetIndex> {
+public:
+    GetIndex(Expr *object, Token bracket, Expr *index);
+
+    Expr *object = nullptr;
+    Token bracket;
+    Expr *index = nullptr;
+    IndexShape shape;
+};
+
+class SetIndex : public ExprBase<SetIndex> {
+public:
+    SetIndex(Expr *object, Token bracket, Expr *index, Expr *value);
+
+    Expr *object = nullptr;
+    Token bracket;
+    Expr *index = nullptr;
+    Expr *value = nullptr;
+    IndexShape shape;
 };
 
 template <typename T>
@@ -171,6 +280,7 @@ public:
     virtual T visit(Print *) = 0;
     virtual T visit(Return *) = 0;
     virtual T visit(While *) = 0;
+    virtual T visit(Yield *) = 0;
     virtual T visit(Block *) = 0;
     virtual T visit(Class *) = 0;
     virtual T visit(Var *) = 0;
@@ -180,6 +290,7 @@ class Stmt : public memory::Object {
 public:
     virtual std::string accept(IStmtVisitor<std::string> *visitor) = 0;
     virtual void accept(IStmtVisitor<void> *visitor) = 0;
+    virtual Stmt *accept(IStmtVisitor<Stmt *> *visitor) = 0;
 };
 
 template <typename T>
@@ -193,6 +304,10 @@ public:
     {
         return visitor->visit(static_cast<T *>(this));
     }
+    Stmt *accept(IStmtVisitor<Stmt *> *visitor) override
+    {
+        return visitor->visit(static_cast<T *>(this));
+    }
 };
 
 class ExprStmt : public StmtBase<ExprStmt> {
@@ -213,11 +328,18 @@ public:
 
 class FuncStmt : public StmtBase<FuncStmt> {
 public:
-    FuncStmt(Token name, std::vector<Token> params, std::vector<Stmt *> body);
+    FuncStmt(Token name, AstList<Token> params, AstList<Stmt *> body);
 
     Token name;
-    std::vector<Token> params;
-    std::vector<Stmt *> body;
+    AstList<Token> params;
+    AstList<Stmt *> body;
+    // Set by the Resolver when the body yields: a call then makes a Coroutine of the body rather
+    // than running it
+    bool generator = false;
+    // Native code made by jit::Compiler once the function is hot, released with the tree. `compiled`
+    // is set from the first attempt on, so a function the compiler rejects is not tried again
+    std::shared_ptr<const jit::Code> code;
+    bool compiled = false;
 };
 
 class Print : public StmtBase<Print> {
@@ -232,30 +354,51 @@ public:
     Return(Token keyword, Expr *value);
     Token keyword;
     Expr *value = nullptr;
+    // Set when the value is a call, which is then a tail call: it replaces the returning call
+    // instead of running inside it
+    Call *tailCall = nullptr;
 };
 
 class While : public StmtBase<While> {
 public:
+    // Settled by the Interpreter the first time the loop runs. A condition comparing a local
+    // variable to another or to a number tests the variables in place, their slots being looked
+    // up once per run of the loop rather than on every iteration
+    enum class Shape : std::uint8_t { Unseen, Generic, Compare };
+
     While(Expr *condition, Stmt *body);
 
     Expr *condition = nullptr;
     Stmt *body = nullptr;
+    Shape shape = Shape::Unseen;
+};
+
+// Suspends the Coroutine running the function, handing `value` to whatever resumed it
+class Yield : public StmtBase<Yield> {
+public:
+    Yield(Token keyword, Expr *value);
+
+    Token keyword;
+    Expr *value = nullptr;
 };
 
 class Block : public StmtBase<Block> {
 public:
-    explicit Block(const std::vector<Stmt *> &statements);
+    explicit Block(AstList<Stmt *> statements);
 
-    std::vector<Stmt *> statements;
+    AstList<Stmt *> statements;
+    // Whether the block declares names of its own. The Resolver opens no scope for a block that
+    // doesn't, and it runs in the environment around it
+    bool scoped = false;
 };
 
 class Class : public StmtBase<Class> {
 public:
-    Class(Token name, Variable *superclass, std::vector<FuncStmt *> methods);
+    Class(Token name, Variable *superclass, AstList<FuncStmt *> methods);
 
     Token name;
     Variable *superclass = nullptr;
-    std::vector<FuncStmt *> methods;
+    AstList<FuncStmt *> methods;
 };
 
 class Var : public StmtBase<Var> {
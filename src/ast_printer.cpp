@@ -25,17 +25,17 @@ std::string AstPrinter::visit(Literal *expr)
 
 std::string AstPrinter::visit(Logical *expr)
 {
-    return "Logic{" + expr->op.lexeme + ", " + expr->left->accept(this) + ", " + expr->right->accept(this) + "}";
+    return "Logic{" + std::string{expr->op.lexeme} + ", " + expr->left->accept(this) + ", " + expr->right->accept(this) + "}";
 }
 
 std::string AstPrinter::visit(Unary *expr)
 {
-    return "UnOp{'" + expr->op.lexeme + "', " + expr->right->accept(this) + "}";
+    return "UnOp{'" + std::string{expr->op.lexeme} + "', " + expr->right->accept(this) + "}";
 }
 
 std::string AstPrinter::visit(Binary *expr)
 {
-    return "BinOp{'" + expr->op.lexeme + "', " + expr->left->accept(this) + ", " + expr->right->accept(this) + "}";
+    return "BinOp{'" + std::string{expr->op.lexeme} + "', " + expr->left->accept(this) + ", " + expr->right->accept(this) + "}";
 }
 
 std::string AstPrinter::visit(Call *expr)
@@ -54,32 +54,60 @@ std::string AstPrinter::visit(Grouping *expr)
 
 std::string AstPrinter::visit(Variable *expr)
 {
-    return "Var{" + expr->name.lexeme + "}";
+    return "Var{" + std::string{expr->name.lexeme} + "}";
 }
 
 std::string AstPrinter::visit(Assign *expr)
 {
-    return "Assign{" + expr->name.lexeme + ", " + expr->value->accept(this) + "}";
+    return "Assign{" + std::string{expr->name.lexeme} + ", " + expr->value->accept(this) + "}";
 }
 
 std::string AstPrinter::visit(Get *expr)
 {
-    return "Get{" + expr->name.lexeme + "}";
+    return "Get{" + std::string{expr->name.lexeme} + "}";
 }
 
 std::string AstPrinter::visit(Set *expr)
 {
-    return "Set{" + expr->name.lexeme + "}";
+    return "Set{" + std::string{expr->name.lexeme} + "}";
 }
 
 std::string AstPrinter::visit(Super *expr)
 {
-    return "Super{" + expr->keyword.lexeme + " " + expr->method.lexeme + "}";
+    return "Super{" + std::string{expr->keyword.lexeme} + " " + std::string{expr->method.lexeme} + "}";
 }
 
 std::string AstPrinter::visit(This *expr)
 {
-    return "This{" + expr->keyword.lexeme + "}";
+    return "This{" + std::string{expr->keyword.lexeme} + "}";
+}
+
+std::string AstPrinter::visit(ListExpr *expr)
+{
+    std::string elements;
+    for (Expr *element : expr->elements) {
+        elements += (elements.empty() ? "" : ", ") + element->accept(this);
+    }
+    return "List{" + elements + "}";
+}
+
+std::string AstPrinter::visit(MapExpr *expr)
+{
+    std::string entries;
+    for (std::size_t i = 0; i < expr->keys.size(); i++) {
+        entries += (entries.empty() ? "" : ", ") + expr->keys[i]->accept(this) + ": " + expr->values[i]->accept(this);
+    }
+    return "Map{" + entries + "}";
+}
+
+std::string AstPrinter::visit(GetIndex *expr)
+{
+    return "Index{" + expr->object->accept(this) + ", " + expr->index->accept(this) + "}";
+}
+
+std::string AstPrinter::visit(SetIndex *expr)
+{
+    return "SetIndex{" + expr->object->accept(this) + ", " + expr->index->accept(this) + ", " + expr->value->accept(this) + "}";
 }
 
 std::string AstPrinter::visit(ExprStmt *stmt)
@@ -97,7 +125,7 @@ std::string AstPrinter::visit(If *stmt)
 
 std::string AstPrinter::visit(FuncStmt *stmt)
 {
-    std::string name = stmt->name.lexeme;
+    std::string name{stmt->name.lexeme};
     std::string params;
     for (auto param : stmt->params) {
         params.append(param.lexeme);
@@ -124,7 +152,7 @@ std::string AstPrinter::visit(Print *stmt)
 std::string AstPrinter::visit(Return *stmt)
 {
     std::string body;
-    if (stmt) {
+    if (stmt->value) {
         body = stmt->value->accept(this);
     }
     return "Return{" + body + "}";
@@ -135,6 +163,15 @@ std::string AstPrinter::visit(While *stmt)
     return "While{" + stmt->condition->accept(this) + ", " + stmt->body->accept(this) + "}";
 }
 
+std::string AstPrinter::visit(Yield *stmt)
+{
+    std::string value;
+    if (stmt->value) {
+        value = stmt->value->accept(this);
+    }
+    return "Yield{" + value + "}";
+}
+
 std::string AstPrinter::visit(Block *stmt)
 {
     std::string str = "{";
@@ -165,7 +202,7 @@ std::string AstPrinter::visit(Var *stmt)
     if (stmt->initializer) {
         initializer = stmt->initializer->accept(this);
     }
-    return "Var{" + stmt->name.lexeme + ", " + initializer + "}";
+    return "Var{" + std::string{stmt->name.lexeme} + ", " + initializer + "}";
 }
 
 }  // namespace draft
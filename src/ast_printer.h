@@ -21,6 +21,10 @@ public:
     std::string visit(Set *expr) override;
     std::string visit(Super *expr) override;
     std::string visit(This *expr) override;
+    std::string visit(ListExpr *expr) override;
+    std::string visit(MapExpr *expr) override;
+    std::string visit(GetIndex *expr) override;
+    std::string visit(SetIndex *expr) override;
 
     std::string visit(ExprStmt *stmt) override;
     std::string visit(If *stmt) override;
@@ -28,6 +32,7 @@ public:
     std::string visit(Print *stmt) override;
     std::string visit(Return *stmt) override;
     std::string visit(While *stmt) override;
+    std::string visit(Yield *stmt) override;
     std::string visit(Block *stmt) override;
     std::string visit(Class *stmt) override;
     std::string visit(Var *stmt) override;
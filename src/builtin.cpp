@@ -1,15 +1,38 @@
 #include "builtin.h"
 
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+#include "interpreter.h"
+#include "obj_coroutine.h"
+#include "obj_list.h"
+#include "obj_map.h"
 
 namespace draft {
 
-std::size_t ClockFunction::arity()
+NativeFunction::NativeFunction(std::string_view name, std::size_t arity, Body body)
+    : name{name}
+    , parameters{arity}
+    , body{body}
+{
+}
+
+std::size_t NativeFunction::arity()
 {
-    return 0;
+    return parameters;
 }
 
-object::Object ClockFunction::call(Interpreter *, std::vector<object::Object>)
+object::Object NativeFunction::call(Interpreter *interpreter, object::Arguments arguments)
+{
+    return body(interpreter, arguments);
+}
+
+namespace {
+
+object::Object clockNative(Interpreter *, object::Arguments)
 {
     namespace cr = std::chrono;
     auto now = cr::system_clock::now();
@@ -18,4 +41,297 @@ object::Object ClockFunction::call(Interpreter *, std::vector<object::Object>)
     return static_cast<object::Number>(seconds);
 }
 
+// Doubles hold nanoseconds exactly for over a hundred days of uptime
+object::Object clockNsNative(Interpreter *, object::Arguments)
+{
+    namespace cr = std::chrono;
+    auto now = cr::steady_clock::now().time_since_epoch();
+    return static_cast<object::Number>(cr::duration_cast<cr::nanoseconds>(now).count());
+}
+
+object::Object cpuTimeNative(Interpreter *, object::Arguments)
+{
+    return static_cast<object::Number>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+// Each call is timed on its own, so the figures include one read of the clock
+object::Object benchNative(Interpreter *interpreter, object::Arguments arguments)
+{
+    // The arguments view the value stack, which the calls reuse
+    auto function = std::get_if<object::CallablePtr>(&arguments[0]);
+    if (!function or (*function)->arity() != 0) {
+        throw NativeError{"bench() takes a function of no arguments"};
+    }
+    object::CallablePtr callee = *function;
+    auto count = std::get_if<object::Number>(&arguments[1]);
+    if (!count or *count < 1 or std::trunc(*count) != *count) {
+        throw NativeError{"bench() runs a whole, positive number of iterations"};
+    }
+    std::size_t iterations = static_cast<std::size_t>(*count);
+
+    // Welford's running mean and sum of squared deviations
+    namespace cr = std::chrono;
+    double mean = 0;
+    double squares = 0;
+    for (std::size_t i = 1; i <= iterations; i++) {
+        auto start = cr::steady_clock::now();
+        interpreter->callFromNative(*callee, {});
+        double elapsed = cr::duration<double, std::nano>(cr::steady_clock::now() - start).count();
+        double delta = elapsed - mean;
+        mean += delta / i;
+        squares += delta * (elapsed - mean);
+    }
+    double deviation = iterations > 1 ? std::sqrt(squares / (iterations - 1)) : 0;
+
+    char line[128];
+    std::snprintf(line, sizeof(line), "bench: %zu runs, mean %.1f ns, deviation %.1f ns", iterations, mean, deviation);
+    interpreter->getOutput().write(line);
+    interpreter->getOutput().endLine();
+    return mean;
+}
+
+object::Object statsNative(Interpreter *interpreter, object::Arguments)
+{
+    if (const Stats *stats = interpreter->getStats()) {
+        return stats->report();
+    }
+    return object::Null{};
+}
+
+object::List &listArgument(const object::Object &argument, const char *message)
+{
+    auto list = std::get_if<object::ListPtr>(&argument);
+    if (!list) {
+        throw NativeError{message};
+    }
+    return **list;
+}
+
+// A list of numbers only, ready for the bulk operations
+std::span<const object::Number> numbersArgument(const object::Object &argument, const char *message)
+{
+    object::List &list = listArgument(argument, message);
+    if (!list.isNumeric()) {
+        throw NativeError{message};
+    }
+    return list.numbers();
+}
+
+object::Map &mapArgument(const object::Object &argument, const char *message)
+{
+    auto map = std::get_if<object::MapPtr>(&argument);
+    if (!map) {
+        throw NativeError{message};
+    }
+    return **map;
+}
+
+object::Object lenNative(Interpreter *, object::Arguments arguments)
+{
+    if (auto text = std::get_if<object::String>(&arguments[0])) {
+        return static_cast<object::Number>(text->size());
+    }
+    if (auto map = std::get_if<object::MapPtr>(&arguments[0])) {
+        return static_cast<object::Number>((*map)->size());
+    }
+    return static_cast<object::Number>(listArgument(arguments[0], "len() takes a list, a map or a string").size());
+}
+
+object::Object pushNative(Interpreter *, object::Arguments arguments)
+{
+    object::List &list = listArgument(arguments[0], "push() takes a list");
+    list.push(arguments[1]);
+    return static_cast<object::Number>(list.size());
+}
+
+object::Object popNative(Interpreter *, object::Arguments arguments)
+{
+    object::List &list = listArgument(arguments[0], "pop() takes a list");
+    if (list.size() == 0) {
+        throw NativeError{"pop() from an empty list"};
+    }
+    return list.pop();
+}
+
+object::Object sumNative(Interpreter *, object::Arguments arguments)
+{
+    return object::sum(numbersArgument(arguments[0], "sum() takes a list of numbers"));
+}
+
+object::Object dotNative(Interpreter *, object::Arguments arguments)
+{
+    auto left = numbersArgument(arguments[0], "dot() takes two lists of numbers");
+    auto right = numbersArgument(arguments[1], "dot() takes two lists of numbers");
+    if (left.size() != right.size()) {
+        throw NativeError{"dot() takes lists of the same length"};
+    }
+    return object::dot(left, right);
+}
+
+object::Object mapAddNative(Interpreter *, object::Arguments arguments)
+{
+    auto values = numbersArgument(arguments[0], "map_add() takes a list of numbers and a number");
+    auto addend = std::get_if<object::Number>(&arguments[1]);
+    if (!addend) {
+        throw NativeError{"map_add() takes a list of numbers and a number"};
+    }
+    std::vector<object::Number> sums(values.size());
+    object::add(values, *addend, sums);
+    return std::make_shared<object::List>(std::move(sums));
+}
+
+object::Object keysNative(Interpreter *, object::Arguments arguments)
+{
+    const object::Map &map = mapArgument(arguments[0], "keys() takes a map");
+    std::vector<object::Object> keys;
+    keys.reserve(map.size());
+    for (const object::Map::Entry &entry : map.entries()) {
+        keys.push_back(entry.key);
+    }
+    return std::make_shared<object::List>(std::move(keys));
+}
+
+object::Object valuesNative(Interpreter *, object::Arguments arguments)
+{
+    const object::Map &map = mapArgument(arguments[0], "values() takes a map");
+    std::vector<object::Object> values;
+    values.reserve(map.size());
+    for (const object::Map::Entry &entry : map.entries()) {
+        values.push_back(entry.value);
+    }
+    return std::make_shared<object::List>(std::move(values));
+}
+
+object::Object hasNative(Interpreter *, object::Arguments arguments)
+{
+    return mapArgument(arguments[0], "has() takes a map").find(arguments[1]) != nullptr;
+}
+
+object::Object removeNative(Interpreter *, object::Arguments arguments)
+{
+    return mapArgument(arguments[0], "remove() takes a map").remove(arguments[1]);
+}
+
+Isolate::Id isolateArgument(const object::Object &argument)
+{
+    auto id = std::get_if<object::Number>(&argument);
+    if (!id or *id < 0 or std::trunc(*id) != *id) {
+        throw NativeError{"send() takes an isolate id and a value"};
+    }
+    return static_cast<Isolate::Id>(*id);
+}
+
+object::Object spawnNative(Interpreter *interpreter, object::Arguments arguments)
+{
+    auto source = std::get_if<object::String>(&arguments[0]);
+    if (!source) {
+        throw NativeError{"spawn() takes the source of a program"};
+    }
+    return static_cast<object::Number>(Isolate::spawn(*source, interpreter->getIsolate()));
+}
+
+object::Object sendNative(Interpreter *, object::Arguments arguments)
+{
+    Isolate::send(isolateArgument(arguments[0]), arguments[1]);
+    return object::Null{};
+}
+
+object::Object receiveNative(Interpreter *interpreter, object::Arguments)
+{
+    // Whatever the program printed so far shows before it waits on others
+    interpreter->getOutput().flush();
+    return Isolate::receive(interpreter->getIsolate());
+}
+
+object::Object parentNative(Interpreter *interpreter, object::Arguments)
+{
+    if (std::optional<Isolate::Id> parent = Isolate::parent(interpreter->getIsolate())) {
+        return static_cast<object::Number>(*parent);
+    }
+    return object::Null{};
+}
+
+object::CoroutinePtr coroutineArgument(const object::Object &argument, const char *message)
+{
+    auto callable = std::get_if<object::CallablePtr>(&argument);
+    auto coroutine = callable ? std::dynamic_pointer_cast<object::Coroutine>(*callable) : nullptr;
+    if (!coroutine) {
+        throw NativeError{message};
+    }
+    return coroutine;
+}
+
+object::Object asyncNative(Interpreter *interpreter, object::Arguments arguments)
+{
+    constexpr auto message = "async() takes a coroutine or a function of no arguments";
+    auto callable = std::get_if<object::CallablePtr>(&arguments[0]);
+    auto function = callable ? std::dynamic_pointer_cast<object::Function>(*callable) : nullptr;
+    if (function and function->arity() != 0) {
+        throw NativeError{message};
+    }
+    object::CoroutinePtr task = function ? function->coroutine(nullptr, {}) : coroutineArgument(arguments[0], message);
+    if (!task->scheduled and !task->isDone()) {
+        interpreter->getScheduler().add(task);
+    }
+    return task;
+}
+
+object::Object awaitNative(Interpreter *interpreter, object::Arguments arguments)
+{
+    object::CoroutinePtr task = coroutineArgument(arguments[0], "await() takes a coroutine");
+    interpreter->getScheduler().await(interpreter, task);
+    return task->result();
+}
+
+object::Object sleepNative(Interpreter *interpreter, object::Arguments arguments)
+{
+    auto seconds = std::get_if<object::Number>(&arguments[0]);
+    if (!seconds or *seconds < 0) {
+        throw NativeError{"sleep() takes a number of seconds, not negative"};
+    }
+    interpreter->getOutput().flush();
+    auto duration = std::chrono::duration<double>(*seconds);
+    interpreter->getScheduler().sleep(interpreter, Scheduler::Clock::now() +
+                                                       std::chrono::duration_cast<Scheduler::Clock::duration>(duration));
+    return object::Null{};
+}
+
+object::Object doneNative(Interpreter *, object::Arguments arguments)
+{
+    return coroutineArgument(arguments[0], "done() takes a coroutine")->isDone();
+}
+
+constexpr std::array table = {
+    Native{"clock", 0, clockNative},
+    Native{"clock_ns", 0, clockNsNative},
+    Native{"cpu_time", 0, cpuTimeNative},
+    Native{"bench", 2, benchNative},
+    Native{"stats", 0, statsNative},
+    Native{"len", 1, lenNative},
+    Native{"push", 2, pushNative},
+    Native{"pop", 1, popNative},
+    Native{"sum", 1, sumNative},
+    Native{"dot", 2, dotNative},
+    Native{"map_add", 2, mapAddNative},
+    Native{"keys", 1, keysNative},
+    Native{"values", 1, valuesNative},
+    Native{"has", 2, hasNative},
+    Native{"remove", 2, removeNative},
+    Native{"spawn", 1, spawnNative},
+    Native{"send", 2, sendNative},
+    Native{"receive", 0, receiveNative},
+    Native{"parent", 0, parentNative},
+    Native{"async", 1, asyncNative},
+    Native{"await", 1, awaitNative},
+    Native{"sleep", 1, sleepNative},
+    Native{"done", 1, doneNative},
+};
+
+}  // namespace
+
+std::span<const Native> natives()
+{
+    return table;
+}
+
 }  // namespace draft
@@ -1,14 +1,71 @@
 #pragma once
 
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
 #include "obj_callable.h"
 
 namespace draft {
 
-class ClockFunction : public object::Callable {
+// Thrown by a native function called the wrong way; the interpreter reports it as a RuntimeError at
+// the call
+class NativeError : public std::runtime_error {
 public:
+    using std::runtime_error::runtime_error;
+};
+
+// A function of the host, called like any Draft function
+class NativeFunction : public object::Callable {
+public:
+    using Body = object::Object (*)(Interpreter *interpreter, object::Arguments arguments);
+
+    NativeFunction(std::string_view name, std::size_t arity, Body body);
+
     std::size_t arity() override;
+    object::Object call(Interpreter *interpreter, object::Arguments arguments) override;
+
+    std::string_view name;
 
-    object::Object call(Interpreter *, std::vector<object::Object>) override;
+private:
+    std::size_t parameters = 0;
+    Body body = nullptr;
 };
 
+// A native function the Interpreter defines as a global when it is made
+struct Native {
+    std::string_view name;
+    std::size_t arity = 0;
+    NativeFunction::Body body = nullptr;
+};
+
+// Natives of every interpreter:
+//   clock()          seconds since the epoch, whole
+//   clock_ns()       nanoseconds of a monotonic clock
+//   cpu_time()       seconds of processor time the process used
+//   bench(fn, n)     calls `fn` n times in a native loop, prints the mean and standard deviation of
+//                    a call and returns the mean in nanoseconds
+//   stats()          the counters of the running program as text, nil when there are none
+//   len(x)           number of elements of a list or a map, or of bytes of a string
+//   push(list, x)    appends x and returns the new length
+//   pop(list)        removes and returns the last element
+//   sum(list)        sum of a list of numbers
+//   dot(a, b)        dot product of two lists of numbers of the same length
+//   map_add(list, x) a new list of the numbers of `list` plus x
+//   keys(map)        the keys of a map as a list, in the order of Map::entries()
+//   values(map)      the values of a map as a list, in the same order
+//   has(map, key)    whether the map has an entry for `key`
+//   remove(map, key) removes the entry of `key`, returning whether there was one
+//   spawn(source)    starts the program `source` in a new isolate and returns its id, see Isolate
+//   send(id, x)      copies x to the isolate `id`
+//   receive()        the next value sent to this isolate, nil once none can arrive
+//   parent()         id of the isolate that spawned this one, nil in the main one
+//   async(co)        makes the coroutine `co` a task of the Scheduler and returns it; a function
+//                    of no arguments is run as a task, in a coroutine of its own
+//   await(co)        waits for the coroutine to finish, running it as a task, and returns what
+//                    its function returned
+//   sleep(seconds)   waits that long; a task lets the others run meanwhile
+//   done(co)         whether the coroutine has finished
+std::span<const Native> natives();
+
 }  // namespace draft
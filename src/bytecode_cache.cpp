@@ -0,0 +1,612 @@
+#include "bytecode_cache.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "source.h"
+
+namespace draft::vm {
+namespace {
+
+// Bumped whenever the layout below or the meaning of an opcode changes
+constexpr std::uint32_t FormatVersion = 2;
+constexpr std::array<char, 8> Magic{'D', 'R', 'A', 'F', 'T', 'B', 'C', '\0'};
+
+/*
+Entry layout, all integers in native byte order:
+
+header    :: magic version:u32 hash:u64 sourceSize:u64 source:bytes function
+function  :: arity:u32 upvalueCount:u32 name:string? caches:u32 code lines constants
+string?   :: present:u8 string?
+string    :: size:u32 bytes
+code      :: size:u32 bytes
+lines     :: size:u32 line:u32*
+constants :: size:u32 constant*
+constant  :: Nil | False | True | Number f64 | String string | Function function
+*/
+enum class Tag : std::uint8_t { Nil, False, True, Number, String, Function };
+
+class Writer {
+public:
+    template <typename T>
+    void put(T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void put(std::string_view text)
+    {
+        put(static_cast<std::uint32_t>(text.size()));
+        bytes.append(text);
+    }
+
+    void function(const ObjFunction *function)
+    {
+        put(static_cast<std::uint32_t>(function->arity));
+        put(static_cast<std::uint32_t>(function->upvalueCount));
+        put(static_cast<std::uint8_t>(function->name != nullptr));
+        if (function->name) {
+            put(std::string_view{function->name->chars});
+        }
+
+        const Chunk &chunk = function->chunk;
+        put(static_cast<std::uint32_t>(chunk.caches.size()));
+        put(static_cast<std::uint32_t>(chunk.code.size()));
+        bytes.append(reinterpret_cast<const char *>(chunk.code.data()), chunk.code.size());
+        put(static_cast<std::uint32_t>(chunk.lines.size()));
+        for (std::size_t line : chunk.lines) {
+            put(static_cast<std::uint32_t>(line));
+        }
+        put(static_cast<std::uint32_t>(chunk.constants.size()));
+        for (Value constant : chunk.constants) {
+            value(constant);
+        }
+    }
+
+    void value(Value value)
+    {
+        if (value.isNil()) {
+            put(Tag::Nil);
+        } else if (value.isBool()) {
+            put(value.asBool() ? Tag::True : Tag::False);
+        } else if (value.isNumber()) {
+            put(Tag::Number);
+            put(value.asNumber());
+        } else if (isObjType(value, ObjType::String)) {
+            put(Tag::String);
+            put(std::string_view{as<ObjString>(value)->chars});
+        } else {
+            // The compiler puts nothing else in a constant table
+            put(Tag::Function);
+            function(as<ObjFunction>(value));
+        }
+    }
+
+    std::string bytes;
+};
+
+// Bytes of the operands of each opcode, those of a closure's upvalues aside
+constexpr std::size_t operandBytes(OpCode op)
+{
+    switch (op) {
+    case OpCode::GetLocal:
+    case OpCode::SetLocal:
+    case OpCode::GetUpvalue:
+    case OpCode::SetUpvalue:
+    case OpCode::Call:
+        return 1;
+    case OpCode::Constant:
+    case OpCode::GetGlobal:
+    case OpCode::DefineGlobal:
+    case OpCode::SetGlobal:
+    case OpCode::GetSuper:
+    case OpCode::Jump:
+    case OpCode::JumpIfFalse:
+    case OpCode::Loop:
+    case OpCode::Closure:
+    case OpCode::Class:
+    case OpCode::Method:
+        return 2;
+    case OpCode::SuperInvoke:
+        return 3;
+    case OpCode::GetProperty:
+    case OpCode::SetProperty:
+        return 4;
+    case OpCode::Invoke:
+        return 5;
+    default:
+        return 0;
+    }
+}
+
+constexpr std::uint8_t OpCodeCount = 0
+#define OPCODE(name) +1
+#include "opcode.def"
+    ;
+
+// Values an instruction needs on the stack and how many it leaves there in their place
+struct StackEffect {
+    std::size_t needs;
+    std::size_t leaves;
+};
+
+constexpr std::size_t StackDepthMax = 256;
+
+StackEffect stackEffect(OpCode op, std::size_t argCount)
+{
+    switch (op) {
+    case OpCode::Constant:
+    case OpCode::Nil:
+    case OpCode::True:
+    case OpCode::False:
+    case OpCode::GetLocal:
+    case OpCode::GetGlobal:
+    case OpCode::GetUpvalue:
+    case OpCode::Closure:
+    case OpCode::Class:
+        return {0, 1};
+    case OpCode::Pop:
+    case OpCode::DefineGlobal:
+    case OpCode::Print:
+    case OpCode::CloseUpvalue:
+        return {1, 0};
+    case OpCode::SetLocal:
+    case OpCode::SetGlobal:
+    case OpCode::SetUpvalue:
+    case OpCode::GetProperty:
+    case OpCode::Not:
+    case OpCode::Negate:
+    case OpCode::JumpIfFalse:
+    case OpCode::Return:
+        return {1, 1};
+    case OpCode::Call:
+    case OpCode::Invoke:
+        return {argCount + 1, 1};
+    case OpCode::SuperInvoke:
+        return {argCount + 2, 1};
+    case OpCode::Jump:
+    case OpCode::Loop:
+        return {0, 0};
+    default:
+        // Binary operators, SetProperty, GetSuper, Inherit and Method
+        return {2, 1};
+    }
+}
+
+// Checks that the code of a decoded function only does what the VM can run without checking:
+// every opcode is known and complete, constant and cache indices are in their tables, named
+// constants are strings and closures make functions, upvalues are the function's own, and jumps
+// land on an instruction. The depth of the stack is followed from the arguments along every
+// path, so no path falls off the end or gets there with two depths, no instruction pops what is
+// not there, local slots, captured locals and call arguments lie below the top, and no frame
+// holds more than StackDepthMax values
+bool verify(const ObjFunction &function)
+{
+    const Chunk &chunk = function.chunk;
+    const std::vector<std::uint8_t> &code = chunk.code;
+    auto u16 = [&](std::size_t at) { return static_cast<std::size_t>((code[at] << 8) | code[at + 1]); };
+    auto isString = [&](std::size_t index) {
+        return index < chunk.constants.size() and isObjType(chunk.constants[index], ObjType::String);
+    };
+    auto upvalueCount = [&](std::size_t at) {
+        return static_cast<std::size_t>(as<ObjFunction>(chunk.constants[u16(at + 1)])->upvalueCount);
+    };
+
+    std::vector<bool> starts(code.size(), false);
+    std::vector<std::size_t> targets;
+    for (std::size_t at = 0; at < code.size();) {
+        if (code[at] >= OpCodeCount) {
+            return false;
+        }
+        starts[at] = true;
+        auto op = static_cast<OpCode>(code[at]);
+        std::size_t operands = at + 1;
+        std::size_t next = operands + operandBytes(op);
+        if (next > code.size()) {
+            return false;
+        }
+        switch (op) {
+        case OpCode::Constant:
+            if (u16(operands) >= chunk.constants.size()) {
+                return false;
+            }
+            break;
+        case OpCode::GetGlobal:
+        case OpCode::DefineGlobal:
+        case OpCode::SetGlobal:
+        case OpCode::GetSuper:
+        case OpCode::Class:
+        case OpCode::Method:
+        case OpCode::SuperInvoke:
+            if (!isString(u16(operands))) {
+                return false;
+            }
+            break;
+        case OpCode::GetProperty:
+        case OpCode::SetProperty:
+        case OpCode::Invoke:
+            if (!isString(u16(operands)) or u16(operands + 2) >= chunk.caches.size()) {
+                return false;
+            }
+            break;
+        case OpCode::GetUpvalue:
+        case OpCode::SetUpvalue:
+            if (code[operands] >= function.upvalueCount) {
+                return false;
+            }
+            break;
+        case OpCode::Jump:
+        case OpCode::JumpIfFalse:
+            targets.push_back(next + u16(operands));
+            break;
+        case OpCode::Loop:
+            if (u16(operands) > next) {
+                return false;
+            }
+            targets.push_back(next - u16(operands));
+            break;
+        case OpCode::Closure: {
+            std::size_t index = u16(operands);
+            if (index >= chunk.constants.size() or !isObjType(chunk.constants[index], ObjType::Function)) {
+                return false;
+            }
+            std::size_t upvalues = upvalueCount(at);
+            if (next + 2 * upvalues > code.size()) {
+                return false;
+            }
+            for (std::size_t i = 0; i < upvalues; i++, next += 2) {
+                std::uint8_t isLocal = code[next];
+                if (isLocal > 1 or (!isLocal and code[next + 1] >= function.upvalueCount)) {
+                    return false;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        at = next;
+    }
+    for (std::size_t target : targets) {
+        if (target >= code.size() or !starts[target]) {
+            return false;
+        }
+    }
+
+    // Depth on entry to each instruction reached so far, the callee and its arguments first
+    constexpr std::size_t Unreached = SIZE_MAX;
+    std::vector<std::size_t> depths(code.size(), Unreached);
+    std::vector<std::size_t> pending;
+    auto reach = [&](std::size_t at, std::size_t depth) {
+        if (at >= code.size()) {
+            return false;
+        }
+        if (depths[at] == Unreached) {
+            depths[at] = depth;
+            pending.push_back(at);
+        }
+        return depths[at] == depth;
+    };
+    if (function.arity < 0 or !reach(0, static_cast<std::size_t>(function.arity) + 1)) {
+        return false;
+    }
+    while (!pending.empty()) {
+        std::size_t at = pending.back();
+        pending.pop_back();
+        std::size_t depth = depths[at];
+        auto op = static_cast<OpCode>(code[at]);
+        std::size_t operands = at + 1;
+        std::size_t next = operands + operandBytes(op);
+
+        std::size_t argCount = 0;
+        switch (op) {
+        case OpCode::GetLocal:
+        case OpCode::SetLocal:
+            if (code[operands] >= depth) {
+                return false;
+            }
+            break;
+        case OpCode::Call:
+            argCount = code[operands];
+            break;
+        case OpCode::Invoke:
+            argCount = code[operands + 4];
+            break;
+        case OpCode::SuperInvoke:
+            argCount = code[operands + 2];
+            break;
+        case OpCode::Closure:
+            for (std::size_t i = upvalueCount(at); i > 0; i--, next += 2) {
+                if (code[next] and code[next + 1] >= depth) {
+                    return false;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+        StackEffect effect = stackEffect(op, argCount);
+        if (depth < effect.needs) {
+            return false;
+        }
+        depth = depth - effect.needs + effect.leaves;
+        if (depth > StackDepthMax) {
+            return false;
+        }
+
+        switch (op) {
+        case OpCode::Return:
+            break;
+        case OpCode::Jump:
+            if (!reach(next + u16(operands), depth)) {
+                return false;
+            }
+            break;
+        case OpCode::Loop:
+            if (!reach(next - u16(operands), depth)) {
+                return false;
+            }
+            break;
+        case OpCode::JumpIfFalse:
+            if (!reach(next + u16(operands), depth) or !reach(next, depth)) {
+                return false;
+            }
+            break;
+        default:
+            if (!reach(next, depth)) {
+                return false;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+// Decodes an entry, refusing anything truncated or whose bytecode fails verify(). Objects are
+// rooted as soon as they are made, since every allocation may start a collection
+class Reader : public Roots {
+public:
+    Reader(std::string_view bytes, Heap &heap)
+        : bytes{bytes}
+        , heap{heap}
+    {
+        heap.addRoots(this);
+    }
+    ~Reader() override
+    {
+        heap.removeRoots(this);
+    }
+
+    void markRoots(Heap &heap) override
+    {
+        for (ObjFunction *function : functions) {
+            heap.markObject(function);
+        }
+    }
+
+    template <typename T>
+    bool get(T &value)
+    {
+        if (bytes.size() - pos < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, bytes.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool get(std::string_view &text, std::size_t size)
+    {
+        if (bytes.size() - pos < size) {
+            return false;
+        }
+        text = bytes.substr(pos, size);
+        pos += size;
+        return true;
+    }
+
+    ObjString *string()
+    {
+        std::uint32_t size = 0;
+        std::string_view text;
+        if (!get(size) or !get(text, size)) {
+            return nullptr;
+        }
+        return heap.makeString(text);
+    }
+
+    ObjFunction *function()
+    {
+        ObjFunction *function = heap.make<ObjFunction>();
+        functions.push_back(function);
+
+        std::uint32_t arity = 0;
+        std::uint32_t upvalueCount = 0;
+        std::uint8_t hasName = 0;
+        if (!get(arity) or !get(upvalueCount) or !get(hasName)) {
+            return nullptr;
+        }
+        function->arity = static_cast<int>(arity);
+        function->upvalueCount = static_cast<int>(upvalueCount);
+        if (hasName and !(function->name = string())) {
+            return nullptr;
+        }
+
+        Chunk &chunk = function->chunk;
+        std::uint32_t count = 0;
+        std::string_view code;
+        if (!get(count)) {
+            return nullptr;
+        }
+        chunk.caches.resize(count);
+        if (!get(count) or !get(code, count)) {
+            return nullptr;
+        }
+        chunk.code.assign(code.begin(), code.end());
+        if (!get(count) or count != chunk.code.size()) {
+            return nullptr;
+        }
+        chunk.lines.reserve(count);
+        for (std::uint32_t i = 0; i < count; i++) {
+            std::uint32_t line = 0;
+            if (!get(line)) {
+                return nullptr;
+            }
+            chunk.lines.push_back(line);
+        }
+        if (!get(count)) {
+            return nullptr;
+        }
+        for (std::uint32_t i = 0; i < count; i++) {
+            Value constant;
+            if (!value(constant)) {
+                return nullptr;
+            }
+            chunk.constants.push_back(constant);
+        }
+        return verify(*function) ? function : nullptr;
+    }
+
+    bool value(Value &value)
+    {
+        Tag tag{};
+        if (!get(tag)) {
+            return false;
+        }
+        switch (tag) {
+        case Tag::Nil:
+            value = Value::nil();
+            return true;
+        case Tag::False:
+            value = Value::boolean(false);
+            return true;
+        case Tag::True:
+            value = Value::boolean(true);
+            return true;
+        case Tag::Number: {
+            double number = 0;
+            if (!get(number)) {
+                return false;
+            }
+            value = Value::number(number);
+            return true;
+        }
+        case Tag::String:
+            if (ObjString *string = this->string()) {
+                value = Value::object(string);
+                return true;
+            }
+            return false;
+        case Tag::Function:
+            if (ObjFunction *function = this->function()) {
+                value = Value::object(function);
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+
+    bool atEnd() const
+    {
+        return pos == bytes.size();
+    }
+
+private:
+    std::string_view bytes;
+    std::size_t pos = 0;
+    Heap &heap;
+    std::vector<ObjFunction *> functions;
+};
+
+}  // namespace
+
+BytecodeCache::BytecodeCache(std::filesystem::path directory)
+    : directory{std::move(directory)}
+{
+}
+
+ObjFunction *BytecodeCache::load(std::string_view source, Heap &heap) const
+{
+    std::uint64_t key = hash(source);
+    std::optional<Source> mapped = Source::map(entry(key).string());
+    if (!mapped) {
+        return nullptr;
+    }
+
+    Reader reader{mapped->text(), heap};
+    std::array<char, Magic.size()> magic{};
+    std::uint32_t version = 0;
+    std::uint64_t storedHash = 0;
+    std::uint64_t storedSize = 0;
+    std::string_view storedSource;
+    if (!reader.get(magic) or magic != Magic or !reader.get(version) or version != FormatVersion or
+        !reader.get(storedHash) or storedHash != key or !reader.get(storedSize) or storedSize != source.size()) {
+        return nullptr;
+    }
+    // The hash only names the entry: two sources may share one, so the text itself is compared
+    if (!reader.get(storedSource, source.size()) or storedSource != source) {
+        return nullptr;
+    }
+    ObjFunction *script = reader.function();
+    return reader.atEnd() ? script : nullptr;
+}
+
+void BytecodeCache::store(std::string_view source, const ObjFunction *script) const
+{
+    std::uint64_t key = hash(source);
+    Writer writer;
+    writer.put(Magic);
+    writer.put(FormatVersion);
+    writer.put(key);
+    writer.put(static_cast<std::uint64_t>(source.size()));
+    writer.bytes.append(source);
+    writer.function(script);
+
+    // Many processes may race on the same entry: each writes its own file and renames it into
+    // place, so a reader only ever maps a complete entry
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::filesystem::path target = entry(key);
+    std::filesystem::path temporary = target;
+    temporary += "." + std::to_string(std::random_device{}()) + ".tmp";
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        if (!file.write(writer.bytes.data(), static_cast<std::streamsize>(writer.bytes.size()))) {
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+std::uint64_t BytecodeCache::hash(std::string_view source)
+{
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (char c : source) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    }
+    return hash;
+}
+
+std::filesystem::path BytecodeCache::entry(std::uint64_t key) const
+{
+    std::array<char, 17> name{};
+    std::snprintf(name.data(), name.size(), "%016llx", static_cast<unsigned long long>(key));
+    return directory / (std::string{name.data()} + ".dbc");
+}
+
+}  // namespace draft::vm
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#include "heap.h"
+
+namespace draft::vm {
+
+// On-disk cache of compiled scripts, so that a process running an unchanged script skips lexing,
+// parsing, resolving and compiling. An entry is named after a hash of the source text and holds
+// that text, then the script function with every nested function, constant and line table.
+// Loading maps the entry, compares the text and decodes the script straight into the heap,
+// checking the operands of its bytecode; stale, foreign, colliding or corrupt entries are ignored
+class BytecodeCache {
+public:
+    explicit BytecodeCache(std::filesystem::path directory);
+
+    // Script compiled from exactly this source, or nullptr if there is no usable entry
+    ObjFunction *load(std::string_view source, Heap &heap) const;
+    // Records the script compiled from the source. The cache is best effort, so failing to write
+    // the entry is not an error
+    void store(std::string_view source, const ObjFunction *script) const;
+
+    // 64-bit FNV-1a of the source text
+    static std::uint64_t hash(std::string_view source);
+
+private:
+    std::filesystem::path entry(std::uint64_t key) const;
+
+    std::filesystem::path directory;
+};
+
+}  // namespace draft::vm
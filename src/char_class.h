@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "token.h"
+
+namespace draft {
+
+// Character classes the lexer dispatches on, one bit each so a byte can belong to several
+enum CharClass : std::uint8_t {
+    Whitespace = 1 << 0,
+    NewLine = 1 << 1,
+    Digit = 1 << 2,
+    Alpha = 1 << 3,
+};
+
+namespace detail {
+
+// basic_latin.def lists the code points U+0000-U+007F in order, so the n-th entry names byte n
+constexpr std::array<Token::Kind, 128> basicLatin = {
+#define TOKEN(kind) Token::Kind::kind,
+#include "unicode/basic_latin.def"
+#undef TOKEN
+};
+
+constexpr bool between(Token::Kind kind, Token::Kind first, Token::Kind last)
+{
+    return kind >= first and kind <= last;
+}
+
+constexpr std::uint8_t classify(Token::Kind kind)
+{
+    using Kind = Token::Kind;
+    switch (kind) {
+    case Kind::Space:
+        [[fallthrough]];
+    case Kind::HorizontalTabulation:
+        [[fallthrough]];
+    case Kind::CarriageReturn:
+        return Whitespace;
+    case Kind::NewLine:
+        return NewLine;
+    case Kind::LowLine:
+        return Alpha;
+    default:
+        break;
+    }
+    if (between(kind, Kind::DigitZero, Kind::DigitNine)) {
+        return Digit;
+    }
+    if (between(kind, Kind::LatinCapitalLetterA, Kind::LatinCapitalLetterZ) or
+        between(kind, Kind::LatinSmallLetterA, Kind::LatinSmallLetterZ)) {
+        return Alpha;
+    }
+    return 0;
+}
+
+constexpr std::array<std::uint8_t, 256> makeCharClasses()
+{
+    std::array<std::uint8_t, 256> classes{};
+    for (std::size_t c = 0; c < basicLatin.size(); c++) {
+        classes[c] = classify(basicLatin[c]);
+    }
+    return classes;
+}
+
+}  // namespace detail
+
+// Class bits of every byte; bytes outside Basic Latin belong to no class
+inline constexpr std::array<std::uint8_t, 256> charClasses = detail::makeCharClasses();
+
+static_assert(detail::basicLatin['A'] == Token::Kind::LatinCapitalLetterA);
+static_assert(detail::basicLatin['~'] == Token::Kind::Tilde);
+
+inline bool hasClass(char c, std::uint8_t classes)
+{
+    return (charClasses[static_cast<unsigned char>(c)] & classes) != 0;
+}
+
+}  // namespace draft
@@ -0,0 +1,28 @@
+#include "chunk.h"
+
+namespace draft::vm {
+
+void Chunk::write(std::uint8_t byte, std::size_t line)
+{
+    code.push_back(byte);
+    lines.push_back(line);
+}
+
+void Chunk::write(OpCode op, std::size_t line)
+{
+    write(static_cast<std::uint8_t>(op), line);
+}
+
+std::size_t Chunk::addConstant(Value value)
+{
+    constants.push_back(value);
+    return constants.size() - 1;
+}
+
+std::size_t Chunk::addCache()
+{
+    caches.emplace_back();
+    return caches.size() - 1;
+}
+
+}  // namespace draft::vm
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "value.h"
+
+namespace draft::vm {
+
+class ObjClosure;
+class ObjShape;
+
+enum class OpCode : std::uint8_t {
+#define OPCODE(name) name,
+#include "opcode.def"
+};
+
+// Polymorphic inline cache of a single property access site. Each entry remembers, for one
+// receiver shape, the field slot or the method the name resolved to; once every way is taken the
+// oldest entry is replaced
+struct PropertyCache {
+    static constexpr std::size_t Ways = 4;
+
+    struct Entry {
+        ObjShape *shape = nullptr;
+        std::uint32_t slot = 0;
+        ObjClosure *method = nullptr;
+        // Set only: the shape an instance moves to when the store adds the field
+        ObjShape *transition = nullptr;
+    };
+
+    const Entry *find(const ObjShape *shape) const
+    {
+        for (std::size_t i = 0; i < count; i++) {
+            if (entries[i].shape == shape) {
+                return &entries[i];
+            }
+        }
+        return nullptr;
+    }
+
+    const Entry *add(const Entry &entry)
+    {
+        std::size_t way = count < Ways ? count++ : next++ % Ways;
+        entries[way] = entry;
+        return &entries[way];
+    }
+
+    std::array<Entry, Ways> entries;
+    std::size_t count = 0;
+    std::size_t next = 0;
+};
+
+// A sequence of bytecode together with the constants it refers to and the source line of every
+// byte, used for runtime error reporting
+class Chunk {
+public:
+    void write(std::uint8_t byte, std::size_t line);
+    void write(OpCode op, std::size_t line);
+    std::size_t addConstant(Value value);
+    std::size_t addCache();
+
+    std::vector<std::uint8_t> code;
+    std::vector<std::size_t> lines;
+    std::vector<Value> constants;
+    std::vector<PropertyCache> caches;
+};
+
+}  // namespace draft::vm
@@ -0,0 +1,696 @@
+#include "compiler.h"
+
+#include <limits>
+
+#include "driver.h"
+
+namespace draft::vm {
+
+Compiler::Compiler(Heap &heap)
+    : heap{heap}
+{
+    heap.addRoots(this);
+}
+
+Compiler::~Compiler()
+{
+    heap.removeRoots(this);
+}
+
+ObjFunction *Compiler::compile(std::span<Stmt *const> statements)
+{
+    FunctionState state;
+    beginFunction(state, FunctionType::Script, nullptr);
+    for (Stmt *statement : statements) {
+        compile(statement);
+    }
+    ObjFunction *script = endFunction();
+    return hadError ? nullptr : script;
+}
+
+// Functions still being compiled are not referenced from anywhere else yet
+void Compiler::markRoots(Heap &heap)
+{
+    for (FunctionState *state = current; state; state = state->enclosing) {
+        heap.markObject(state->function);
+    }
+}
+
+object::Object Compiler::visit(Literal *expr)
+{
+    auto visitor = [this](auto &&arg) {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, object::Null>) {
+            emit(OpCode::Nil);
+        } else if constexpr (std::is_same_v<T, object::Boolean>) {
+            emit(arg ? OpCode::True : OpCode::False);
+        } else if constexpr (std::is_same_v<T, object::Number>) {
+            emitConstant(Value::number(arg));
+        } else if constexpr (std::is_same_v<T, object::String>) {
+            emitConstant(Value::object(heap.makeString(arg)));
+        } else {
+            error("Unsupported literal");
+        }
+    };
+    std::visit(visitor, expr->value);
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Logical *expr)
+{
+    compile(expr->left);
+    line = expr->op.line;
+    if (expr->op.kind == Token::Kind::Or) {
+        std::size_t elseJump = emitJump(OpCode::JumpIfFalse);
+        std::size_t endJump = emitJump(OpCode::Jump);
+        patchJump(elseJump);
+        emit(OpCode::Pop);
+        compile(expr->right);
+        patchJump(endJump);
+    } else {
+        std::size_t endJump = emitJump(OpCode::JumpIfFalse);
+        emit(OpCode::Pop);
+        compile(expr->right);
+        patchJump(endJump);
+    }
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Unary *expr)
+{
+    compile(expr->right);
+    line = expr->op.line;
+    switch (expr->op.kind) {
+    case Token::Kind::HyphenMinus:
+        emit(OpCode::Negate);
+        break;
+    case Token::Kind::ExclamationMark:
+        emit(OpCode::Not);
+        break;
+    default:
+        error("Unknown unary operator '" + std::string{expr->op.lexeme} + "'");
+        break;
+    }
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Binary *expr)
+{
+    compile(expr->left);
+    compile(expr->right);
+    line = expr->op.line;
+    switch (expr->op.kind) {
+    case Token::Kind::GreaterThanSign:
+        emit(OpCode::Greater);
+        break;
+    case Token::Kind::GreaterEqual:
+        emit(OpCode::GreaterEqual);
+        break;
+    case Token::Kind::LessThanSign:
+        emit(OpCode::Less);
+        break;
+    case Token::Kind::LessEqual:
+        emit(OpCode::LessEqual);
+        break;
+    case Token::Kind::ExclaimEqual:
+        emit(OpCode::NotEqual);
+        break;
+    case Token::Kind::EqualEqual:
+        emit(OpCode::Equal);
+        break;
+    case Token::Kind::HyphenMinus:
+        emit(OpCode::Subtract);
+        break;
+    case Token::Kind::PlusSign:
+        emit(OpCode::Add);
+        break;
+    case Token::Kind::Solidus:
+        emit(OpCode::Divide);
+        break;
+    case Token::Kind::Asterisk:
+        emit(OpCode::Multiply);
+        break;
+    default:
+        error("Unknown binary operator '" + std::string{expr->op.lexeme} + "'");
+        break;
+    }
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Call *expr)
+{
+    if (expr->arguments.size() > std::numeric_limits<std::uint8_t>::max()) {
+        line = expr->paren.line;
+        error("Can't have more than 255 arguments");
+        return object::Null{};
+    }
+    auto argCount = static_cast<std::uint8_t>(expr->arguments.size());
+
+    // obj.name(...) and super.name(...) call the method directly instead of binding it first
+    if (expr->method) {
+        compile(expr->method->object);
+        for (Expr *argument : expr->arguments) {
+            compile(argument);
+        }
+        line = expr->paren.line;
+        emit(OpCode::Invoke);
+        emitShort(identifierConstant(expr->method->name));
+        emitShort(makeCache());
+        emit(argCount);
+        return object::Null{};
+    }
+    if (expr->superMethod and currentClass and currentClass->hasSuperclass) {
+        getVariable("this");
+        for (Expr *argument : expr->arguments) {
+            compile(argument);
+        }
+        line = expr->paren.line;
+        getVariable("super");
+        emit(OpCode::SuperInvoke);
+        emitShort(identifierConstant(expr->superMethod->method));
+        emit(argCount);
+        return object::Null{};
+    }
+
+    compile(expr->callee);
+    for (Expr *argument : expr->arguments) {
+        compile(argument);
+    }
+    line = expr->paren.line;
+    emit(OpCode::Call, argCount);
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Grouping *expr)
+{
+    compile(expr->expression);
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Variable *expr)
+{
+    line = expr->name.line;
+    getVariable(expr->name.lexeme);
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Assign *expr)
+{
+    compile(expr->value);
+    line = expr->name.line;
+    setVariable(expr->name.lexeme);
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Get *expr)
+{
+    compile(expr->object);
+    line = expr->name.line;
+    emit(OpCode::GetProperty);
+    emitShort(identifierConstant(expr->name));
+    emitShort(makeCache());
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Set *expr)
+{
+    compile(expr->object);
+    compile(expr->value);
+    line = expr->name.line;
+    emit(OpCode::SetProperty);
+    emitShort(identifierConstant(expr->name));
+    emitShort(makeCache());
+    return object::Null{};
+}
+
+object::Object Compiler::visit(Super *expr)
+{
+    line = expr->keyword.line;
+    if (!currentClass or !currentClass->hasSuperclass) {
+        error("Can't use 'super' in a class with no superclass");
+        return object::Null{};
+    }
+    getVariable("this");
+    getVariable("super");
+    emit(OpCode::GetSuper);
+    emitShort(identifierConstant(expr->method));
+    return object::Null{};
+}
+
+object::Object Compiler::visit(This *expr)
+{
+    line = expr->keyword.line;
+    getVariable("this");
+    return object::Null{};
+}
+
+// Lists and maps only exist in the tree-walker
+object::Object Compiler::visit(ListExpr *expr)
+{
+    line = expr->bracket.line;
+    error("Lists are not supported by the VM");
+    return object::Null{};
+}
+
+object::Object Compiler::visit(MapExpr *expr)
+{
+    line = expr->brace.line;
+    error("Maps are not supported by the VM");
+    return object::Null{};
+}
+
+object::Object Compiler::visit(GetIndex *expr)
+{
+    line = expr->bracket.line;
+    error("Indexing is not supported by the VM");
+    return object::Null{};
+}
+
+object::Object Compiler::visit(SetIndex *expr)
+{
+    line = expr->bracket.line;
+    error("Indexing is not supported by the VM");
+    return object::Null{};
+}
+
+void Compiler::visit(ExprStmt *stmt)
+{
+    compile(stmt->expression);
+    emit(OpCode::Pop);
+}
+
+// The condition stays on the stack across the jump, so each branch starts by popping it
+void Compiler::visit(If *stmt)
+{
+    compile(stmt->condition);
+    std::size_t thenJump = emitJump(OpCode::JumpIfFalse);
+    emit(OpCode::Pop);
+    compile(stmt->thenBranch);
+    std::size_t elseJump = emitJump(OpCode::Jump);
+    patchJump(thenJump);
+    emit(OpCode::Pop);
+    compile(stmt->elseBranch);
+    patchJump(elseJump);
+}
+
+void Compiler::visit(FuncStmt *stmt)
+{
+    line = stmt->name.line;
+    declareVariable(stmt->name);
+    // A local function may refer to itself, so it is usable before its body is compiled
+    if (current->scopeDepth > 0) {
+        markInitialized();
+    }
+    function(stmt, FunctionType::Function);
+    defineVariable(stmt->name);
+}
+
+void Compiler::visit(Print *stmt)
+{
+    compile(stmt->expression);
+    emit(OpCode::Print);
+}
+
+void Compiler::visit(Return *stmt)
+{
+    line = stmt->keyword.line;
+    if (!stmt->value) {
+        emitReturn();
+        return;
+    }
+    compile(stmt->value);
+    emit(OpCode::Return);
+}
+
+void Compiler::visit(While *stmt)
+{
+    std::size_t loopStart = chunk().code.size();
+    compile(stmt->condition);
+    std::size_t exitJump = emitJump(OpCode::JumpIfFalse);
+    emit(OpCode::Pop);
+    compile(stmt->body);
+    emitLoop(loopStart);
+    patchJump(exitJump);
+    emit(OpCode::Pop);
+}
+
+void Compiler::visit(Yield *stmt)
+{
+    line = stmt->keyword.line;
+    error("Coroutines are not supported by the VM");
+}
+
+void Compiler::visit(Block *stmt)
+{
+    beginScope();
+    for (Stmt *statement : stmt->statements) {
+        compile(statement);
+    }
+    endScope();
+}
+
+void Compiler::visit(Class *stmt)
+{
+    line = stmt->name.line;
+    std::uint16_t nameConstant = identifierConstant(stmt->name);
+    declareVariable(stmt->name);
+    emit(OpCode::Class);
+    emitShort(nameConstant);
+    defineVariable(stmt->name);
+
+    ClassState classState;
+    classState.enclosing = currentClass;
+    currentClass = &classState;
+
+    if (stmt->superclass) {
+        compile(stmt->superclass);
+        // "super" is a hidden local surrounding the methods, captured as an upvalue by them
+        beginScope();
+        addLocal("super");
+        markInitialized();
+
+        getVariable(stmt->name.lexeme);
+        emit(OpCode::Inherit);
+        classState.hasSuperclass = true;
+    }
+
+    getVariable(stmt->name.lexeme);
+    for (FuncStmt *method : stmt->methods) {
+        line = method->name.line;
+        std::uint16_t constant = identifierConstant(method->name);
+        bool isInitializer = method->name.lexeme == "init";
+        function(method, isInitializer ? FunctionType::Initializer : FunctionType::Method);
+        emit(OpCode::Method);
+        emitShort(constant);
+    }
+    emit(OpCode::Pop);
+
+    if (classState.hasSuperclass) {
+        endScope();
+    }
+    currentClass = classState.enclosing;
+}
+
+void Compiler::visit(Var *stmt)
+{
+    line = stmt->name.line;
+    declareVariable(stmt->name);
+    if (stmt->initializer) {
+        compile(stmt->initializer);
+    } else {
+        emit(OpCode::Nil);
+    }
+    defineVariable(stmt->name);
+}
+
+void Compiler::compile(Expr *expr)
+{
+    if (expr) {
+        expr->accept(this);
+    } else {
+        emit(OpCode::Nil);
+    }
+}
+
+void Compiler::compile(Stmt *stmt)
+{
+    if (stmt) {
+        stmt->accept(this);
+    }
+}
+
+Chunk &Compiler::chunk()
+{
+    return current->function->chunk;
+}
+
+void Compiler::emit(std::uint8_t byte)
+{
+    chunk().write(byte, line);
+}
+
+void Compiler::emit(OpCode op)
+{
+    chunk().write(op, line);
+}
+
+void Compiler::emit(OpCode op, std::uint8_t operand)
+{
+    emit(op);
+    emit(operand);
+}
+
+void Compiler::emitShort(std::uint16_t value)
+{
+    emit(static_cast<std::uint8_t>((value >> 8) & 0xff));
+    emit(static_cast<std::uint8_t>(value & 0xff));
+}
+
+void Compiler::emitConstant(Value value)
+{
+    emit(OpCode::Constant);
+    emitShort(makeConstant(value));
+}
+
+void Compiler::emitReturn()
+{
+    if (current->type == FunctionType::Initializer) {
+        emit(OpCode::GetLocal, 0);
+    } else {
+        emit(OpCode::Nil);
+    }
+    emit(OpCode::Return);
+}
+
+std::size_t Compiler::emitJump(OpCode op)
+{
+    emit(op);
+    emit(0xff);
+    emit(0xff);
+    return chunk().code.size() - 2;
+}
+
+void Compiler::patchJump(std::size_t offset)
+{
+    // -2 to adjust for the bytecode for the jump offset itself
+    std::size_t jump = chunk().code.size() - offset - 2;
+    if (jump > std::numeric_limits<std::uint16_t>::max()) {
+        error("Too much code to jump over");
+    }
+    chunk().code[offset] = (jump >> 8) & 0xff;
+    chunk().code[offset + 1] = jump & 0xff;
+}
+
+void Compiler::emitLoop(std::size_t loopStart)
+{
+    emit(OpCode::Loop);
+    std::size_t offset = chunk().code.size() - loopStart + 2;
+    if (offset > std::numeric_limits<std::uint16_t>::max()) {
+        error("Loop body too large");
+    }
+    emitShort(static_cast<std::uint16_t>(offset));
+}
+
+std::uint16_t Compiler::makeConstant(Value value)
+{
+    std::size_t constant = chunk().addConstant(value);
+    if (constant > std::numeric_limits<std::uint16_t>::max()) {
+        error("Too many constants in one chunk");
+        return 0;
+    }
+    return static_cast<std::uint16_t>(constant);
+}
+
+std::uint16_t Compiler::makeCache()
+{
+    std::size_t cache = chunk().addCache();
+    if (cache > std::numeric_limits<std::uint16_t>::max()) {
+        error("Too many property accesses in one chunk");
+        return 0;
+    }
+    return static_cast<std::uint16_t>(cache);
+}
+
+std::uint16_t Compiler::identifierConstant(const Token &name)
+{
+    return makeConstant(Value::object(heap.makeString(name.lexeme)));
+}
+
+void Compiler::beginFunction(FunctionState &state, FunctionType type, const Token *name)
+{
+    state.enclosing = current;
+    state.function = heap.make<ObjFunction>();
+    state.type = type;
+    current = &state;
+    if (name) {
+        state.function->name = heap.makeString(name->lexeme);
+    }
+
+    // Slot zero holds the callee, or the receiver for methods
+    Local local;
+    local.depth = 0;
+    if (type == FunctionType::Method or type == FunctionType::Initializer) {
+        local.name = "this";
+    }
+    current->locals.emplace_back(std::move(local));
+}
+
+ObjFunction *Compiler::endFunction()
+{
+    emitReturn();
+    ObjFunction *function = current->function;
+    function->upvalueCount = static_cast<int>(current->upvalues.size());
+    current = current->enclosing;
+    return function;
+}
+
+void Compiler::function(FuncStmt *stmt, FunctionType type)
+{
+    FunctionState state;
+    beginFunction(state, type, &stmt->name);
+    beginScope();
+
+    for (const Token &param : stmt->params) {
+        current->function->arity++;
+        declareVariable(param);
+        defineVariable(param);
+    }
+    for (Stmt *statement : stmt->body) {
+        compile(statement);
+    }
+    ObjFunction *function = endFunction();
+
+    emit(OpCode::Closure);
+    emitShort(makeConstant(Value::object(function)));
+    for (const Upvalue &upvalue : state.upvalues) {
+        emit(upvalue.isLocal ? 1 : 0);
+        emit(upvalue.index);
+    }
+}
+
+void Compiler::beginScope()
+{
+    current->scopeDepth++;
+}
+
+void Compiler::endScope()
+{
+    current->scopeDepth--;
+    auto &locals = current->locals;
+    while (!locals.empty() and locals.back().depth > current->scopeDepth) {
+        emit(locals.back().isCaptured ? OpCode::CloseUpvalue : OpCode::Pop);
+        locals.pop_back();
+    }
+}
+
+void Compiler::addLocal(std::string_view name)
+{
+    if (current->locals.size() > std::numeric_limits<std::uint8_t>::max()) {
+        error("Too many local variables in function");
+        return;
+    }
+    Local local;
+    local.name = name;
+    current->locals.emplace_back(std::move(local));
+}
+
+void Compiler::markInitialized()
+{
+    if (current->scopeDepth == 0) {
+        return;
+    }
+    current->locals.back().depth = current->scopeDepth;
+}
+
+void Compiler::declareVariable(const Token &name)
+{
+    if (current->scopeDepth == 0) {
+        return;
+    }
+    addLocal(name.lexeme);
+}
+
+void Compiler::defineVariable(const Token &name)
+{
+    if (current->scopeDepth > 0) {
+        markInitialized();
+        return;
+    }
+    emit(OpCode::DefineGlobal);
+    emitShort(identifierConstant(name));
+}
+
+int Compiler::resolveLocal(FunctionState *state, std::string_view name)
+{
+    for (int i = static_cast<int>(state->locals.size()) - 1; i >= 0; i--) {
+        if (state->locals.at(i).name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Compiler::addUpvalue(FunctionState *state, std::uint8_t index, bool isLocal)
+{
+    auto &upvalues = state->upvalues;
+    for (std::size_t i = 0; i < upvalues.size(); ++i) {
+        if (upvalues.at(i).index == index and upvalues.at(i).isLocal == isLocal) {
+            return static_cast<int>(i);
+        }
+    }
+    if (upvalues.size() > std::numeric_limits<std::uint8_t>::max()) {
+        error("Too many closure variables in function");
+        return 0;
+    }
+    upvalues.push_back(Upvalue{index, isLocal});
+    return static_cast<int>(upvalues.size() - 1);
+}
+
+int Compiler::resolveUpvalue(FunctionState *state, std::string_view name)
+{
+    if (!state->enclosing) {
+        return -1;
+    }
+    int local = resolveLocal(state->enclosing, name);
+    if (local != -1) {
+        state->enclosing->locals.at(local).isCaptured = true;
+        return addUpvalue(state, static_cast<std::uint8_t>(local), true);
+    }
+    int upvalue = resolveUpvalue(state->enclosing, name);
+    if (upvalue != -1) {
+        return addUpvalue(state, static_cast<std::uint8_t>(upvalue), false);
+    }
+    return -1;
+}
+
+void Compiler::getVariable(std::string_view name)
+{
+    if (int slot = resolveLocal(current, name); slot != -1) {
+        emit(OpCode::GetLocal, static_cast<std::uint8_t>(slot));
+    } else if (int index = resolveUpvalue(current, name); index != -1) {
+        emit(OpCode::GetUpvalue, static_cast<std::uint8_t>(index));
+    } else {
+        emit(OpCode::GetGlobal);
+        emitShort(makeConstant(Value::object(heap.makeString(name))));
+    }
+}
+
+void Compiler::setVariable(std::string_view name)
+{
+    if (int slot = resolveLocal(current, name); slot != -1) {
+        emit(OpCode::SetLocal, static_cast<std::uint8_t>(slot));
+    } else if (int index = resolveUpvalue(current, name); index != -1) {
+        emit(OpCode::SetUpvalue, static_cast<std::uint8_t>(index));
+    } else {
+        emit(OpCode::SetGlobal);
+        emitShort(makeConstant(Value::object(heap.makeString(name))));
+    }
+}
+
+void Compiler::error(const std::string &message)
+{
+    Driver::error(line, message);
+    hadError = true;
+}
+
+}  // namespace draft::vm
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.h"
+#include "heap.h"
+
+namespace draft::vm {
+
+// Compiler walks the resolved AST once and emits bytecode for the VM. Local variables live in
+// stack slots and captured variables become upvalues, so the generated code never looks a name up
+// unless it refers to a global.
+class Compiler : public IExprVisitor<object::Object>, IStmtVisitor<void>, public Roots {
+public:
+    explicit Compiler(Heap &heap);
+    ~Compiler() override;
+
+    // Returns the top-level script function, or nullptr if compilation failed
+    ObjFunction *compile(std::span<Stmt *const> statements);
+
+    void markRoots(Heap &heap) override;
+
+private:
+    enum class FunctionType { Script, Function, Initializer, Method };
+
+    struct Local {
+        std::string_view name;
+        int depth = -1;
+        bool isCaptured = false;
+    };
+
+    struct Upvalue {
+        std::uint8_t index = 0;
+        bool isLocal = false;
+    };
+
+    struct FunctionState {
+        FunctionState *enclosing = nullptr;
+        ObjFunction *function = nullptr;
+        FunctionType type = FunctionType::Script;
+        std::vector<Local> locals;
+        std::vector<Upvalue> upvalues;
+        int scopeDepth = 0;
+    };
+
+    struct ClassState {
+        ClassState *enclosing = nullptr;
+        bool hasSuperclass = false;
+    };
+
+    object::Object visit(Literal *expr) override;
+    object::Object visit(Logical *expr) override;
+    object::Object visit(Unary *expr) override;
+    object::Object visit(Binary *expr) override;
+    object::Object visit(Call *expr) override;
+    object::Object visit(Grouping *expr) override;
+    object::Object visit(Variable *expr) override;
+    object::Object visit(Assign *expr) override;
+    object::Object visit(Get *expr) override;
+    object::Object visit(Set *expr) override;
+    object::Object visit(Super *expr) override;
+    object::Object visit(This *expr) override;
+    object::Object visit(ListExpr *expr) override;
+    object::Object visit(MapExpr *expr) override;
+    object::Object visit(GetIndex *expr) override;
+    object::Object visit(SetIndex *expr) override;
+
+    void visit(ExprStmt *stmt) override;
+    void visit(If *stmt) override;
+    void visit(FuncStmt *stmt) override;
+    void visit(Print *stmt) override;
+    void visit(Return *stmt) override;
+    void visit(While *stmt) override;
+    void visit(Yield *stmt) override;
+    void visit(Block *stmt) override;
+    void visit(Class *stmt) override;
+    void visit(Var *stmt) override;
+
+    void compile(Expr *expr);
+    void compile(Stmt *stmt);
+
+    Chunk &chunk();
+    void emit(std::uint8_t byte);
+    void emit(OpCode op);
+    void emit(OpCode op, std::uint8_t operand);
+    void emitShort(std::uint16_t value);
+    void emitConstant(Value value);
+    void emitReturn();
+    std::size_t emitJump(OpCode op);
+    void patchJump(std::size_t offset);
+    void emitLoop(std::size_t loopStart);
+    std::uint16_t makeConstant(Value value);
+    std::uint16_t makeCache();
+    std::uint16_t identifierConstant(const Token &name);
+
+    void beginFunction(FunctionState &state, FunctionType type, const Token *name);
+    ObjFunction *endFunction();
+    void function(FuncStmt *stmt, FunctionType type);
+
+    void beginScope();
+    void endScope();
+    void addLocal(std::string_view name);
+    void markInitialized();
+    void declareVariable(const Token &name);
+    void defineVariable(const Token &name);
+    int resolveLocal(FunctionState *state, std::string_view name);
+    int addUpvalue(FunctionState *state, std::uint8_t index, bool isLocal);
+    int resolveUpvalue(FunctionState *state, std::string_view name);
+    void getVariable(std::string_view name);
+    void setVariable(std::string_view name);
+
+    void error(const std::string &message);
+
+    Heap &heap;
+    FunctionState *current = nullptr;
+    ClassState *currentClass = nullptr;
+    std::size_t line = 0;
+    bool hadError = false;
+};
+
+}  // namespace draft::vm
@@ -1,14 +1,28 @@
 #include "driver.h"
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 #include "ast.h"
 #include "ast_printer.h"
+#include "bytecode_cache.h"
+#include "compiler.h"
+#include "isolate.h"
 #include "lexer.h"
+#include "optimizer.h"
 #include "parser.h"
+#include "profiler.h"
 #include "resolver.h"
 #include "source_manager.h"
+#include "source_reader.h"
 #include "token.h"
+#include "vm.h"
 
 namespace draft {
 namespace io {
@@ -45,11 +59,54 @@ void writeColoredLine(const std::string &line)
 
 }  // namespace io
 
-bool Driver::hadError = false;
+namespace {
+
+vm::VM &machine()
+{
+    thread_local vm::VM machine;
+    return machine;
+}
+
+// Unless told how many jobs to use, less source than this is parsed on the calling thread: once a thread has been started, every
+// reference count in the process is updated atomically, which costs more than a parse this small
+constexpr std::size_t ParallelBytes = 256 * 1024;
+
+// Calls `body` with each index below `count`, on up to `jobs` threads taking the next index as they
+// are done with one
+void parallelFor(std::size_t count, std::size_t jobs, const std::function<void(std::size_t)> &body)
+{
+    std::atomic<std::size_t> next = 0;
+    auto work = [&] {
+        for (std::size_t i = next++; i < count; i = next++) {
+            body(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < std::min(jobs, count); i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+}  // namespace
+
+thread_local bool Driver::hadError = false;
+thread_local const std::string *Driver::parsing = nullptr;
+thread_local std::vector<Diagnostic> *Driver::sink = nullptr;
+Driver::Options Driver::options;
+thread_local Stats Driver::stats;
+
+void Driver::configure(const Options &opts)
+{
+    options = opts;
+}
 
 int Driver::usage()
 {
-    io::writeLine("Usage: draft [filename]", std::cerr);
+    io::writeLine("Usage: draft [--engine=tree|vm] [-O0|-O1|-O2] [--max-depth=calls] [--profile[=path]] [--stats] [--output-buffer=bytes] [--jobs=threads] [--cache-dir=path] [filename...]", std::cerr);
     return exit::usage;
 }
 
@@ -68,37 +125,131 @@ void ps1()
 
 int Driver::runFile(const std::string &path)
 {
-    std::ifstream file{path, std::ios::binary};
-    if (file.fail()) {
-        io::writeLine("Can't read file: " + path, std::cerr);
-        return exit::failure;
-    }
-    std::string buffer;
-    io::read(buffer, file);
+    // A regular file is mapped and lexed in place, anything else is streamed in chunks
+    if (std::optional<Source> source = Source::map(path)) {
+        SourceManager manager;
+        auto id = manager.addSource(std::move(*source), path);
+        io::writeColoredLine("-- " + manager.getPath(id));
+        std::string_view text = manager.getSource(id).text();
 
-    run(buffer, path);
+        bool cached = options.engine == Engine::VM and !options.cacheDirectory.empty();
+        if (cached) {
+            vm::BytecodeCache cache{options.cacheDirectory};
+            if (vm::ObjFunction *script = cache.load(text, machine().heap())) {
+                machine().output().setCapacity(options.outputBuffer);
+                machine().interpret(script);
+                return exit::success;
+            }
+        }
+        Lexer lexer{text};
+        run(lexer, cached ? text : std::string_view{});
+    } else {
+        std::ifstream file{path, std::ios::binary};
+        if (file.fail()) {
+            io::writeLine("Can't read file: " + path, std::cerr);
+            return exit::failure;
+        }
+        io::writeColoredLine("-- " + path);
+        SourceReader reader{file};
+        Lexer lexer{reader};
+        run(lexer);
+    }
 
     if (hadError) {
         return exit::dataerr;
     }
+    if (options.stats) {
+        io::write(stats.report(), std::cerr);
+    }
 
     return exit::success;
 }
 
-int Driver::runPrompt()
+int Driver::runFiles(const std::vector<std::string> &paths)
+{
+    SourceManager manager;
+    std::vector<Source::Id> ids;
+    std::size_t bytes = 0;
+    for (const std::string &path : paths) {
+        std::optional<Source> source = Source::map(path);
+        if (!source) {
+            std::ifstream file{path, std::ios::binary};
+            if (file.fail()) {
+                io::writeLine("Can't read file: " + path, std::cerr);
+                return exit::failure;
+            }
+            std::string text;
+            io::read(text, file);
+            source = Source{text};
+        }
+        ids.push_back(manager.addSource(std::move(*source), path));
+        bytes += manager.getSource(ids.back()).text().size();
+        io::writeColoredLine("-- " + manager.getPath(ids.back()));
+    }
+
+    struct Unit {
+        explicit Unit(std::string_view text)
+            : lexer{text}
+            , parser{lexer}
+        {
+        }
+
+        Lexer lexer;
+        Parser parser;
+        std::vector<Stmt *> statements;
+        bool failed = false;
+    };
+    std::vector<std::unique_ptr<Unit>> units(ids.size());
+    std::size_t jobs = options.jobs;
+    if (jobs == 0) {
+        jobs = bytes < ParallelBytes ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    }
+    parallelFor(ids.size(), jobs, [&](std::size_t i) {
+        units[i] = std::make_unique<Unit>(manager.getSource(ids[i]).text());
+        parsing = &manager.getPath(ids[i]);
+        hadError = false;
+        units[i]->statements = units[i]->parser.parse();
+        units[i]->failed = hadError;
+        parsing = nullptr;
+    });
+
+    std::vector<Stmt *> statements;
+    memory::Arena::Stats arena;
+    hadError = false;
+    for (const std::unique_ptr<Unit> &unit : units) {
+        hadError = hadError or unit->failed;
+        statements.insert(statements.end(), unit->statements.begin(), unit->statements.end());
+        arena.bytesAllocated += unit->parser.arenaStats().bytesAllocated;
+        arena.blocks += unit->parser.arenaStats().blocks;
+    }
+    if (!hadError) {
+        runStatements(statements, arena);
+    }
+    // The status tells of the errors, so a later run in the process starts clean
+    if (std::exchange(hadError, false)) {
+        return exit::dataerr;
+    }
+    if (options.stats) {
+        io::write(stats.report(), std::cerr);
+    }
+    return exit::success;
+}
+
+int Driver::runPrompt(std::istream &input)
 {
     prompt();
 
+    Session session;
     std::string line;
     while (true) {
         hadError = false;  // reset error status
         ps1();
-        io::readLine(line, std::cin);
-        if (std::cin.eof()) {
+        io::readLine(line, input);
+        if (input.eof()) {
             io::writeLine("");
             break;
         }
-        run(line);
+        run(session, line);
     }
     return exit::success;
 }
@@ -112,35 +263,153 @@ void Driver::run(const std::string& buffer, const std::string &path)
         io::writeColoredLine("-- " + manager.getPath(id));
     }
 
-    Lexer lexer{buffer};
-    std::vector<Token> tokens = lexer.scanTokens();
+    Lexer lexer{manager.getSource(id).text()};
+    run(lexer);
+}
 
-    Parser parser{tokens};
+void Driver::run(Lexer &lexer, std::string_view source)
+{
+    Parser parser{lexer};
     std::vector<Stmt *> statements = parser.parse();
     if (hadError) {
         return;
     }
+    runStatements(statements, parser.arenaStats(), source);
+}
 
-    AstPrinter p;
-    for (auto stmt : statements) {
-        io::writeLine(p.print(stmt));
+void Driver::run(Session &session, const std::string &line)
+{
+    Lexer lexer{session.add(line)};
+    Parser parser{lexer, session.arena()};
+    std::vector<Stmt *> statements = parser.parse();
+    if (hadError) {
+        session.discard();
+        return;
+    }
+    runStatements(statements, session.arena().stats(), {}, &session);
+}
+
+void Driver::runStatements(std::vector<Stmt *> &statements, const memory::Arena::Stats &arena,
+                           std::string_view source, Session *session)
+{
+    if (options.cacheDirectory.empty()) {
+        AstPrinter p;
+        for (auto stmt : statements) {
+            io::writeLine(p.print(stmt));
+        }
+    }
+
+    thread_local Interpreter interpreter;
+    thread_local Resolver resolver;
+    // Only the new statements are resolved; globals are looked up by name as they run
+    resolver.resolve(statements);
+    if (hadError) {
+        if (session) {
+            session->discard();
+        }
+        return;
+    }
+
+    // Nodes made for a file are needed only while it runs
+    memory::Arena folded;
+    Optimizer optimizer{options.optimization, session ? session->arena() : folded};
+    optimizer.optimize(statements);
+
+    switch (options.engine) {
+    case Engine::TreeWalker: {
+        std::optional<Profiler> profiler;
+        if (!options.profile.empty()) {
+            profiler.emplace(options.profile);
+        }
+        interpreter.setMaxDepth(options.maxCallDepth);
+        interpreter.getOutput().setCapacity(options.outputBuffer);
+        interpreter.setProfiler(profiler ? &*profiler : nullptr);
+        if (options.stats) {
+            stats = Stats{};
+            stats.arenaBytes = arena.bytesAllocated;
+            stats.arenaBlocks = arena.blocks;
+            interpreter.setStats(&stats);
+        }
+        std::optional<RuntimeError> failure = interpreter.run(statements);
+        interpreter.setProfiler(nullptr);
+        interpreter.setStats(nullptr);
+        if (failure) {
+            error(failure->token.line, failure->what());
+            // A program ends with its first runtime error, when its counters tell the most
+            if (!session) {
+                if (options.stats) {
+                    io::write(stats.report(), std::cerr);
+                }
+                std::exit(exit::software);
+            }
+        }
+        Isolate::joinAll();
+        break;
+    }
+    case Engine::VM: {
+        vm::Compiler compiler{machine().heap()};
+        vm::ObjFunction *script = compiler.compile(statements);
+        if (script) {
+            if (!source.empty()) {
+                vm::BytecodeCache{options.cacheDirectory}.store(source, script);
+            }
+            machine().output().setCapacity(options.outputBuffer);
+            if (!session) {
+                machine().interpret(script);
+            } else if (std::optional<vm::VM::Error> failure = machine().run(script)) {
+                error(failure->line, failure->what());
+            }
+        }
+        break;
     }
+    }
+}
 
-    static Interpreter interpreter;
-    static Resolver resolver{&interpreter};
+void Driver::interpret(std::string_view source, Interpreter &interpreter)
+{
+    Lexer lexer{source};
+    Parser parser{lexer};
+    std::vector<Stmt *> statements = parser.parse();
+    if (hadError) {
+        return;
+    }
+    Resolver resolver;
     resolver.resolve(statements);
-    interpreter.interpret(statements);
+    if (hadError) {
+        return;
+    }
+    Optimizer optimizer{options.optimization};
+    optimizer.optimize(statements);
+
+    interpreter.setMaxDepth(options.maxCallDepth);
+    interpreter.getOutput().setCapacity(options.outputBuffer);
+    if (std::optional<RuntimeError> failure = interpreter.run(statements)) {
+        error(failure->token.line, failure->what());
+    }
 }
 
 void Driver::error(std::size_t line, const std::string &message)
 {
+    if (sink) {
+        sink->push_back({line, message});
+        return;
+    }
     report(line, "", message);
     hadError = true;
 }
 
+void Driver::collectErrors(std::vector<Diagnostic> *sink)
+{
+    Driver::sink = sink;
+}
+
 void Driver::report(std::size_t line, const std::string &where, const std::string &message)
 {
-    io::writeLine("[line " + std::to_string(line) + "] Error " + where + ": " + message, std::cerr);
+    // Files parsed at once, and isolates, report from several threads
+    static std::mutex mutex;
+    std::string in = parsing ? " in " + *parsing : "";
+    std::lock_guard lock{mutex};
+    io::writeLine("[line " + std::to_string(line) + in + "] Error " + where + ": " + message, std::cerr);
 }
 
 }  // namespace draft
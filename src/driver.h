@@ -1,8 +1,12 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
+#include "arena.h"
 #include "interpreter.h"
+#include "lexer.h"
+#include "session.h"
 
 namespace draft {
 
@@ -22,21 +26,83 @@ void writeLine(std::string_view line, std::ostream &stream = std::cout);
 void writeColoredLine(const std::string &line);
 }  // namespace io
 
+// An error found in a program, for a host that takes errors as values rather than on stderr
+struct Diagnostic {
+    std::size_t line = 0;
+    std::string message;
+};
+
 class Driver {
 public:
+    // Tree-walking Interpreter is the reference engine, the bytecode VM is the fast one
+    enum class Engine { TreeWalker, VM };
+
+    struct Options {
+        Engine engine = Engine::TreeWalker;
+        // Where the VM keeps compiled scripts between runs, caching is off when empty. A cached
+        // run has no AST, so the AST listing is left out whenever the cache is on
+        std::string cacheDirectory;
+        // Optimizer level the resolved program goes through before it runs, see Optimizer
+        int optimization = 1;
+        // Deepest nesting of tree-walker calls before a "Stack overflow" error; tail calls don't nest.
+        // The native and value stacks are sized after it, the native one up to 1 GiB, which bounds
+        // the depth that can be reached near 260 000 calls
+        std::size_t maxCallDepth = Interpreter::DefaultMaxDepth;
+        // Where the tree-walker's profile is written as folded stacks, no profiling when empty
+        std::string profile;
+        // Whether the tree-walker counts what it does, see Stats; runFile reports it at exit
+        bool stats = false;
+        // Bytes of print output either engine collects before writing them, 0 writes every line
+        std::size_t outputBuffer = Output::DefaultCapacity;
+        // Threads parsing the files of runFiles, 1 for none but the caller's. With 0 a large program
+        // gets one per core and a small one is parsed serially
+        std::size_t jobs = 0;
+    };
+
+    static void configure(const Options &options);
+
     static int usage();
 
     static int runFile(const std::string &path);
+    // Runs the files as one program, their statements in the order of `paths`. They are lexed and
+    // parsed concurrently, each by a Parser and arena of its own, then resolved together
+    static int runFiles(const std::vector<std::string> &paths);
 
-    static int runPrompt();
+    // Reads and runs a line at a time in one Session: what a line declares stays for the lines
+    // after it, and a line with an error is reported and left out
+    static int runPrompt(std::istream &input = std::cin);
 
     static void error(std::size_t line, const std::string &message);
+    // Until called again with nullptr, the errors the calling thread reports are added to `sink`
+    // rather than printed, and leave no trace on the runs that follow
+    static void collectErrors(std::vector<Diagnostic> *sink);
     static void report(std::size_t line, const std::string &where, const std::string &message);
 
     static void run(const std::string& buffer, const std::string &path = "");
 
+    // Parses, resolves, optimizes and runs `source` in `interpreter` on the calling thread, without
+    // the AST listing, profiler or stats; how an isolate runs its program. A runtime error is
+    // reported and ends the run, not the process
+    static void interpret(std::string_view source, Interpreter &interpreter);
+
 private:
-    static bool hadError;
+    // With a `source`, the compiled script is stored in the cache under that text
+    static void run(Lexer &lexer, std::string_view source = {});
+    // A line of the prompt, compiled into the session's arena
+    static void run(Session &session, const std::string &line);
+    // Statements of a `session` keep the nodes the optimizer makes in its arena, and a runtime error
+    // ends only them
+    static void runStatements(std::vector<Stmt *> &statements, const memory::Arena::Stats &arena,
+                              std::string_view source = {}, Session *session = nullptr);
+
+    // Each isolate's thread parses and fails on its own, options are shared by all of them
+    static thread_local bool hadError;
+    // File the calling thread is parsing, named in the errors it reports; none for a single file
+    static thread_local const std::string *parsing;
+    static thread_local std::vector<Diagnostic> *sink;
+    static Options options;
+    // Counters of the last run, when options.stats is on
+    static thread_local Stats stats;
 };
 
 }  // namespace draft
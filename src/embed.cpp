@@ -0,0 +1,107 @@
+#include "embed.h"
+
+#include <algorithm>
+
+#include "optimizer.h"
+#include "resolver.h"
+
+namespace draft::embed {
+
+namespace {
+
+Result failed(const RuntimeError &error)
+{
+    return Result{object::Null{}, {Error{error.token.line, error.what()}}};
+}
+
+}  // namespace
+
+Program::Program(std::string source)
+    : source{std::move(source)}
+{
+}
+
+Program::~Program() = default;
+
+std::shared_ptr<const Program> Program::compile(std::string source, int optimization)
+{
+    std::shared_ptr<Program> program{new Program{std::move(source)}};
+    Driver::collectErrors(&program->problems);
+    program->lexer = std::make_unique<Lexer>(std::string_view{program->source});
+    program->parser = std::make_unique<Parser>(*program->lexer, program->nodes);
+    program->statements = program->parser->parse();
+    if (program->ok()) {
+        Resolver{}.resolve(program->statements);
+    }
+    if (program->ok()) {
+        Optimizer{optimization, program->nodes}.optimize(program->statements);
+    }
+    Driver::collectErrors(nullptr);
+    return program;
+}
+
+Context::Context(std::ostream &output)
+    : machine{output}
+{
+}
+
+Result Context::run(const ProgramPtr &program)
+{
+    if (!program->ok()) {
+        return Result{object::Null{}, program->errors()};
+    }
+    // Functions the program declares point into its tree
+    if (std::find(programs.begin(), programs.end(), program) == programs.end()) {
+        programs.push_back(program);
+    }
+    if (std::optional<RuntimeError> error = machine.run(program->statements)) {
+        return failed(*error);
+    }
+    return Result{};
+}
+
+const object::Object *Context::global(std::string_view name) const
+{
+    return machine.getGlobal(name);
+}
+
+object::CallablePtr Context::function(std::string_view name) const
+{
+    const object::Object *value = global(name);
+    auto callable = value ? std::get_if<object::CallablePtr>(value) : nullptr;
+    return callable ? *callable : nullptr;
+}
+
+Result Context::callWith(std::string_view name, object::Arguments arguments)
+{
+    const object::Object *value = global(name);
+    if (!value) {
+        return Result{object::Null{}, {Error{0, "Undefined variable '" + std::string{name} + "'"}}};
+    }
+    Result result;
+    if (std::optional<RuntimeError> error = machine.call(*value, arguments, result.value)) {
+        return failed(*error);
+    }
+    return result;
+}
+
+Result Context::callWith(const object::CallablePtr &function, object::Arguments arguments)
+{
+    Result result;
+    if (std::optional<RuntimeError> error = machine.call(function, arguments, result.value)) {
+        return failed(*error);
+    }
+    return result;
+}
+
+void Context::define(std::string_view name, object::CallablePtr function)
+{
+    machine.defineNative(name, std::move(function));
+}
+
+Interpreter &Context::interpreter()
+{
+    return machine;
+}
+
+}  // namespace draft::embed
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "driver.h"
+#include "interpreter.h"
+
+// What a program embedding Draft uses: compile a source once, then run it and call the functions
+// it declares as often as needed, with errors coming back as values
+namespace draft::embed {
+
+using Error = Diagnostic;
+
+// What running a program or calling a function came to: its value, or the errors that stopped it
+struct Result {
+    object::Object value;
+    std::vector<Error> errors;
+
+    bool ok() const
+    {
+        return errors.empty();
+    }
+};
+
+// A source lexed, parsed, resolved and optimized once, to be run any number of times. The syntax
+// tree lives as long as the program, which a Context keeps alive once it has run it
+class Program {
+public:
+    static std::shared_ptr<const Program> compile(std::string source, int optimization = 1);
+
+    bool ok() const
+    {
+        return problems.empty();
+    }
+    const std::vector<Error> &errors() const
+    {
+        return problems;
+    }
+
+    ~Program();
+
+private:
+    explicit Program(std::string source);
+
+    // The tokens and nodes view the text. The nodes the parser and the optimizer make live in the
+    // program's arena
+    std::string source;
+    memory::Arena nodes;
+    std::unique_ptr<Lexer> lexer;
+    std::unique_ptr<Parser> parser;
+    std::vector<Stmt *> statements;
+    std::vector<Error> problems;
+
+    friend class Context;
+};
+
+using ProgramPtr = std::shared_ptr<const Program>;
+
+// A Draft value for a C++ one: numbers, booleans, strings and nullptr convert, Objects stay as
+// they are
+template <typename T>
+object::Object toObject(T &&value)
+{
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool>) {
+        return object::Boolean{value};
+    } else if constexpr (std::is_arithmetic_v<U>) {
+        return static_cast<object::Number>(value);
+    } else if constexpr (std::is_same_v<U, std::nullptr_t>) {
+        return object::Null{};
+    } else if constexpr (std::is_convertible_v<U, std::string_view>) {
+        return object::String{std::string_view{value}};
+    } else {
+        return object::Object{std::forward<T>(value)};
+    }
+}
+
+// An interpreter whose globals stay from one run or call to the next, so a program that declares
+// functions is run once and its functions called per request. What print writes goes to `output`
+class Context {
+public:
+    explicit Context(std::ostream &output = std::cout);
+
+    Result run(const ProgramPtr &program);
+
+    // The global `name`, nullptr if nothing has that name
+    const object::Object *global(std::string_view name) const;
+    // The function a global holds, nullptr if it holds none; looked up once, it can be called any
+    // number of times
+    object::CallablePtr function(std::string_view name) const;
+
+    // Calls a global function with C++ arguments. They are converted by toObject into an array on
+    // the native stack, which the callee views
+    template <typename... Args>
+    Result call(std::string_view name, Args &&...arguments)
+    {
+        std::array<object::Object, sizeof...(Args)> values{toObject(std::forward<Args>(arguments))...};
+        return callWith(name, values);
+    }
+    template <typename... Args>
+    Result call(const object::CallablePtr &function, Args &&...arguments)
+    {
+        std::array<object::Object, sizeof...(Args)> values{toObject(std::forward<Args>(arguments))...};
+        return callWith(function, values);
+    }
+    Result callWith(std::string_view name, object::Arguments arguments);
+    Result callWith(const object::CallablePtr &function, object::Arguments arguments);
+
+    // Natives of the host, as Interpreter::defineNative
+    void define(std::string_view name, object::CallablePtr function);
+    Interpreter &interpreter();
+
+private:
+    Interpreter machine;
+    std::vector<ProgramPtr> programs;
+};
+
+}  // namespace draft::embed
@@ -9,52 +9,68 @@ Environment::Environment(EnvironmentPtr enclosing)
 {
 }
 
-void Environment::define(const std::string &name, const object::Object &value)
+void Environment::define(std::string_view name, const object::Object &value)
 {
-    values[name] = value;
+    values.insert_or_assign(std::string{name}, value);
 }
 
-object::Object Environment::get(Token name)
+void Environment::define(const object::Object &value)
 {
-    if (values.contains(name.lexeme)) {
-        return values.at(name.lexeme);
-    }
-    if (enclosing) {
-        return enclosing->get(name);
+    slots.push_back(value);
+}
+
+void Environment::reset(EnvironmentPtr parent)
+{
+    slots.clear();
+    enclosing = std::move(parent);
+}
+
+object::Object Environment::get(const Token &name)
+{
+    if (auto it = values.find(name.lexeme); it != values.end()) {
+        return it->second;
     }
-    throw RuntimeError{name, "Undefined variable '" + name.lexeme + ";"};
+    throw RuntimeError{name, "Undefined variable '" + std::string{name.lexeme} + "'"};
 }
 
-object::Object Environment::getAt(int distance, std::string name)
+const object::Object *Environment::find(std::string_view name) const
 {
-    return ancestor(distance)->values.at(name);
+    auto it = values.find(name);
+    return it != values.end() ? &it->second : nullptr;
 }
 
-EnvironmentPtr Environment::ancestor(int distance)
+const object::Object &Environment::getAt(Slot slot)
 {
-    EnvironmentPtr env = shared_from_this();
+    return ancestor(slot.depth)->slots[slot.index];
+}
+
+object::Object &Environment::at(Slot slot)
+{
+    return ancestor(slot.depth)->slots[slot.index];
+}
+
+// Walks raw pointers: the chain is kept alive by the environment we start from
+Environment *Environment::ancestor(int distance)
+{
+    Environment *env = this;
     for (int i = 0; i < distance; i++) {
-        env = env->enclosing;
+        env = env->enclosing.get();
     }
     return env;
 }
 
 void Environment::assign(const Token &name, const object::Object &value)
 {
-    if (values.contains(name.lexeme)) {
-        values[name.lexeme] = value;
-        return;
-    }
-    if (enclosing) {
-        enclosing->assign(name, value);
+    if (auto it = values.find(name.lexeme); it != values.end()) {
+        it->second = value;
         return;
     }
-    throw RuntimeError{name, "Undefined variable '" + name.lexeme + "'"};
+    throw RuntimeError{name, "Undefined variable '" + std::string{name.lexeme} + "'"};
 }
 
-void Environment::assignAt(int distance, const Token &name, const object::Object &value)
+void Environment::assignAt(Slot slot, const object::Object &value)
 {
-    ancestor(distance)->values[name.lexeme] = value;
+    ancestor(slot.depth)->slots[slot.index] = value;
 }
 
 }  // namespace draft
@@ -4,7 +4,10 @@
 
 #include <map>
 #include <memory>
+#include <string_view>
+#include <vector>
 
+#include "ast.h"
 #include "token.h"
 
 namespace draft {
@@ -12,21 +15,34 @@ namespace draft {
 class Environment;
 using EnvironmentPtr = std::shared_ptr<Environment>;
 
-class Environment : public std::enable_shared_from_this<Environment> {
+// The global environment binds names, every nested environment stores its variables in slots in
+// declaration order, which is the order the Resolver numbers them in
+class Environment {
 public:
     Environment() = default;
     explicit Environment(EnvironmentPtr enclosing);
-    void define(const std::string &name, const object::Object &value);
 
-    object::Object get(Token name);
-    object::Object getAt(int distance, std::string name);
-    EnvironmentPtr ancestor(int distance);
+    void define(std::string_view name, const object::Object &value);
+    void define(const object::Object &value);
+
+    object::Object get(const Token &name);
+    // The value bound to `name` here, nullptr when there is none
+    const object::Object *find(std::string_view name) const;
+    const object::Object &getAt(Slot slot);
+    object::Object &at(Slot slot);
     void assign(const Token &name, const object::Object &value);
-    void assignAt(int distance, const Token &name, const object::Object &value);
+    void assignAt(Slot slot, const object::Object &value);
+
+    // Empties the environment for reuse under a new parent, keeping the slots' storage
+    void reset(EnvironmentPtr parent);
 
     EnvironmentPtr enclosing = nullptr;
+
 private:
-    std::map<std::string, object::Object> values;
+    Environment *ancestor(int distance);
+
+    std::map<std::string, object::Object, std::less<>> values;
+    std::vector<object::Object> slots;
 };
 
 }  // namespace draft
@@ -0,0 +1,533 @@
+#include "flat_ast.h"
+
+#include <type_traits>
+#include <unordered_map>
+
+namespace draft {
+
+static_assert(std::is_trivially_copyable_v<FlatAst::Node>);
+static_assert(std::is_trivially_copyable_v<FlatAst::FlatToken>);
+static_assert(std::is_trivially_copyable_v<FlatAst::Constant>);
+static_assert(std::is_trivially_copyable_v<Slot>);
+static_assert(sizeof(FlatAst::Node) == 16);
+
+// Walks the pointer AST once, appending every node after its children
+class FlatAst::Builder : public IExprVisitor<object::Object>, public IStmtVisitor<void> {
+public:
+    explicit Builder(FlatAst &ast)
+        : ast{ast}
+    {
+    }
+
+    Index add(Expr *expr)
+    {
+        if (!expr) {
+            return None;
+        }
+        expr->accept(static_cast<IExprVisitor<object::Object> *>(this));
+        return last;
+    }
+
+    Index add(Stmt *stmt)
+    {
+        if (!stmt) {
+            return None;
+        }
+        stmt->accept(static_cast<IStmtVisitor<void> *>(this));
+        return last;
+    }
+
+private:
+    object::Object visit(Literal *expr) override
+    {
+        Constant constant;
+        if (auto boolean = std::get_if<object::Boolean>(&expr->value)) {
+            constant.type = Constant::Type::Boolean;
+            constant.boolean = *boolean;
+        } else if (auto number = std::get_if<object::Number>(&expr->value)) {
+            constant.type = Constant::Type::Number;
+            constant.number = *number;
+        } else if (auto string = std::get_if<object::String>(&expr->value)) {
+            constant.type = Constant::Type::String;
+            constant.offset = intern(*string);
+            constant.length = static_cast<std::uint32_t>(string->size());
+        }
+        ast.constants.push_back(constant);
+        return node(Kind::Literal, None, static_cast<Index>(ast.constants.size() - 1));
+    }
+
+    object::Object visit(Logical *expr) override
+    {
+        Index left = add(expr->left);
+        Index right = add(expr->right);
+        return node(Kind::Logical, token(expr->op), left, right);
+    }
+
+    object::Object visit(Unary *expr) override
+    {
+        Index right = add(expr->right);
+        return node(Kind::Unary, token(expr->op), right);
+    }
+
+    object::Object visit(Binary *expr) override
+    {
+        Index left = add(expr->left);
+        Index right = add(expr->right);
+        return node(Kind::Binary, token(expr->op), left, right);
+    }
+
+    object::Object visit(Call *expr) override
+    {
+        Index callee = add(expr->callee);
+        std::vector<Index> arguments;
+        for (Expr *argument : expr->arguments) {
+            arguments.push_back(add(argument));
+        }
+        return node(Kind::Call, token(expr->paren), callee, list(arguments));
+    }
+
+    object::Object visit(Grouping *expr) override
+    {
+        Index expression = add(expr->expression);
+        return node(Kind::Grouping, None, expression);
+    }
+
+    object::Object visit(Variable *expr) override
+    {
+        return node(Kind::Variable, token(expr->name), slot(expr->slot));
+    }
+
+    object::Object visit(Assign *expr) override
+    {
+        Index value = add(expr->value);
+        return node(Kind::Assign, token(expr->name), value, slot(expr->slot));
+    }
+
+    object::Object visit(Get *expr) override
+    {
+        Index object = add(expr->object);
+        return node(Kind::Get, token(expr->name), object);
+    }
+
+    object::Object visit(Set *expr) override
+    {
+        Index object = add(expr->object);
+        Index value = add(expr->value);
+        return node(Kind::Set, token(expr->name), object, value);
+    }
+
+    object::Object visit(Super *expr) override
+    {
+        return node(Kind::Super, token(expr->keyword), token(expr->method), slot(expr->slot));
+    }
+
+    object::Object visit(This *expr) override
+    {
+        return node(Kind::This, token(expr->keyword), slot(expr->slot));
+    }
+
+    object::Object visit(ListExpr *expr) override
+    {
+        std::vector<Index> elements;
+        for (Expr *element : expr->elements) {
+            elements.push_back(add(element));
+        }
+        return node(Kind::ListExpr, token(expr->bracket), list(elements));
+    }
+
+    object::Object visit(MapExpr *expr) override
+    {
+        std::vector<Index> keys;
+        std::vector<Index> values;
+        for (std::size_t i = 0; i < expr->keys.size(); i++) {
+            keys.push_back(add(expr->keys[i]));
+            values.push_back(add(expr->values[i]));
+        }
+        Index start = list(keys);
+        list(values);
+        return node(Kind::MapExpr, token(expr->brace), start);
+    }
+
+    object::Object visit(GetIndex *expr) override
+    {
+        Index object = add(expr->object);
+        Index index = add(expr->index);
+        return node(Kind::GetIndex, token(expr->bracket), object, index);
+    }
+
+    object::Object visit(SetIndex *expr) override
+    {
+        Index object = add(expr->object);
+        std::array<Index, 2> operands{add(expr->index), add(expr->value)};
+        auto start = static_cast<Index>(ast.extra.size());
+        ast.extra.insert(ast.extra.end(), operands.begin(), operands.end());
+        return node(Kind::SetIndex, token(expr->bracket), object, start);
+    }
+
+    void visit(ExprStmt *stmt) override
+    {
+        Index expression = add(stmt->expression);
+        node(Kind::ExprStmt, None, expression);
+    }
+
+    void visit(If *stmt) override
+    {
+        Index condition = add(stmt->condition);
+        std::array<Index, 2> branches{add(stmt->thenBranch), add(stmt->elseBranch)};
+        auto start = static_cast<Index>(ast.extra.size());
+        ast.extra.insert(ast.extra.end(), branches.begin(), branches.end());
+        node(Kind::If, None, condition, start);
+    }
+
+    void visit(FuncStmt *stmt) override
+    {
+        std::vector<Index> params;
+        for (const Token &param : stmt->params) {
+            params.push_back(token(param));
+        }
+        std::vector<Index> body;
+        for (Stmt *statement : stmt->body) {
+            body.push_back(add(statement));
+        }
+        Index start = list(params);
+        list(body);
+        node(Kind::FuncStmt, token(stmt->name), start, stmt->generator ? 1 : 0);
+    }
+
+    void visit(Print *stmt) override
+    {
+        Index expression = add(stmt->expression);
+        node(Kind::Print, None, expression);
+    }
+
+    void visit(Return *stmt) override
+    {
+        Index value = add(stmt->value);
+        node(Kind::Return, token(stmt->keyword), value);
+    }
+
+    void visit(While *stmt) override
+    {
+        Index condition = add(stmt->condition);
+        Index body = add(stmt->body);
+        node(Kind::While, None, condition, body);
+    }
+
+    void visit(Yield *stmt) override
+    {
+        Index value = add(stmt->value);
+        node(Kind::Yield, token(stmt->keyword), value);
+    }
+
+    void visit(Block *stmt) override
+    {
+        std::vector<Index> statements;
+        for (Stmt *statement : stmt->statements) {
+            statements.push_back(add(statement));
+        }
+        node(Kind::Block, None, list(statements), stmt->scoped ? 1 : 0);
+    }
+
+    void visit(Class *stmt) override
+    {
+        Index superclass = add(stmt->superclass);
+        std::vector<Index> methods;
+        for (FuncStmt *method : stmt->methods) {
+            methods.push_back(add(method));
+        }
+        node(Kind::Class, token(stmt->name), superclass, list(methods));
+    }
+
+    void visit(Var *stmt) override
+    {
+        Index initializer = add(stmt->initializer);
+        node(Kind::Var, token(stmt->name), initializer);
+    }
+
+    object::Object node(Kind kind, Index token, Index lhs = None, Index rhs = None)
+    {
+        ast.nodes.push_back(Node{kind, token, lhs, rhs});
+        last = static_cast<Index>(ast.nodes.size() - 1);
+        return object::Null{};
+    }
+
+    // Children are in place before the list starts, so the lists of nested nodes never interleave
+    Index list(const std::vector<Index> &indices)
+    {
+        auto start = static_cast<Index>(ast.extra.size());
+        ast.extra.push_back(static_cast<Index>(indices.size()));
+        ast.extra.insert(ast.extra.end(), indices.begin(), indices.end());
+        return start;
+    }
+
+    Index token(const Token &token)
+    {
+        ast.tokens.push_back(FlatToken{intern(token.lexeme), static_cast<std::uint32_t>(token.lexeme.size()),
+                                       token.line, token.kind});
+        return static_cast<Index>(ast.tokens.size() - 1);
+    }
+
+    Index slot(const Slot &slot)
+    {
+        ast.slots.push_back(slot);
+        return static_cast<Index>(ast.slots.size() - 1);
+    }
+
+    // Identifiers repeat a lot, so each distinct text is stored once
+    std::uint32_t intern(std::string_view chars)
+    {
+        auto [it, inserted] = offsets.try_emplace(chars, static_cast<std::uint32_t>(ast.text.size()));
+        if (inserted) {
+            ast.text.insert(ast.text.end(), chars.begin(), chars.end());
+        }
+        return it->second;
+    }
+
+    FlatAst &ast;
+    Index last = None;
+    // Keys view the program being flattened, which outlives the builder
+    std::unordered_map<std::string_view, std::uint32_t> offsets;
+};
+
+namespace {
+
+// Rebuilds node objects from the flat arrays for the pointer-based visitors
+class Expander {
+public:
+    Expander(const FlatAst &ast, memory::Arena &arena)
+        : ast{ast}
+        , arena{arena}
+    {
+    }
+
+    Expr *expr(FlatAst::Index index)
+    {
+        if (index == FlatAst::None) {
+            return nullptr;
+        }
+        using Kind = FlatAst::Kind;
+        const FlatAst::Node &node = ast.node(index);
+        switch (node.kind) {
+        case Kind::Literal:
+            return arena.make<Literal>(ast.constant(node.lhs));
+        case Kind::Logical:
+            return arena.make<Logical>(expr(node.lhs), ast.token(node.token), expr(node.rhs));
+        case Kind::Unary:
+            return arena.make<Unary>(ast.token(node.token), expr(node.lhs));
+        case Kind::Binary:
+            return arena.make<Binary>(expr(node.lhs), ast.token(node.token), expr(node.rhs));
+        case Kind::Call: {
+            Expr *callee = expr(node.lhs);
+            AstList<Expr *> arguments{&arena};
+            for (FlatAst::Index argument : ast.list(node.rhs)) {
+                arguments.push_back(expr(argument));
+            }
+            return arena.make<Call>(callee, ast.token(node.token), std::move(arguments));
+        }
+        case Kind::Grouping:
+            return arena.make<Grouping>(expr(node.lhs));
+        case Kind::Variable: {
+            auto variable = arena.make<Variable>(ast.token(node.token));
+            variable->slot = ast.slot(node.lhs);
+            return variable;
+        }
+        case Kind::Assign: {
+            auto assign = arena.make<Assign>(ast.token(node.token), expr(node.lhs));
+            assign->slot = ast.slot(node.rhs);
+            return assign;
+        }
+        case Kind::Get:
+            return arena.make<Get>(expr(node.lhs), ast.token(node.token));
+        case Kind::Set:
+            return arena.make<Set>(expr(node.lhs), ast.token(node.token), expr(node.rhs));
+        case Kind::Super: {
+            auto super = arena.make<Super>(ast.token(node.token), ast.token(node.lhs));
+            super->slot = ast.slot(node.rhs);
+            return super;
+        }
+        case Kind::This: {
+            auto self = arena.make<This>(ast.token(node.token));
+            self->slot = ast.slot(node.lhs);
+            return self;
+        }
+        case Kind::ListExpr: {
+            AstList<Expr *> elements{&arena};
+            for (FlatAst::Index element : ast.list(node.lhs)) {
+                elements.push_back(expr(element));
+            }
+            return arena.make<ListExpr>(ast.token(node.token), std::move(elements));
+        }
+        case Kind::MapExpr: {
+            std::span<const FlatAst::Index> keyIndices = ast.list(node.lhs);
+            AstList<Expr *> keys{&arena};
+            for (FlatAst::Index key : keyIndices) {
+                keys.push_back(expr(key));
+            }
+            AstList<Expr *> values{&arena};
+            for (FlatAst::Index value : ast.list(node.lhs + 1 + static_cast<FlatAst::Index>(keyIndices.size()))) {
+                values.push_back(expr(value));
+            }
+            return arena.make<MapExpr>(ast.token(node.token), std::move(keys), std::move(values));
+        }
+        case Kind::GetIndex:
+            return arena.make<GetIndex>(expr(node.lhs), ast.token(node.token), expr(node.rhs));
+        case Kind::SetIndex:
+            return arena.make<SetIndex>(expr(node.lhs), ast.token(node.token), expr(ast.extraAt(node.rhs)),
+                                        expr(ast.extraAt(node.rhs + 1)));
+        default:
+            return nullptr;
+        }
+    }
+
+    Stmt *stmt(FlatAst::Index index)
+    {
+        if (index == FlatAst::None) {
+            return nullptr;
+        }
+        using Kind = FlatAst::Kind;
+        const FlatAst::Node &node = ast.node(index);
+        switch (node.kind) {
+        case Kind::ExprStmt:
+            return arena.make<ExprStmt>(expr(node.lhs));
+        case Kind::If:
+            return arena.make<If>(expr(node.lhs), stmt(ast.extraAt(node.rhs)), stmt(ast.extraAt(node.rhs + 1)));
+        case Kind::FuncStmt:
+            return function(index);
+        case Kind::Print:
+            return arena.make<Print>(expr(node.lhs));
+        case Kind::Return:
+            return arena.make<Return>(ast.token(node.token), expr(node.lhs));
+        case Kind::While:
+            return arena.make<While>(expr(node.lhs), stmt(node.rhs));
+        case Kind::Yield:
+            return arena.make<Yield>(ast.token(node.token), expr(node.lhs));
+        case Kind::Block: {
+            // A block the optimizer emptied of its declarations still has the scope it was resolved with
+            auto block = arena.make<Block>(statements(node.lhs));
+            block->scoped = node.rhs != 0;
+            return block;
+        }
+        case Kind::Class: {
+            auto superclass = static_cast<Variable *>(expr(node.lhs));
+            AstList<FuncStmt *> methods{&arena};
+            for (FlatAst::Index method : ast.list(node.rhs)) {
+                methods.push_back(function(method));
+            }
+            return arena.make<Class>(ast.token(node.token), superclass, std::move(methods));
+        }
+        case Kind::Var:
+            return arena.make<Var>(ast.token(node.token), expr(node.lhs));
+        default:
+            return nullptr;
+        }
+    }
+
+private:
+    FuncStmt *function(FlatAst::Index index)
+    {
+        const FlatAst::Node &node = ast.node(index);
+        std::span<const FlatAst::Index> tokens = ast.list(node.lhs);
+        AstList<Token> params{&arena};
+        for (FlatAst::Index param : tokens) {
+            params.push_back(ast.token(param));
+        }
+        auto body = statements(node.lhs + 1 + static_cast<FlatAst::Index>(tokens.size()));
+        auto function = arena.make<FuncStmt>(ast.token(node.token), std::move(params), std::move(body));
+        function->generator = node.rhs != 0;
+        return function;
+    }
+
+    AstList<Stmt *> statements(FlatAst::Index start)
+    {
+        AstList<Stmt *> statements{&arena};
+        for (FlatAst::Index statement : ast.list(start)) {
+            statements.push_back(stmt(statement));
+        }
+        return statements;
+    }
+
+    const FlatAst &ast;
+    memory::Arena &arena;
+};
+
+}  // namespace
+
+FlatAst FlatAst::flatten(std::span<Stmt *const> statements)
+{
+    FlatAst ast;
+    Builder builder{ast};
+    for (Stmt *statement : statements) {
+        ast.roots.push_back(builder.add(statement));
+    }
+    return ast;
+}
+
+std::vector<Stmt *> FlatAst::expand(memory::Arena &arena) const
+{
+    Expander expander{*this, arena};
+    std::vector<Stmt *> statements;
+    statements.reserve(roots.size());
+    for (Index root : roots) {
+        statements.push_back(expander.stmt(root));
+    }
+    return statements;
+}
+
+std::span<const FlatAst::Index> FlatAst::statements() const
+{
+    return roots;
+}
+
+const FlatAst::Node &FlatAst::node(Index index) const
+{
+    return nodes[index];
+}
+
+Token FlatAst::token(Index index) const
+{
+    const FlatToken &token = tokens[index];
+    return Token{token.kind, textAt(token.offset, token.length), token.line};
+}
+
+std::span<const FlatAst::Index> FlatAst::list(Index start) const
+{
+    return std::span<const Index>{extra}.subspan(start + 1, extra[start]);
+}
+
+FlatAst::Index FlatAst::extraAt(Index index) const
+{
+    return extra[index];
+}
+
+Slot FlatAst::slot(Index index) const
+{
+    return slots[index];
+}
+
+object::Object FlatAst::constant(Index index) const
+{
+    const Constant &constant = constants[index];
+    switch (constant.type) {
+    case Constant::Type::Boolean:
+        return constant.boolean;
+    case Constant::Type::Number:
+        return constant.number;
+    case Constant::Type::String:
+        return object::String{textAt(constant.offset, constant.length)};
+    case Constant::Type::Nil:
+        break;
+    }
+    return object::Null{};
+}
+
+std::size_t FlatAst::size() const
+{
+    return nodes.size();
+}
+
+std::string_view FlatAst::textAt(std::uint32_t offset, std::uint32_t length) const
+{
+    return std::string_view{text.data(), text.size()}.substr(offset, length);
+}
+
+}  // namespace draft
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+#include "ast.h"
+
+namespace draft {
+
+// Data-oriented form of a resolved program. Nodes are fixed-size records in one contiguous array,
+// tagged with their kind and referring to children by 32-bit index; variable-length parts live in
+// an `extra` array, prefixed with their length. Tokens, literal values and resolved slots are
+// side tables of plain structs, and the text they refer to is copied into a pool owned here, so
+// every array is trivially copyable and the whole program can be written out as is.
+//
+// Node layouts, `-` being unused:
+//
+// kind      token    lhs                 rhs
+// Literal   -        constant            -
+// Logical   op       left                right
+// Unary     op       right               -
+// Binary    op       left                right
+// Call      paren    callee              extra: count arguments...
+// Grouping  -        expression          -
+// Variable  name     slot                -
+// Assign    name     value               slot
+// Get       name     object              -
+// Set       name     object              value
+// Super     keyword  method token        slot
+// This      keyword  slot                -
+// ListExpr  bracket  extra: count elements... -
+// MapExpr   brace    extra: count keys... count values...
+// GetIndex  bracket  object              index
+// SetIndex  bracket  object              extra: index value
+// ExprStmt  -        expression          -
+// If        -        condition           extra: then else
+// FuncStmt  name     extra: count params... count body... generator
+// Print     -        expression          -
+// Return    keyword  value               -
+// While     -        condition           body
+// Yield     keyword  value               -
+// Block     -        extra: count stmts  scoped
+// Class     name     superclass          extra: count methods...
+// Var       name     initializer         -
+//
+// Pointer-based visitors keep working through expand(), which rebuilds the node objects
+class FlatAst {
+public:
+    using Index = std::uint32_t;
+    static constexpr Index None = std::numeric_limits<Index>::max();
+
+    enum class Kind : std::uint8_t {
+        Literal,
+        Logical,
+        Unary,
+        Binary,
+        Call,
+        Grouping,
+        Variable,
+        Assign,
+        Get,
+        Set,
+        Super,
+        This,
+        ListExpr,
+        MapExpr,
+        GetIndex,
+        SetIndex,
+        ExprStmt,
+        If,
+        FuncStmt,
+        Print,
+        Return,
+        While,
+        Yield,
+        Block,
+        Class,
+        Var,
+    };
+
+    struct Node {
+        Kind kind = Kind::Literal;
+        Index token = None;
+        Index lhs = None;
+        Index rhs = None;
+    };
+
+    // A token whose lexeme is a range of the text pool
+    struct FlatToken {
+        std::uint32_t offset = 0;
+        std::uint32_t length = 0;
+        std::uint32_t line = 0;
+        Token::Kind kind = Token::Kind::Unrecognized;
+    };
+
+    // Literal value; strings are a range of the text pool
+    struct Constant {
+        enum class Type : std::uint8_t { Nil, Boolean, Number, String };
+
+        Type type = Type::Nil;
+        bool boolean = false;
+        double number = 0;
+        std::uint32_t offset = 0;
+        std::uint32_t length = 0;
+    };
+
+    // Flattens parsed, and possibly resolved, statements
+    static FlatAst flatten(std::span<Stmt *const> statements);
+
+    // Adapter for the visitors still working on pointers: rebuilds the node objects in the arena,
+    // resolved slots included. The tokens view this FlatAst's text, which must outlive them
+    std::vector<Stmt *> expand(memory::Arena &arena) const;
+
+    std::span<const Index> statements() const;
+    const Node &node(Index index) const;
+    Token token(Index index) const;
+    // A length-prefixed run of indices in the extra array
+    std::span<const Index> list(Index start) const;
+    Index extraAt(Index index) const;
+    Slot slot(Index index) const;
+    object::Object constant(Index index) const;
+
+    std::size_t size() const;
+
+private:
+    class Builder;
+
+    std::string_view textAt(std::uint32_t offset, std::uint32_t length) const;
+
+    std::vector<Node> nodes;
+    std::vector<Index> extra;
+    std::vector<FlatToken> tokens;
+    std::vector<Constant> constants;
+    std::vector<Slot> slots;
+    std::vector<char> text;
+    std::vector<Index> roots;
+};
+
+}  // namespace draft
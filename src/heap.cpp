@@ -0,0 +1,243 @@
+#include "heap.h"
+
+#include <algorithm>
+
+namespace draft::vm {
+
+Heap::~Heap()
+{
+    while (objects) {
+        Obj *next = objects->next;
+        delete objects;
+        objects = next;
+    }
+}
+
+ObjString *Heap::makeString(std::string_view chars)
+{
+    if (auto it = strings.find(chars); it != strings.end()) {
+        return it->second;
+    }
+    return intern(std::string{chars});
+}
+
+ObjString *Heap::concatenate(const ObjString *a, const ObjString *b)
+{
+    std::string chars;
+    chars.reserve(a->chars.size() + b->chars.size());
+    chars.append(a->chars).append(b->chars);
+    if (auto it = strings.find(chars); it != strings.end()) {
+        return it->second;
+    }
+    return intern(std::move(chars));
+}
+
+// Allocates a string not yet in the table and adds it
+ObjString *Heap::intern(std::string chars)
+{
+    ObjString *string = make<ObjString>(std::move(chars));
+    strings.emplace(string->chars, string);
+    return string;
+}
+
+void Heap::addRoots(Roots *source)
+{
+    roots.push_back(source);
+}
+
+void Heap::removeRoots(Roots *source)
+{
+    roots.erase(std::remove(roots.begin(), roots.end(), source), roots.end());
+}
+
+void Heap::collect()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (Roots *source : roots) {
+        source->markRoots(*this);
+    }
+    traceReferences();
+    removeWhiteStrings();
+    sweep();
+
+    nextCollection = std::max(static_cast<std::size_t>(bytesAllocated * tuning.growthFactor), tuning.initialThreshold);
+
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    statistics.collections++;
+    statistics.totalPause += pause;
+    statistics.maxPause = std::max(statistics.maxPause, pause);
+}
+
+void Heap::markValue(Value value)
+{
+    if (value.isObj()) {
+        markObject(value.asObj());
+    }
+}
+
+void Heap::markObject(Obj *object)
+{
+    if (!object or object->marked) {
+        return;
+    }
+    object->marked = true;
+    grayStack.push_back(object);
+}
+
+void Heap::tune(const Tuning &value)
+{
+    tuning = value;
+    nextCollection = tuning.initialThreshold;
+}
+
+const Heap::Stats &Heap::stats() const
+{
+    return statistics;
+}
+
+std::size_t Heap::size() const
+{
+    return bytesAllocated;
+}
+
+// Only counts what is fixed at allocation time, so an object frees exactly what it added
+std::size_t Heap::sizeOf(const Obj *object)
+{
+    switch (object->type) {
+    case ObjType::String:
+        return sizeof(ObjString) + static_cast<const ObjString *>(object)->chars.size();
+    case ObjType::Function:
+        return sizeof(ObjFunction);
+    case ObjType::Native:
+        return sizeof(ObjNative);
+    case ObjType::Closure:
+        return sizeof(ObjClosure) + static_cast<const ObjClosure *>(object)->upvalues.size() * sizeof(ObjUpvalue *);
+    case ObjType::Upvalue:
+        return sizeof(ObjUpvalue);
+    case ObjType::Class:
+        return sizeof(ObjClass);
+    case ObjType::Shape:
+        return sizeof(ObjShape);
+    case ObjType::Instance:
+        return sizeof(ObjInstance);
+    case ObjType::BoundMethod:
+        return sizeof(ObjBoundMethod);
+    }
+    return sizeof(Obj);
+}
+
+void Heap::traceReferences()
+{
+    while (!grayStack.empty()) {
+        Obj *object = grayStack.back();
+        grayStack.pop_back();
+        blacken(object);
+    }
+}
+
+void Heap::blacken(Obj *object)
+{
+    switch (object->type) {
+    case ObjType::String:
+        [[fallthrough]];
+    case ObjType::Native:
+        break;
+    case ObjType::Function: {
+        auto function = static_cast<ObjFunction *>(object);
+        markObject(function->name);
+        for (Value constant : function->chunk.constants) {
+            markValue(constant);
+        }
+        for (const PropertyCache &cache : function->chunk.caches) {
+            for (std::size_t i = 0; i < cache.count; i++) {
+                markObject(cache.entries[i].shape);
+                markObject(cache.entries[i].method);
+                markObject(cache.entries[i].transition);
+            }
+        }
+        break;
+    }
+    case ObjType::Upvalue:
+        markValue(static_cast<ObjUpvalue *>(object)->closed);
+        break;
+    case ObjType::Closure: {
+        auto closure = static_cast<ObjClosure *>(object);
+        markObject(closure->function);
+        for (ObjUpvalue *upvalue : closure->upvalues) {
+            markObject(upvalue);
+        }
+        break;
+    }
+    case ObjType::Class: {
+        auto klass = static_cast<ObjClass *>(object);
+        markObject(klass->name);
+        for (auto &[name, method] : klass->methods) {
+            markObject(name);
+            markObject(method);
+        }
+        markObject(klass->shape);
+        break;
+    }
+    case ObjType::Shape: {
+        auto shape = static_cast<ObjShape *>(object);
+        markObject(shape->klass);
+        markObject(shape->parent);
+        for (auto &[name, slot] : shape->slots) {
+            markObject(name);
+        }
+        for (auto &[name, child] : shape->transitions) {
+            markObject(child);
+        }
+        break;
+    }
+    case ObjType::Instance: {
+        auto instance = static_cast<ObjInstance *>(object);
+        markObject(instance->klass);
+        markObject(instance->shape);
+        for (Value value : instance->fields) {
+            markValue(value);
+        }
+        break;
+    }
+    case ObjType::BoundMethod: {
+        auto bound = static_cast<ObjBoundMethod *>(object);
+        markValue(bound->receiver);
+        markObject(bound->method);
+        break;
+    }
+    }
+}
+
+void Heap::removeWhiteStrings()
+{
+    std::erase_if(strings, [](const auto &entry) { return !entry.second->marked; });
+}
+
+void Heap::sweep()
+{
+    Obj *previous = nullptr;
+    Obj *object = objects;
+    while (object) {
+        if (object->marked) {
+            object->marked = false;
+            previous = object;
+            object = object->next;
+            continue;
+        }
+        Obj *unreached = object;
+        object = object->next;
+        if (previous) {
+            previous->next = object;
+        } else {
+            objects = object;
+        }
+        std::size_t size = sizeOf(unreached);
+        bytesAllocated -= size;
+        statistics.bytesFreed += size;
+        statistics.objectsFreed++;
+        delete unreached;
+    }
+}
+
+}  // namespace draft::vm
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "vm_object.h"
+
+namespace draft::vm {
+
+class Heap;
+
+// Anything holding object pointers outside the heap registers itself as a source of roots
+class Roots {
+public:
+    virtual ~Roots() = default;
+    virtual void markRoots(Heap &heap) = 0;
+};
+
+// Owns every object allocated by the compiler and the VM and reclaims unreachable ones with a
+// mark-sweep collector. A collection starts when an allocation pushes the heap past its threshold;
+// afterwards the threshold is set to the surviving size times the growth factor.
+class Heap {
+public:
+    struct Tuning {
+        std::size_t initialThreshold = 1024 * 1024;
+        double growthFactor = 2.0;
+        // Collect before every allocation, to shake out missing roots
+        bool stress = false;
+    };
+
+    struct Stats {
+        std::size_t collections = 0;
+        std::size_t bytesAllocated = 0;
+        std::size_t bytesFreed = 0;
+        std::size_t objectsFreed = 0;
+        std::chrono::nanoseconds totalPause{0};
+        std::chrono::nanoseconds maxPause{0};
+    };
+
+    Heap() = default;
+    ~Heap();
+
+    template <typename T, typename... Args>
+    T *make(Args &&...args)
+    {
+        if (tuning.stress or bytesAllocated > nextCollection) {
+            collect();
+        }
+        T *object = new T(std::forward<Args>(args)...);
+        object->next = objects;
+        objects = object;
+        bytesAllocated += sizeOf(object);
+        statistics.bytesAllocated += sizeOf(object);
+        return object;
+    }
+
+    // Strings are interned: equal contents always yield the same object, so comparing and hashing a
+    // string is a pointer operation
+    ObjString *makeString(std::string_view chars);
+    ObjString *concatenate(const ObjString *a, const ObjString *b);
+
+    void addRoots(Roots *roots);
+    void removeRoots(Roots *roots);
+
+    void collect();
+    void markValue(Value value);
+    void markObject(Obj *object);
+
+    void tune(const Tuning &tuning);
+    const Stats &stats() const;
+    std::size_t size() const;
+
+private:
+    Heap(const Heap &) = delete;
+    Heap &operator=(const Heap &) = delete;
+
+    static std::size_t sizeOf(const Obj *object);
+    ObjString *intern(std::string chars);
+    void traceReferences();
+    void blacken(Obj *object);
+    void removeWhiteStrings();
+    void sweep();
+
+    Obj *objects = nullptr;
+    // Keys view the characters of the interned strings themselves. The table holds its strings
+    // weakly: a string nothing else refers to is dropped from it before being freed
+    std::unordered_map<std::string_view, ObjString *> strings;
+
+    std::vector<Roots *> roots;
+    std::vector<Obj *> grayStack;
+    std::size_t bytesAllocated = 0;
+    std::size_t nextCollection = Tuning{}.initialThreshold;
+    Tuning tuning;
+    Stats statistics;
+};
+
+}  // namespace draft::vm
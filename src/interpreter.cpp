@@ -1,40 +1,305 @@
 #include "interpreter.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <utility>
+
+#if __has_include(<pthread.h>)
+#include <pthread.h>
+#define DRAFT_HAS_PTHREAD
+#endif
+
 #include "builtin.h"
 #include "obj_class.h"
+#include "obj_coroutine.h"
 #include "obj_instance.h"
+#include "obj_list.h"
+#include "obj_map.h"
+#include "profiler.h"
 #include "object.h"
 #include "parser.h"
 #include "driver.h"
 
 namespace draft {
 
-Interpreter::Interpreter()
+Interpreter::Interpreter(std::ostream &stream)
+    : output{stream}
 {
+    stack.reserve(StackMax);
     globals = std::make_shared<Environment>();
-    globals->define("clock", std::make_shared<ClockFunction>());
+    for (const Native &native : natives()) {
+        defineNative(native.name, std::make_shared<NativeFunction>(native.name, native.arity, native.body));
+    }
     environment = globals;
 }
 
-void Interpreter::interpret(const std::vector<Stmt *> &statements)
+Interpreter::~Interpreter()
 {
-    try {
+    while (!coroutines.empty()) {
+        (*coroutines.begin())->close();
+    }
+}
+
+void Interpreter::defineNative(std::string_view name, object::CallablePtr function)
+{
+    globals->define(name, std::move(function));
+}
+
+namespace {
+
+// Native stack a call may take through the visitors, generous enough for unoptimized builds
+constexpr std::size_t NativeBytesPerCall = 4 * 1024;
+// Kept free below the limit for what runs between two checks, such as printing a value
+constexpr std::size_t NativeStackMargin = 256 * 1024;
+constexpr std::size_t DefaultNativeStack = 8 * 1024 * 1024;
+constexpr std::size_t MaxNativeStack = std::size_t{1} << 30;
+
+// The native stack of the calling thread, as its lowest address and its size
+struct NativeStack {
+    const char *lowest = nullptr;
+    std::size_t size = 0;
+};
+
+// Where a call the host makes stands in the program
+const Token hostCall{Token::Kind::Identifier, "<host>", 0};
+
+// Asked once per thread: for the main thread the bounds are read from /proc
+NativeStack nativeStack()
+{
+    thread_local std::optional<NativeStack> known;
+    if (known) {
+        return *known;
+    }
+    known = NativeStack{};
+#if defined(DRAFT_HAS_PTHREAD) and defined(__GLIBC__)
+    // The thread's TLS and guard page come out of the size it was created with
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+        void *lowest = nullptr;
+        std::size_t size = 0;
+        int error = pthread_attr_getstack(&attributes, &lowest, &size);
+        pthread_attr_destroy(&attributes);
+        if (error == 0) {
+            known = NativeStack{static_cast<const char *>(lowest), size};
+        }
+    }
+#endif
+    return *known;
+}
+
+// Runs `body` passing it the lowest address it may use on the native stack: on the calling thread
+// if its stack holds `size` bytes, else on a thread with a stack that size. A thread is the last
+// resort since once there is one, every reference count in the process is updated atomically
+void runOnStack(std::size_t size, const std::function<void(const char *)> &body)
+{
+    if (NativeStack stack = nativeStack(); stack.size >= size) {
+        body(stack.lowest + NativeStackMargin);
+        return;
+    }
+#ifdef DRAFT_HAS_PTHREAD
+    struct Start {
+        const std::function<void(const char *)> &body;
+        std::size_t size;
+    } start{body, size};
+    auto entry = [](void *argument) -> void * {
+        auto start = static_cast<Start *>(argument);
+        NativeStack stack = nativeStack();
+        if (!stack.lowest) {
+            // Leaves room for what the size covers besides the stack
+            stack.lowest = static_cast<const char *>(__builtin_frame_address(0)) - start->size + NativeStackMargin;
+        }
+        start->body(stack.lowest + NativeStackMargin);
+        return nullptr;
+    };
+
+    // A stack the system refuses to reserve is retried at the default size, the limit still applies
+    for (std::size_t attempt : {size, DefaultNativeStack}) {
+        start.size = attempt;
+        pthread_attr_t attributes;
+        pthread_t thread;
+        if (pthread_attr_init(&attributes) != 0) {
+            break;
+        }
+        bool started = pthread_attr_setstacksize(&attributes, attempt) == 0 and
+                       pthread_create(&thread, &attributes, entry, &start) == 0;
+        pthread_attr_destroy(&attributes);
+        if (started) {
+            pthread_join(thread, nullptr);
+            return;
+        }
+    }
+#endif
+    // Without a known stack nothing is checked but the depth
+    NativeStack stack = nativeStack();
+    body(stack.lowest ? stack.lowest + NativeStackMargin : nullptr);
+}
+
+}  // namespace
+
+void Interpreter::interpret(std::span<Stmt *const> statements)
+{
+    if (std::optional<RuntimeError> error = run(statements)) {
+        Driver::error(error->token.line, error->what());
+        std::exit(draft::exit::software);
+    }
+}
+
+std::optional<RuntimeError> Interpreter::run(std::span<Stmt *const> statements)
+{
+    return guarded([&] {
         for (Stmt *statement : statements) {
             execute(statement);
         }
+    });
+}
+
+std::optional<RuntimeError> Interpreter::call(const object::Object &callee, object::Arguments arguments,
+                                              object::Object &result)
+{
+    return guarded([&] {
+        auto function = std::get_if<object::CallablePtr>(&callee);
+        if (!function) {
+            throw RuntimeError{hostCall, "Can only call functions and classes"};
+        }
+        if (arguments.size() != (*function)->arity()) {
+            throw RuntimeError{hostCall, "Expected " + std::to_string((*function)->arity()) + " arguments but got " +
+                                             std::to_string(arguments.size())};
+        }
+        enterCall(hostCall, function->get());
+        try {
+            result = (*function)->call(this, arguments);
+        } catch (const NativeError &err) {
+            throw RuntimeError{hostCall, err.what()};
+        }
+        leaveCall();
+    });
+}
+
+object::Object Interpreter::callFromNative(object::Callable &callee, object::Arguments arguments)
+{
+    try {
+        enterCall(hostCall, &callee);
     } catch (const RuntimeError &err) {
-        Driver::error(err.token.line, err.what());
-        std::exit(draft::exit::software);
+        throw NativeError{err.what()};
     }
+    object::Object result = callee.call(this, arguments);
+    leaveCall();
+    return result;
+}
+
+const object::Object *Interpreter::getGlobal(std::string_view name) const
+{
+    return globals->find(name);
+}
+
+std::optional<RuntimeError> Interpreter::guarded(const std::function<void()> &body)
+{
+    std::optional<RuntimeError> error;
+    std::size_t size = std::min(maxDepth * NativeBytesPerCall + 2 * NativeStackMargin, MaxNativeStack);
+    runOnStack(size, [&](const char *limit) {
+        // A host may call in from a native, so the limit of the run in progress is kept
+        const char *outer = std::exchange(stackLimit, limit);
+        if (profiler) {
+            profiler->start();
+        }
+        try {
+            body();
+            scheduler.run(this, [] { return false; });
+        } catch (const RuntimeError &err) {
+            error = err;
+            recover();
+        }
+        output.flush();
+        // The profile of a failing program is as telling as any
+        if (profiler) {
+            profiler->finish();
+        }
+        stackLimit = outer;
+    });
+    return error;
+}
+
+void Interpreter::recover()
+{
+    environment = globals;
+    returning = false;
+    returnValue = object::Null{};
+    stack.clear();
+    frames.clear();
+    tailCall = {};
+}
+
+void Interpreter::setMaxDepth(std::size_t depth)
+{
+    maxDepth = depth;
+    // Set between runs, while no call views the stack
+    stack.reserve(std::max(StackMax, depth * SlotsPerCall));
+}
+
+void Interpreter::setProfiler(Profiler *profiler)
+{
+    this->profiler = profiler;
+}
+
+void Interpreter::setStats(Stats *stats)
+{
+    this->stats = stats;
+}
+
+const Stats *Interpreter::getStats() const
+{
+    return stats;
+}
+
+void Interpreter::setIsolate(Isolate::Id id)
+{
+    isolate = id;
+}
+
+Isolate::Id Interpreter::getIsolate() const
+{
+    return isolate;
+}
+
+Scheduler &Interpreter::getScheduler()
+{
+    return scheduler;
+}
+
+object::Coroutine *Interpreter::getCoroutine() const
+{
+    return coroutine;
+}
+
+void Interpreter::swapExecution(Execution &execution)
+{
+    std::swap(environment, execution.environment);
+    std::swap(returning, execution.returning);
+    std::swap(returnValue, execution.returnValue);
+    std::swap(stack, execution.stack);
+    std::swap(frames, execution.frames);
+    std::swap(stackLimit, execution.stackLimit);
+    std::swap(tailCall, execution.tailCall);
+#ifdef DRAFT_JIT
+    std::swap(running, execution.running);
+#endif
+}
+
+Output &Interpreter::getOutput()
+{
+    return output;
 }
 
 object::Object Interpreter::visit(Literal *expr)
 {
+    count(Stats::Node::Literal);
     return expr->value;
 }
 
 object::Object Interpreter::visit(Logical *expr)
 {
+    count(Stats::Node::Logical);
     object::Object left = evaluate(expr->left);
 
     if (expr->op.kind == Token::Kind::Or) {
@@ -51,6 +316,7 @@ object::Object Interpreter::visit(Logical *expr)
 
 object::Object Interpreter::visit(Unary *expr)
 {
+    count(Stats::Node::Unary);
     object::Object right = evaluate(expr->right);
 
     switch (expr->op.kind) {
@@ -69,9 +335,52 @@ object::Object Interpreter::visit(Unary *expr)
 
 object::Object Interpreter::visit(Binary *expr)
 {
+    count(Stats::Node::Binary);
     object::Object left = evaluate(expr->left);
     object::Object right = evaluate(expr->right);
 
+    switch (expr->feedback) {
+    case Binary::Feedback::Numbers: {
+        auto a = std::get_if<object::Number>(&left);
+        auto b = std::get_if<object::Number>(&right);
+        if (a and b) [[likely]] {
+            return numeric(expr->op.kind, *a, *b);
+        }
+        expr->feedback = Binary::Feedback::Generic;
+        break;
+    }
+    case Binary::Feedback::Strings: {
+        auto a = std::get_if<object::String>(&left);
+        auto b = std::get_if<object::String>(&right);
+        if (a and b) [[likely]] {
+            if (stats) {
+                stats->concatenations++;
+            }
+            return *a + *b;
+        }
+        expr->feedback = Binary::Feedback::Generic;
+        break;
+    }
+    case Binary::Feedback::Unseen: {
+        object::Object result = binary(expr, left, right);
+        if (std::holds_alternative<object::Number>(left) and std::holds_alternative<object::Number>(right)) {
+            expr->feedback = Binary::Feedback::Numbers;
+        } else if (expr->op.kind == Token::Kind::PlusSign and std::holds_alternative<object::String>(left)) {
+            // The generic path threw unless the right operand is a string too
+            expr->feedback = Binary::Feedback::Strings;
+        } else {
+            expr->feedback = Binary::Feedback::Generic;
+        }
+        return result;
+    }
+    case Binary::Feedback::Generic:
+        break;
+    }
+    return binary(expr, left, right);
+}
+
+object::Object Interpreter::binary(Binary *expr, const object::Object &left, const object::Object &right)
+{
     switch (expr->op.kind) {
     case Token::Kind::GreaterThanSign:
         checkNumberOperands(expr->op, left, right);
@@ -97,6 +406,9 @@ object::Object Interpreter::visit(Binary *expr)
             return std::get<object::Number>(left) + std::get<object::Number>(right);
         }
         if (std::holds_alternative<object::String>(left) and std::holds_alternative<object::String>(right)) {
+            if (stats) {
+                stats->concatenations++;
+            }
             return std::get<object::String>(left) + std::get<object::String>(right);
         }
         throw RuntimeError{expr->op, "Operands must be two numbers or two strings"};
@@ -114,43 +426,262 @@ object::Object Interpreter::visit(Binary *expr)
     return object::Null{};
 }
 
+object::Object Interpreter::numeric(Token::Kind op, object::Number left, object::Number right)
+{
+    switch (op) {
+    case Token::Kind::GreaterThanSign:
+        return left > right;
+    case Token::Kind::GreaterEqual:
+        return left >= right;
+    case Token::Kind::LessThanSign:
+        return left < right;
+    case Token::Kind::LessEqual:
+        return left <= right;
+    case Token::Kind::ExclaimEqual:
+        return left != right;
+    case Token::Kind::EqualEqual:
+        return left == right;
+    case Token::Kind::HyphenMinus:
+        return left - right;
+    case Token::Kind::PlusSign:
+        return left + right;
+    case Token::Kind::Solidus:
+        return left / right;
+    case Token::Kind::Asterisk:
+        return left * right;
+    default:
+        break;
+    }
+
+    // Unreachable
+    return object::Null{};
+}
+
+bool Interpreter::compare(Token::Kind op, object::Number left, object::Number right)
+{
+    switch (op) {
+    case Token::Kind::LessThanSign:
+        return left < right;
+    case Token::Kind::LessEqual:
+        return left <= right;
+    case Token::Kind::GreaterThanSign:
+        return left > right;
+    case Token::Kind::GreaterEqual:
+        return left >= right;
+    case Token::Kind::EqualEqual:
+        return left == right;
+    default:
+        return left != right;
+    }
+}
+
+// A comparison of a local variable to another or to a literal
+bool Interpreter::isComparison(Expr *expr)
+{
+    auto binary = dynamic_cast<Binary *>(expr);
+    if (!binary) {
+        return false;
+    }
+    switch (binary->op.kind) {
+    case Token::Kind::LessThanSign:
+    case Token::Kind::LessEqual:
+    case Token::Kind::GreaterThanSign:
+    case Token::Kind::GreaterEqual:
+    case Token::Kind::EqualEqual:
+    case Token::Kind::ExclaimEqual:
+        break;
+    default:
+        return false;
+    }
+    auto left = dynamic_cast<Variable *>(binary->left);
+    if (!left or !left->slot.isLocal()) {
+        return false;
+    }
+    auto right = dynamic_cast<Variable *>(binary->right);
+    return (right and right->slot.isLocal()) or dynamic_cast<Literal *>(binary->right);
+}
+
+// `x = x + c` or `x = x - c` for a local x and a number c
+bool Interpreter::isStep(Assign *expr)
+{
+    auto step = dynamic_cast<Binary *>(expr->value);
+    if (!expr->slot.isLocal() or !step) {
+        return false;
+    }
+    if (step->op.kind != Token::Kind::PlusSign and step->op.kind != Token::Kind::HyphenMinus) {
+        return false;
+    }
+    auto variable = dynamic_cast<Variable *>(step->left);
+    auto delta = dynamic_cast<Literal *>(step->right);
+    return variable and variable->slot.depth == expr->slot.depth and variable->slot.index == expr->slot.index and
+           delta and std::holds_alternative<object::Number>(delta->value);
+}
+
 object::Object Interpreter::visit(Call *expr)
 {
-    object::Object callee = evaluate(expr->callee);
+    count(Stats::Node::Call);
+    Target target = prepareCall(expr);
+    enterCall(expr->paren, target.function);
+    object::Arguments arguments{stack.data() + target.base, expr->arguments.size()};
+    object::Object result;
+    try {
+        result = target.method ? target.method->invoke(this, target.receiver, arguments)
+                               : target.function->call(this, arguments);
+    } catch (const NativeError &err) {
+        throw RuntimeError{expr->paren, err.what()};
+    }
+    leaveCall();
+    stack.resize(target.base);
+    return result;
+}
 
-    std::vector<object::Object> arguments;
+Interpreter::Target Interpreter::prepareCall(Call *expr)
+{
+    // A method called straight away runs with its receiver as "this" and is never bound. Fields
+    // shadow methods, so a field holding a function is called like any other value
+    Target target;
+    if (expr->method) {
+        auto obj = evaluate(expr->method->object);
+        if (!std::holds_alternative<object::InstancePtr>(obj)) {
+            throw RuntimeError{expr->method->name, "Only instances have properties"};
+        }
+        target.receiver = std::get<object::InstancePtr>(obj);
+        if (stats) {
+            countProperty(*target.receiver, expr->method->name.lexeme);
+        }
+        if (const object::Object *field = target.receiver->getField(expr->method->name.lexeme)) {
+            target.callee = *field;
+        } else {
+            target.method = target.receiver->findMethod(expr->method->name.lexeme);
+        }
+    } else if (expr->superMethod) {
+        target.method = lookUpSuperMethod(expr->superMethod, target.receiver);
+    } else {
+        target.callee = evaluate(expr->callee);
+    }
+
+    target.base = stack.size();
+    if (target.base + expr->arguments.size() > stack.capacity()) {
+        throw RuntimeError{expr->paren, "Stack overflow"};
+    }
     for (Expr *argument : expr->arguments) {
-        arguments.emplace_back(evaluate(argument));
+        stack.push_back(evaluate(argument));
     }
 
-    if (!std::holds_alternative<object::CallablePtr>(callee)) {
-        throw RuntimeError{expr->paren, "Can only call functions and classes"};
+    target.function = target.method.get();
+    if (!target.function) {
+        if (!std::holds_alternative<object::CallablePtr>(target.callee)) {
+            throw RuntimeError{expr->paren, "Can only call functions and classes"};
+        }
+        target.function = std::get<object::CallablePtr>(target.callee).get();
+    }
+    if (expr->arguments.size() != target.function->arity()) {
+        throw RuntimeError{expr->paren, "Expected " + std::to_string(target.function->arity()) +
+                                            " arguments but got " + std::to_string(expr->arguments.size())};
+    }
+    return target;
+}
+
+void Interpreter::enterCall(const Token &paren, object::Callable *callee)
+{
+    auto here = static_cast<const char *>(__builtin_frame_address(0));
+    if (frames.size() == maxDepth or (stackLimit and here < stackLimit)) {
+        throw RuntimeError{paren, "Stack overflow"};
+    }
+    if (stats) {
+        stats->calls++;
+        if (dynamic_cast<object::Class *>(callee)) {
+            stats->instances++;
+        }
     }
-    auto function = std::get<object::CallablePtr>(callee);
-    if (arguments.size() != function->arity()) {
-        throw RuntimeError{
-            expr->paren,
-            "Expected " + std::to_string(function->arity()) + " arguments but got " + std::to_string(arguments.size())};
+    // A sample goes to the code that ran up to here, before the callee is entered
+    if (profiler) {
+        profiler->count(callee);
+        if (profiler->due()) {
+            profiler->sample(frames);
+        }
     }
-    return function->call(this, arguments);
+    frames.push_back(callee);
+}
+
+void Interpreter::countProperty(const object::Instance &instance, std::string_view name)
+{
+    if (instance.getField(name)) {
+        stats->fieldHits++;
+    } else if (instance.findMethod(name)) {
+        stats->methodHits++;
+    } else {
+        stats->propertyMisses++;
+    }
+}
+
+void Interpreter::leaveCall()
+{
+    if (profiler and profiler->due()) {
+        profiler->sample(frames);
+    }
+    frames.pop_back();
+}
+
+// Hands a call to a Draft function over to the Function::invoke that is returning, which makes it
+// in place of its own; native functions, classes and generators, which make a coroutine rather
+// than run, are called as usual
+void Interpreter::returnCall(Call *expr)
+{
+    Target target = prepareCall(expr);
+    object::FunctionPtr function = target.method;
+    if (!function) {
+        function = std::dynamic_pointer_cast<object::Function>(std::get<object::CallablePtr>(target.callee));
+    }
+    if (function and !function->getDeclaration()->generator) {
+        // Only a method takes the receiver as "this"; a function held in a field is called as such
+        object::InstancePtr receiver = target.method ? std::move(target.receiver) : nullptr;
+        tailCall = TailCall{std::move(function), std::move(receiver), target.base};
+        return;
+    }
+    enterCall(expr->paren, target.function);
+    try {
+        returnValue = target.function->call(this, {stack.data() + target.base, expr->arguments.size()});
+    } catch (const NativeError &err) {
+        throw RuntimeError{expr->paren, err.what()};
+    }
+    leaveCall();
+    stack.resize(target.base);
 }
 
 object::Object Interpreter::visit(Grouping *expr)
 {
+    count(Stats::Node::Grouping);
     return evaluate(expr->expression);
 }
 
 object::Object Interpreter::visit(Variable *expr)
 {
-    return lookUpVariable(expr->name, expr);
+    count(Stats::Node::Variable);
+    return lookUpVariable(expr->name, expr->slot);
 }
 
 object::Object Interpreter::visit(Assign *expr)
 {
+    count(Stats::Node::Assign);
+    if (expr->shape == Assign::Shape::Unseen) {
+        expr->shape = isStep(expr) ? Assign::Shape::Step : Assign::Shape::Generic;
+    }
+    if (expr->shape == Assign::Shape::Step) {
+        auto step = static_cast<Binary *>(expr->value);
+        if (auto number = std::get_if<object::Number>(&environment->at(expr->slot))) [[likely]] {
+            count(Stats::Node::Binary);
+            count(Stats::Node::Variable);
+            count(Stats::Node::Literal);
+            object::Number delta = std::get<object::Number>(static_cast<Literal *>(step->right)->value);
+            *number = step->op.kind == Token::Kind::PlusSign ? *number + delta : *number - delta;
+            return *number;
+        }
+    }
+
     object::Object value = evaluate(expr->value);
-    if (auto it = locals.find(expr); it != locals.end()) {
-        int distance = locals.at(expr);
-        environment->assignAt(distance, expr->name, value);
+    if (expr->slot.isLocal()) {
+        environment->assignAt(expr->slot, value);
     } else {
         globals->assign(expr->name, value);
     }
@@ -159,9 +690,13 @@ object::Object Interpreter::visit(Assign *expr)
 
 object::Object Interpreter::visit(Get *expr)
 {
+    count(Stats::Node::Get);
     auto obj = evaluate(expr->object);
     if (std::holds_alternative<object::InstancePtr>(obj)) {
         auto instance = std::get<object::InstancePtr>(obj);
+        if (stats) {
+            countProperty(*instance, expr->name.lexeme);
+        }
         return instance->getProperty(expr->name.lexeme);
     }
     throw RuntimeError{expr->name, "Only instances have properties"};
@@ -169,6 +704,7 @@ object::Object Interpreter::visit(Get *expr)
 
 object::Object Interpreter::visit(Set *expr)
 {
+    count(Stats::Node::Set);
     auto obj = evaluate(expr->object);
 
     if (!std::holds_alternative<object::InstancePtr>(obj)) {
@@ -183,31 +719,100 @@ object::Object Interpreter::visit(Set *expr)
 
 object::Object Interpreter::visit(Super *expr)
 {
-    int distance = locals.at(expr);
-    auto superclassObj = environment->getAt(distance, "super");
-    object::Callable *superclassCallable = std::get<object::CallablePtr>(superclassObj).get();
-    object::Class *superclass = dynamic_cast<object::Class *>(superclassCallable);
-    auto instanceObj = environment->getAt(distance - 1, "this");
-    object::InstancePtr instance = std::get<object::InstancePtr>(instanceObj);
-    auto method = superclass->findMethod(expr->method.lexeme);
+    count(Stats::Node::Super);
+    object::InstancePtr instance;
+    auto method = lookUpSuperMethod(expr, instance);
     if (!method) {
-        Driver::error(expr->method.line, "Undefined property '" + expr->method.lexeme + "'");
+        return object::Null{};
     }
     return method->bind(instance);
 }
 
 object::Object Interpreter::visit(This *expr)
 {
-    return lookUpVariable(expr->keyword, expr);
+    count(Stats::Node::This);
+    return lookUpVariable(expr->keyword, expr->slot);
+}
+
+object::Object Interpreter::visit(ListExpr *expr)
+{
+    count(Stats::Node::ListExpr);
+    std::vector<object::Object> elements;
+    elements.reserve(expr->elements.size());
+    for (Expr *element : expr->elements) {
+        elements.push_back(evaluate(element));
+    }
+    return std::make_shared<object::List>(std::move(elements));
+}
+
+object::Object Interpreter::visit(MapExpr *expr)
+{
+    count(Stats::Node::MapExpr);
+    auto map = std::make_shared<object::Map>();
+    for (std::size_t i = 0; i < expr->keys.size(); i++) {
+        object::Object key = evaluate(expr->keys[i]);
+        map->set(key, evaluate(expr->values[i]));
+    }
+    return map;
+}
+
+object::Object Interpreter::visit(GetIndex *expr)
+{
+    count(Stats::Node::GetIndex);
+    object::Object obj = evaluate(expr->object);
+    object::Object scratch;
+    const object::Object &index = evaluateIndex(expr->index, expr->shape, scratch);
+    if (auto map = std::get_if<object::MapPtr>(&obj)) {
+        const object::Object *value = expr->shape.kind == IndexShape::Kind::Constant
+                                          ? (*map)->find(index, expr->shape.hash)
+                                          : (*map)->find(index);
+        return value ? *value : object::Null{};
+    }
+    auto list = std::get_if<object::ListPtr>(&obj);
+    if (!list) {
+        throw RuntimeError{expr->bracket, "Only lists and maps can be indexed"};
+    }
+    return (*list)->get(checkIndex(expr->bracket, **list, index));
+}
+
+object::Object Interpreter::visit(SetIndex *expr)
+{
+    count(Stats::Node::SetIndex);
+    object::Object obj = evaluate(expr->object);
+    object::Object scratch;
+    const object::Object &index = evaluateIndex(expr->index, expr->shape, scratch);
+    if (auto map = std::get_if<object::MapPtr>(&obj)) {
+        object::Object value = evaluate(expr->value);
+        if (expr->shape.kind == IndexShape::Kind::Constant) {
+            (*map)->set(index, value, expr->shape.hash);
+        } else {
+            (*map)->set(index, value);
+        }
+        return value;
+    }
+    auto list = std::get_if<object::ListPtr>(&obj);
+    if (!list) {
+        throw RuntimeError{expr->bracket, "Only lists and maps can be indexed"};
+    }
+    std::size_t at = checkIndex(expr->bracket, **list, index);
+    object::Object value = evaluate(expr->value);
+    // The value may have resized the list
+    if (at >= (*list)->size()) {
+        throw RuntimeError{expr->bracket, "List index out of range"};
+    }
+    (*list)->set(at, value);
+    return value;
 }
 
 void Interpreter::visit(ExprStmt *stmt)
 {
+    count(Stats::Node::ExprStmt);
     evaluate(stmt->expression);
 }
 
 void Interpreter::visit(If *stmt)
 {
+    count(Stats::Node::If);
     if (object::isTruthy(evaluate(stmt->condition))) {
         execute(stmt->thenBranch);
     } else if (stmt->elseBranch) {
@@ -217,80 +822,182 @@ void Interpreter::visit(If *stmt)
 
 void Interpreter::visit(FuncStmt *stmt)
 {
+    count(Stats::Node::FuncStmt);
     auto function = std::make_shared<object::Function>(stmt, environment, false);
-    environment->define(stmt->name.lexeme, function);
+    define(stmt->name, function);
 }
 
 void Interpreter::visit(Print *stmt)
 {
+    count(Stats::Node::Print);
     object::Object value = evaluate(stmt->expression);
-    io::writeLine(object::obj2str(value));
+    if (auto number = std::get_if<object::Number>(&value)) {
+        output.writeNumber(*number);
+    } else if (auto text = std::get_if<object::String>(&value)) {
+        output.write(*text);
+    } else {
+        output.write(object::obj2str(value));
+    }
+    output.endLine();
 }
 
 void Interpreter::visit(Return *stmt)
 {
+    count(Stats::Node::Return);
+    if (stmt->tailCall) {
+        returnCall(stmt->tailCall);
+        returning = true;
+        return;
+    }
+    object::Object value = object::Null{};
+    if (stmt->value) {
+        value = evaluate(stmt->value);
+    }
+    returnValue = std::move(value);
+    returning = true;
+}
+
+void Interpreter::visit(Yield *stmt)
+{
+    count(Stats::Node::Yield);
     object::Object value = object::Null{};
     if (stmt->value) {
         value = evaluate(stmt->value);
     }
-    throw ReturnEx{value};
+    coroutine->suspend(std::move(value));
 }
 
 void Interpreter::visit(While *stmt)
 {
-    while (object::isTruthy(evaluate(stmt->condition))) {
-        execute(stmt->body);
+    count(Stats::Node::While);
+    if (stmt->shape == While::Shape::Unseen) {
+        stmt->shape = isComparison(stmt->condition) ? While::Shape::Compare : While::Shape::Generic;
+    }
+    // Nothing is declared in the loop's environment while it runs, so the slots of the compared
+    // variables stay where they are
+    const object::Object *left = nullptr;
+    const object::Object *right = nullptr;
+    Token::Kind op = Token::Kind::LessThanSign;
+    if (stmt->shape == While::Shape::Compare) {
+        auto condition = static_cast<Binary *>(stmt->condition);
+        op = condition->op.kind;
+        left = &environment->getAt(static_cast<Variable *>(condition->left)->slot);
+        if (auto variable = dynamic_cast<Variable *>(condition->right)) {
+            right = &environment->getAt(variable->slot);
+        } else {
+            right = &static_cast<Literal *>(condition->right)->value;
+        }
+    }
+    auto test = [&] {
+        if (left and stats) {
+            auto condition = static_cast<Binary *>(stmt->condition);
+            count(Stats::Node::Binary);
+            count(Stats::Node::Variable);
+            count(dynamic_cast<Variable *>(condition->right) ? Stats::Node::Variable : Stats::Node::Literal);
+        }
+        if (left) {
+            auto a = std::get_if<object::Number>(left);
+            auto b = std::get_if<object::Number>(right);
+            if (a and b) [[likely]] {
+                return compare(op, *a, *b);
+            }
+        }
+        return object::isTruthy(evaluate(stmt->condition));
+    };
+
+    // A body with declarations of its own keeps its environment from one iteration to the next,
+    // unless a closure captured it
+    auto block = dynamic_cast<Block *>(stmt->body);
+    EnvironmentPtr env;
+    while (test()) {
+#ifdef DRAFT_JIT
+        if (running) {
+            running->countIteration();
+        }
+#endif
+        if (profiler and profiler->due()) {
+            profiler->sample(frames);
+        }
+        if (block and block->scoped) {
+            if (env and env.use_count() == 1) {
+                env->reset(environment);
+            } else {
+                env = makeEnvironment(environment);
+            }
+            executeBlock(block->statements, env);
+        } else {
+            execute(stmt->body);
+        }
+        if (returning) {
+            break;
+        }
+    }
+    if (env) {
+        recycle(std::move(env));
     }
 }
 
 void Interpreter::visit(Block *stmt)
 {
-    EnvironmentPtr env = std::make_shared<Environment>(environment);
+    count(Stats::Node::Block);
+    if (!stmt->scoped) {
+        for (Stmt *statement : stmt->statements) {
+            execute(statement);
+            if (returning) {
+                break;
+            }
+        }
+        return;
+    }
+    EnvironmentPtr env = makeEnvironment(environment);
     executeBlock(stmt->statements, env);
+    recycle(std::move(env));
 }
 
 void Interpreter::visit(Class *stmt)
 {
+    count(Stats::Node::Class);
     object::ClassPtr superclass;
     if (stmt->superclass) {
         auto super = evaluate(stmt->superclass);
-        if (!std::holds_alternative<object::CallablePtr>(super) and
-            std::dynamic_pointer_cast<object::Class>(std::get<object::CallablePtr>(super))) {  // Ugh!
-            Driver::error(stmt->superclass->name.line, "Superclass must be a class");
-        } else {
-            superclass = std::static_pointer_cast<object::Class>(std::get<object::CallablePtr>(super));
+        if (auto callable = std::get_if<object::CallablePtr>(&super)) {
+            superclass = std::dynamic_pointer_cast<object::Class>(*callable);
+        }
+        if (!superclass) {
+            throw RuntimeError{stmt->superclass->name, "Superclass must be a class"};
         }
     }
-    environment->define(stmt->name.lexeme, object::Null{});
-
     if (stmt->superclass) {
         environment = std::make_shared<Environment>(environment);
-        environment->define("super", superclass);
+        if (stats) {
+            stats->environments++;
+        }
+        environment->define(superclass);
     }
 
-    std::map<std::string, object::FunctionPtr> methods;
+    object::Class::MethodTable methods;
     for (FuncStmt *method : stmt->methods) {
         bool isInitializer = method->name.lexeme == "init";
-        auto func = std::make_shared<object::Function>(method, environment, isInitializer);
-        std::string methodName = method->name.lexeme;
-        auto p = std::make_pair<std::string, object::FunctionPtr>(std::move(methodName), std::move(func));
-        methods.emplace(std::move(p));
+        methods.emplace(method->name.lexeme, std::make_shared<object::Function>(method, environment, isInitializer));
     }
-    auto classObject = std::make_shared<object::Class>(stmt->name.lexeme, superclass, methods);
+    auto classObject = std::make_shared<object::Class>(std::string{stmt->name.lexeme}, superclass, std::move(methods));
 
     if (superclass) {
         environment = environment->enclosing;
     }
-    environment->assign(stmt->name, classObject);
+    // Nothing else is declared in this environment while the methods are built, so the class
+    // still lands in the slot the Resolver gave it
+    define(stmt->name, classObject);
 }
 
 void Interpreter::visit(Var *stmt)
 {
+    count(Stats::Node::Var);
     object::Object value = object::Null{};
     if (stmt->initializer) {
         value = evaluate(stmt->initializer);
     }
-    environment->define(stmt->name.lexeme, value);
+    define(stmt->name, value);
 }
 
 object::Object Interpreter::evaluate(Expr *expr)
@@ -308,29 +1015,88 @@ void Interpreter::execute(Stmt *stmt)
     }
 }
 
-void Interpreter::executeBlock(const std::vector<Stmt *> &stmts, EnvironmentPtr env)
+void Interpreter::executeBlock(std::span<Stmt *const> stmts, const EnvironmentPtr &env)
 {
     EnvironmentPtr previous = this->environment;
 
     this->environment = env;
-    for (auto &stmt : stmts) {
-        execute(stmt);
+    try {
+        for (auto &stmt : stmts) {
+            execute(stmt);
+            if (returning) {
+                break;
+            }
+        }
+    } catch (...) {
+        // a runtime error unwinds through here, the caller's scope must be restored
+        this->environment = previous;
+        throw;
     }
     this->environment = previous;
 }
 
-void Interpreter::resolve(Expr *expr, int depth)
+object::Object Interpreter::lookUpVariable(const Token &name, Slot slot)
+{
+    if (slot.isLocal()) {
+        return environment->getAt(slot);
+    }
+    return globals->get(name);
+}
+
+EnvironmentPtr Interpreter::makeEnvironment(EnvironmentPtr enclosing)
+{
+    if (environmentPool.empty()) {
+        if (stats) {
+            stats->environments++;
+        }
+        return std::make_shared<Environment>(std::move(enclosing));
+    }
+    if (stats) {
+        stats->environmentsReused++;
+    }
+    EnvironmentPtr env = std::move(environmentPool.back());
+    environmentPool.pop_back();
+    env->reset(std::move(enclosing));
+    return env;
+}
+
+// An environment still referenced elsewhere was captured by a closure and must stay as it is
+void Interpreter::recycle(EnvironmentPtr env)
+{
+    if (env.use_count() == 1) {
+        env->reset(nullptr);
+        environmentPool.push_back(std::move(env));
+    }
+}
+
+object::Object Interpreter::takeReturnValue()
+{
+    returning = false;
+    return std::exchange(returnValue, object::Null{});
+}
+
+// "super" is the only variable of its environment, and "this" is the first slot of the method
+// environment right below it
+object::FunctionPtr Interpreter::lookUpSuperMethod(Super *expr, object::InstancePtr &receiver)
 {
-    locals[expr] = depth;
+    Slot slot = expr->slot;
+    auto superclassObj = environment->getAt(slot);
+    object::Callable *superclassCallable = std::get<object::CallablePtr>(superclassObj).get();
+    object::Class *superclass = dynamic_cast<object::Class *>(superclassCallable);
+    receiver = std::get<object::InstancePtr>(environment->getAt(Slot{slot.depth - 1, 0}));
+    auto method = superclass->findMethod(expr->method.lexeme);
+    if (!method) {
+        throw RuntimeError{expr->method, "Undefined property '" + std::string{expr->method.lexeme} + "'"};
+    }
+    return method;
 }
 
-object::Object Interpreter::lookUpVariable(Token name, Expr *expr)
+void Interpreter::define(const Token &name, const object::Object &value)
 {
-    if (auto it = locals.find(expr); it != locals.end()) {
-        int distance = locals.at(expr);
-        return environment->getAt(distance, name.lexeme);
+    if (environment == globals) {
+        globals->define(name.lexeme, value);
     } else {
-        return globals->get(name);
+        environment->define(value);
     }
 }
 
@@ -350,4 +1116,33 @@ void Interpreter::checkNumberOperands(const Token &op, const object::Object &lef
     throw RuntimeError{op, "Operands must be numbers"};
 }
 
+const object::Object &Interpreter::evaluateIndex(Expr *index, IndexShape &shape, object::Object &scratch)
+{
+    if (shape.kind == IndexShape::Kind::Unseen) {
+        auto literal = dynamic_cast<Literal *>(index);
+        shape.kind = literal ? IndexShape::Kind::Constant : IndexShape::Kind::Generic;
+        if (literal) {
+            shape.hash = object::Map::hash(literal->value);
+        }
+    }
+    if (shape.kind == IndexShape::Kind::Constant) {
+        count(Stats::Node::Literal);
+        return static_cast<Literal *>(index)->value;
+    }
+    scratch = evaluate(index);
+    return scratch;
+}
+
+std::size_t Interpreter::checkIndex(const Token &bracket, const object::List &list, const object::Object &index)
+{
+    auto number = std::get_if<object::Number>(&index);
+    if (!number or std::trunc(*number) != *number) {
+        throw RuntimeError{bracket, "List index must be a whole number"};
+    }
+    if (*number < 0 or *number >= static_cast<object::Number>(list.size())) {
+        throw RuntimeError{bracket, "List index out of range"};
+    }
+    return static_cast<std::size_t>(*number);
+}
+
 }  // namespace draft
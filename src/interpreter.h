@@ -2,16 +2,63 @@
 
 #include "ast.h"
 #include "environment.h"
+#include "isolate.h"
 #include "obj_function.h"
+#include "output.h"
+#include "parser.h"
+#include "scheduler.h"
+#include "stats.h"
 
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <unordered_set>
 #include <vector>
 
 namespace draft {
+class Profiler;
+namespace object {
+class Coroutine;
+}  // namespace object
 
 class Interpreter : public IExprVisitor<object::Object>, IStmtVisitor<void> {
 public:
-    Interpreter();
-    void interpret(const std::vector<Stmt *> &statements);
+    // Calls nested deeper than this raise a "Stack overflow" RuntimeError, as in the VM
+    static constexpr std::size_t DefaultMaxDepth = 1024;
+
+    explicit Interpreter(std::ostream &stream = std::cout);
+    // Closes the coroutines still suspended, so what they hold is released
+    ~Interpreter() override;
+    // Runs the statements, then the tasks they left. A runtime error is reported and exits
+    void interpret(std::span<Stmt *const> statements);
+    // Runs them as interpret() does, but a runtime error is returned instead, the interpreter being
+    // ready for another run with the globals defined so far
+    std::optional<RuntimeError> run(std::span<Stmt *const> statements);
+    // Calls `callee` from the host with `arguments`, setting `result`; errors as in run()
+    std::optional<RuntimeError> call(const object::Object &callee, object::Arguments arguments, object::Object &result);
+    // Calls `callee` from a native the way a call expression does, in a frame of its own that the
+    // profiler and stats see. What goes wrong is thrown, to be reported at the native's call
+    object::Object callFromNative(object::Callable &callee, object::Arguments arguments);
+    // The value of the global `name`, nullptr if there is none
+    const object::Object *getGlobal(std::string_view name) const;
+    // Makes `function` a global: the natives() are defined this way, and hosts can add their own
+    void defineNative(std::string_view name, object::CallablePtr function);
+    void setMaxDepth(std::size_t depth);
+    // Samples the calls in progress while interpret() runs, none when nullptr
+    void setProfiler(Profiler *profiler);
+    // Counts what the runs of interpret() do, nothing when nullptr
+    void setStats(Stats *stats);
+    const Stats *getStats() const;
+    // Where print writes; it is flushed as interpret() returns or reports an error
+    Output &getOutput();
+    // The isolate this interpreter runs, whose mailbox receive() reads
+    void setIsolate(Isolate::Id id);
+    Isolate::Id getIsolate() const;
+    // The tasks async() hands over, which interpret() runs to the end once the program is done
+    Scheduler &getScheduler();
+    // The innermost coroutine running, nullptr when the program itself is
+    object::Coroutine *getCoroutine() const;
 
     object::Object visit(Literal *expr) override;
     object::Object visit(Logical *expr) override;
@@ -25,6 +72,10 @@ public:
     object::Object visit(Set *expr) override;
     object::Object visit(Super *expr) override;
     object::Object visit(This *expr) override;
+    object::Object visit(ListExpr *expr) override;
+    object::Object visit(MapExpr *expr) override;
+    object::Object visit(GetIndex *expr) override;
+    object::Object visit(SetIndex *expr) override;
 
     void visit(ExprStmt *stmt) override;
     void visit(If *stmt) override;
@@ -32,26 +83,130 @@ public:
     void visit(Print *stmt) override;
     void visit(Return *stmt) override;
     void visit(While *stmt) override;
+    void visit(Yield *stmt) override;
     void visit(Block *stmt) override;
     void visit(Class *stmt) override;
     void visit(Var *stmt) override;
 
-    void resolve(Expr *expr, int depth);
-
 private:
+    // What a call expression calls, its arguments being on the value stack from `base`
+    struct Target {
+        object::Object callee;
+        object::InstancePtr receiver;
+        object::FunctionPtr method;
+        object::Callable *function = nullptr;
+        std::size_t base = 0;
+    };
+    // A call in tail position, made by Function::invoke once the returning body has unwound. The
+    // receiver is only set for a method called straight away
+    struct TailCall {
+        object::FunctionPtr function;
+        object::InstancePtr receiver;
+        std::size_t base = 0;
+    };
+
+    Target prepareCall(Call *expr);
+    void enterCall(const Token &paren, object::Callable *callee);
+    void leaveCall();
+
+    void count(Stats::Node node)
+    {
+        if (stats) {
+            stats->count(node);
+        }
+    }
+    void countProperty(const object::Instance &instance, std::string_view name);
+    void returnCall(Call *expr);
+
     object::Object evaluate(Expr *expr);
     void execute(Stmt *stmt);
-    void executeBlock(const std::vector<Stmt *> &stmts, EnvironmentPtr env);
-    object::Object lookUpVariable(Token name, Expr *expr);
+    void executeBlock(std::span<Stmt *const> stmts, const EnvironmentPtr &env);
+    EnvironmentPtr makeEnvironment(EnvironmentPtr enclosing);
+    void recycle(EnvironmentPtr env);
+    object::Object lookUpVariable(const Token &name, Slot slot);
+    object::FunctionPtr lookUpSuperMethod(Super *expr, object::InstancePtr &receiver);
+    void define(const Token &name, const object::Object &value);
+
+    object::Object binary(Binary *expr, const object::Object &left, const object::Object &right);
+    static object::Object numeric(Token::Kind op, object::Number left, object::Number right);
+    static bool compare(Token::Kind op, object::Number left, object::Number right);
+    static bool isComparison(Expr *expr);
+    static bool isStep(Assign *expr);
 
     void checkNumberOperand(const Token &op, const object::Object &operand);
     void checkNumberOperands(const Token &op, const object::Object &left, const object::Object &right);
+    // The value of an index expression: a literal one in place, anything else evaluated into
+    // `scratch`. Settles `shape` on first use
+    const object::Object &evaluateIndex(Expr *index, IndexShape &shape, object::Object &scratch);
+    // Where `index` points into `list`, failing unless it is a whole number within the bounds
+    static std::size_t checkIndex(const Token &bracket, const object::List &list, const object::Object &index);
+
+    object::Object takeReturnValue();
+
+    // Runs `body` with the native stack checked, the output flushed and the profile written as it
+    // ends, catching what stops it
+    std::optional<RuntimeError> guarded(const std::function<void()> &body);
+    // Forgets the calls a runtime error unwound
+    void recover();
 
-    std::map<Expr *, int> locals;
     EnvironmentPtr globals;
     EnvironmentPtr environment;
+    // Set by a return statement; blocks and loops stop executing until the function call that is
+    // returning collects the value
+    bool returning = false;
+    object::Object returnValue;
+
+    // Call arguments are evaluated onto this stack and passed as a span over it. Its storage is
+    // reserved up front, for StackMax slots or SlotsPerCall for every call of the maximum depth, and
+    // never moves during a run, so the span stays valid for the whole call; a coroutine's stack is
+    // reserved smaller
+    static constexpr std::size_t StackMax = 64 * 1024;
+    static constexpr std::size_t SlotsPerCall = 4;
+    std::vector<object::Object> stack;
+    // Environments nothing captured once their block or call finished, ready to be reused
+    std::vector<EnvironmentPtr> environmentPool;
+
+    // Callees of the calls in progress. Frames live on the heap, and the native stack the
+    // interpreter runs on is sized after the maximum depth, so both run out as a RuntimeError
+    // rather than a crash
+    std::vector<object::Callable *> frames;
+    std::size_t maxDepth = DefaultMaxDepth;
+    // Lowest address calls may use on the native stack, unknown if the bounds of the stack could
+    // not be found
+    const char *stackLimit = nullptr;
+    TailCall tailCall;
+
+    // The state a run of code changes as it goes, which each coroutine has its own of: swapped in
+    // while the coroutine runs and out again as it yields
+    struct Execution {
+        EnvironmentPtr environment;
+        bool returning = false;
+        object::Object returnValue;
+        std::vector<object::Object> stack;
+        std::vector<object::Callable *> frames;
+        const char *stackLimit = nullptr;
+        TailCall tailCall;
+#ifdef DRAFT_JIT
+        object::Function *running = nullptr;
+#endif
+    };
+    void swapExecution(Execution &execution);
+
+    object::Coroutine *coroutine = nullptr;
+    // Started and not finished, closed by the destructor
+    std::unordered_set<object::Coroutine *> coroutines;
+    Scheduler scheduler;
+    Profiler *profiler = nullptr;
+    Stats *stats = nullptr;
+    Output output;
+    Isolate::Id isolate = Isolate::Main;
+#ifdef DRAFT_JIT
+    // The function whose body is running, charged for the loop iterations it makes
+    object::Function *running = nullptr;
+#endif
 
     friend class object::Function;
+    friend class object::Coroutine;
 };
 
 }  // namespace draft
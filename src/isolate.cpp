@@ -0,0 +1,200 @@
+#include "isolate.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "builtin.h"
+#include "driver.h"
+#include "obj_list.h"
+#include "obj_map.h"
+
+namespace draft {
+
+namespace {
+
+struct Record {
+    std::optional<Isolate::Id> parent;
+    std::deque<object::Object> mailbox;
+    std::thread thread;
+    bool finished = false;
+    // In receive() with an empty mailbox, and told to give up on it
+    bool waiting = false;
+    bool starved = false;
+};
+
+// Every isolate there has been, by id. One lock guards them all: messages are whole values copied
+// on the sender's side, so it is only held to queue or dequeue them
+struct Registry {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Record> records = std::deque<Record>(1);
+    // Isolates that have not finished, and how many of them are waiting for a message
+    std::size_t alive = 1;
+    std::size_t waiting = 0;
+
+    Record &at(Isolate::Id id)
+    {
+        if (id >= records.size()) {
+            throw NativeError{"There is no isolate " + std::to_string(id)};
+        }
+        return records[id];
+    }
+
+    // Once every isolate left is waiting, none of them will ever be sent anything
+    void checkStarved()
+    {
+        if (waiting == 0 or waiting != alive) {
+            return;
+        }
+        for (Record &record : records) {
+            record.starved = record.waiting;
+        }
+        changed.notify_all();
+    }
+};
+
+// Never destroyed: a runtime error exits the process while isolates may still be running
+Registry &registry()
+{
+    static Registry *registry = new Registry;
+    return *registry;
+}
+
+// Copies the originals met so far, so shared and cyclic structure is copied as such
+using Copies = std::unordered_map<const void *, object::Object>;
+
+object::Object copy(const object::Object &value, Copies &copies)
+{
+    if (auto list = std::get_if<object::ListPtr>(&value)) {
+        if (auto it = copies.find(list->get()); it != copies.end()) {
+            return it->second;
+        }
+        auto clone = std::make_shared<object::List>();
+        copies.emplace(list->get(), clone);
+        for (std::size_t i = 0; i < (*list)->size(); i++) {
+            clone->push(copy((*list)->get(i), copies));
+        }
+        return clone;
+    }
+    if (auto map = std::get_if<object::MapPtr>(&value)) {
+        if (auto it = copies.find(map->get()); it != copies.end()) {
+            return it->second;
+        }
+        auto clone = std::make_shared<object::Map>();
+        copies.emplace(map->get(), clone);
+        for (const object::Map::Entry &entry : (*map)->entries()) {
+            clone->set(copy(entry.key, copies), copy(entry.value, copies), entry.hash);
+        }
+        return clone;
+    }
+    if (std::holds_alternative<object::CallablePtr>(value) or std::holds_alternative<object::InstancePtr>(value)) {
+        throw NativeError{"Only nil, booleans, numbers, strings, lists and maps can be sent"};
+    }
+    return value;
+}
+
+void finish(Isolate::Id id)
+{
+    Registry &isolates = registry();
+    std::lock_guard lock{isolates.mutex};
+    isolates.records[id].finished = true;
+    isolates.records[id].mailbox.clear();
+    isolates.alive--;
+    isolates.changed.notify_all();
+    isolates.checkStarved();
+}
+
+}  // namespace
+
+Isolate::Id Isolate::spawn(std::string source, Id parent)
+{
+    Registry &isolates = registry();
+    std::lock_guard lock{isolates.mutex};
+    auto id = static_cast<Id>(isolates.records.size());
+    Record &record = isolates.records.emplace_back();
+    record.parent = parent;
+    isolates.alive++;
+    record.thread = std::thread{[id, source = std::move(source)] {
+        Interpreter interpreter;
+        interpreter.setIsolate(id);
+        Driver::interpret(source, interpreter);
+        finish(id);
+    }};
+    return id;
+}
+
+void Isolate::send(Id to, const object::Object &value)
+{
+    Copies copies;
+    object::Object message = copy(value, copies);
+
+    Registry &isolates = registry();
+    std::lock_guard lock{isolates.mutex};
+    Record &record = isolates.at(to);
+    if (record.finished) {
+        return;
+    }
+    record.mailbox.push_back(std::move(message));
+    isolates.changed.notify_all();
+}
+
+object::Object Isolate::receive(Id self)
+{
+    Registry &isolates = registry();
+    std::unique_lock lock{isolates.mutex};
+    Record &record = isolates.at(self);
+    if (record.mailbox.empty()) {
+        record.waiting = true;
+        isolates.waiting++;
+        isolates.checkStarved();
+        isolates.changed.wait(lock, [&] { return !record.mailbox.empty() or record.starved; });
+        record.waiting = false;
+        record.starved = false;
+        isolates.waiting--;
+        if (record.mailbox.empty()) {
+            return object::Null{};
+        }
+    }
+    object::Object message = std::move(record.mailbox.front());
+    record.mailbox.pop_front();
+    return message;
+}
+
+std::optional<Isolate::Id> Isolate::parent(Id self)
+{
+    Registry &isolates = registry();
+    std::lock_guard lock{isolates.mutex};
+    return isolates.at(self).parent;
+}
+
+void Isolate::joinAll()
+{
+    Registry &isolates = registry();
+    {
+        std::lock_guard lock{isolates.mutex};
+        isolates.alive--;
+        isolates.checkStarved();
+    }
+    // Isolates may spawn more while the earlier ones are joined
+    for (std::size_t i = 1;; i++) {
+        std::thread thread;
+        {
+            std::lock_guard lock{isolates.mutex};
+            if (i >= isolates.records.size()) {
+                isolates.alive++;
+                isolates.records[Main].mailbox.clear();
+                break;
+            }
+            thread = std::move(isolates.records[i].thread);
+        }
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+}  // namespace draft
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "object.h"
+
+namespace draft {
+
+// An interpreter running on a thread of its own, with globals and objects of its own. Isolates
+// share nothing: a value sent from one to another is copied, and they know each other by id only.
+// The thread that runs the driver is the main isolate
+class Isolate {
+public:
+    using Id = std::uint32_t;
+    static constexpr Id Main = 0;
+
+    // Starts running `source` in a new isolate whose parent is `parent`
+    static Id spawn(std::string source, Id parent);
+    // Copies `value` into the mailbox of `to`. Nil, booleans, numbers, strings, and lists and maps
+    // of those can be sent; anything else, or an unknown id, throws NativeError. A message to an
+    // isolate that has finished is dropped
+    static void send(Id to, const object::Object &value);
+    // Takes the oldest message sent to `self`, waiting for one if there is none. Returns nil once no
+    // message can arrive any more: every other isolate has finished or is waiting too
+    static object::Object receive(Id self);
+    static std::optional<Id> parent(Id self);
+
+    // Called by the main isolate once its program is done: waits for every spawned isolate to
+    // finish. Isolates waiting for a message from the main one get nil
+    static void joinAll();
+};
+
+}  // namespace draft
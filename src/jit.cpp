@@ -0,0 +1,631 @@
+#include "jit.h"
+
+#include <bit>
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) and __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <unistd.h>
+#define DRAFT_JIT_X86_64
+#endif
+
+namespace draft::jit {
+
+Code::Code(void *memory, std::size_t size)
+    : memory{memory}
+    , length{size}
+{
+}
+
+Code::~Code()
+{
+#ifdef DRAFT_JIT_X86_64
+    ::munmap(memory, length);
+#endif
+}
+
+std::size_t Code::size() const
+{
+    return length;
+}
+
+#ifdef DRAFT_JIT_X86_64
+namespace {
+
+// Thrown at the first construct the compiler does not support
+struct Unsupported {};
+
+// Static type of a compiled value. Booleans are held as the doubles 0 and 1
+enum class Type { Number, Boolean };
+
+constexpr std::uint64_t SignBit = 0x8000000000000000;
+
+// Encodes the few x86-64 instructions the templates need. A value is computed into xmm0, the
+// pending left operands of binary operators wait on the machine stack, and locals are 8-byte
+// slots below rbp. rdi holds the arguments and rsi the result kind for the whole function, since
+// the generated code never calls out
+class Assembler {
+public:
+    void prologue()
+    {
+        // push rbp; mov rbp, rsp; sub rsp, frame size
+        emit({0x55, 0x48, 0x89, 0xE5, 0x48, 0x81, 0xEC});
+        frameSize = here();
+        emit32(0);
+    }
+
+    void epilogue(std::uint32_t slots)
+    {
+        // mov rsp, rbp; pop rbp; ret
+        emit({0x48, 0x89, 0xEC, 0x5D, 0xC3});
+        std::uint32_t size = (slots * 8 + 15) & ~15u;
+        std::memcpy(code.data() + frameSize, &size, sizeof(size));
+    }
+
+    // movsd xmm0, [rbp - 8 * (slot + 1)]
+    void loadSlot(std::uint32_t slot)
+    {
+        emit({0xF2, 0x0F, 0x10, 0x85});
+        emit32(static_cast<std::uint32_t>(-8 * static_cast<std::int32_t>(slot + 1)));
+    }
+
+    // movsd [rbp - 8 * (slot + 1)], xmm0
+    void storeSlot(std::uint32_t slot)
+    {
+        emit({0xF2, 0x0F, 0x11, 0x85});
+        emit32(static_cast<std::uint32_t>(-8 * static_cast<std::int32_t>(slot + 1)));
+    }
+
+    // movsd xmm0, [rdi + 8 * index]
+    void loadArgument(std::uint32_t index)
+    {
+        emit({0xF2, 0x0F, 0x10, 0x87});
+        emit32(8 * index);
+    }
+
+    void loadConstant(double value)
+    {
+        movRax(std::bit_cast<std::uint64_t>(value));
+        // movq xmm0, rax
+        emit({0x66, 0x48, 0x0F, 0x6E, 0xC0});
+    }
+
+    // Saves xmm0 while the right operand is computed
+    void push()
+    {
+        // movq rax, xmm0; push rax
+        emit({0x66, 0x48, 0x0F, 0x7E, 0xC0, 0x50});
+    }
+
+    // Moves the right operand to xmm1 and the saved left one back to xmm0
+    void popLeft()
+    {
+        // movapd xmm1, xmm0; pop rax; movq xmm0, rax
+        emit({0x66, 0x0F, 0x28, 0xC8, 0x58, 0x66, 0x48, 0x0F, 0x6E, 0xC0});
+    }
+
+    // xmm0 = xmm0 op xmm1
+    void arithmetic(Token::Kind op)
+    {
+        std::uint8_t opcode = 0;
+        switch (op) {
+        case Token::Kind::PlusSign:
+            opcode = 0x58;
+            break;
+        case Token::Kind::Asterisk:
+            opcode = 0x59;
+            break;
+        case Token::Kind::HyphenMinus:
+            opcode = 0x5C;
+            break;
+        case Token::Kind::Solidus:
+            opcode = 0x5E;
+            break;
+        default:
+            throw Unsupported{};
+        }
+        emit({0xF2, 0x0F, opcode, 0xC1});
+    }
+
+    // xmm0 = xmm0 op xmm1 as 1 or 0. An unordered comparison, with a NaN, is only true for !=
+    void compare(Token::Kind op)
+    {
+        switch (op) {
+        case Token::Kind::GreaterThanSign:
+            ucomisd(false);
+            emit({0x0F, 0x97, 0xC0});  // seta al
+            break;
+        case Token::Kind::GreaterEqual:
+            ucomisd(false);
+            emit({0x0F, 0x93, 0xC0});  // setae al
+            break;
+        case Token::Kind::LessThanSign:
+            ucomisd(true);
+            emit({0x0F, 0x97, 0xC0});  // seta al
+            break;
+        case Token::Kind::LessEqual:
+            ucomisd(true);
+            emit({0x0F, 0x93, 0xC0});  // setae al
+            break;
+        case Token::Kind::EqualEqual:
+            ucomisd(false);
+            emit({0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC1, 0x20, 0xC8});  // sete al; setnp cl; and al, cl
+            break;
+        case Token::Kind::ExclaimEqual:
+            ucomisd(false);
+            emit({0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8});  // setne al; setp cl; or al, cl
+            break;
+        default:
+            throw Unsupported{};
+        }
+        // movzx eax, al; cvtsi2sd xmm0, eax
+        emit({0x0F, 0xB6, 0xC0, 0xF2, 0x0F, 0x2A, 0xC0});
+    }
+
+    // xmm0 ^= mask, which negates a number or, with the bits of 1.0, a boolean
+    void flip(std::uint64_t mask)
+    {
+        movRax(mask);
+        // movq xmm1, rax; xorpd xmm0, xmm1
+        emit({0x66, 0x48, 0x0F, 0x6E, 0xC8, 0x66, 0x0F, 0x57, 0xC1});
+    }
+
+    // Jumps, to be patched, if xmm0 holds false or true
+    std::size_t jumpIfFalse()
+    {
+        test();
+        emit({0x0F, 0x84});
+        return placeholder();
+    }
+
+    std::size_t jumpIfTrue()
+    {
+        test();
+        emit({0x0F, 0x85});
+        return placeholder();
+    }
+
+    std::size_t jump()
+    {
+        emit({0xE9});
+        return placeholder();
+    }
+
+    void jumpBack(std::size_t target)
+    {
+        emit({0xE9});
+        emit32(static_cast<std::uint32_t>(target - (here() + 4)));
+    }
+
+    void patch(std::size_t jump)
+    {
+        auto offset = static_cast<std::uint32_t>(here() - (jump + 4));
+        std::memcpy(code.data() + jump, &offset, sizeof(offset));
+    }
+
+    // mov byte [rsi], kind
+    void setKind(Code::Kind kind)
+    {
+        emit({0xC6, 0x06, static_cast<std::uint8_t>(kind)});
+    }
+
+    std::size_t here() const
+    {
+        return code.size();
+    }
+
+    const std::vector<std::uint8_t> &bytes() const
+    {
+        return code;
+    }
+
+private:
+    void emit(std::initializer_list<std::uint8_t> bytes)
+    {
+        for (std::uint8_t byte : bytes) {
+            code.push_back(byte);
+        }
+    }
+
+    void emit32(std::uint32_t value)
+    {
+        for (int i = 0; i < 4; i++) {
+            code.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    // A rel32 to be patched once the target is known
+    std::size_t placeholder()
+    {
+        std::size_t at = here();
+        emit32(0);
+        return at;
+    }
+
+    // ucomisd xmm0, xmm1, or xmm1, xmm0 when swapped
+    void ucomisd(bool swapped)
+    {
+        emit({0x66, 0x0F, 0x2E, static_cast<std::uint8_t>(swapped ? 0xC8 : 0xC1)});
+    }
+
+    // mov rax, imm64
+    void movRax(std::uint64_t value)
+    {
+        emit({0x48, 0xB8});
+        emit32(static_cast<std::uint32_t>(value));
+        emit32(static_cast<std::uint32_t>(value >> 32));
+    }
+
+    // movq rax, xmm0; test rax, rax. Both doubles a boolean can be, 0 and 1, are told apart by
+    // their bits being zero
+    void test()
+    {
+        emit({0x66, 0x48, 0x0F, 0x7E, 0xC0, 0x48, 0x85, 0xC0});
+    }
+
+    std::vector<std::uint8_t> code;
+    std::size_t frameSize = 0;
+};
+
+// Walks a function once, emitting a template per node. Environments become scopes of slots laid
+// out like the Interpreter's, so the slots the Resolver recorded find their locals
+class Generator : public IExprVisitor<object::Object>, public IStmtVisitor<void> {
+public:
+    void function(FuncStmt *stmt)
+    {
+        if (stmt->params.size() > Compiler::MaxArguments) {
+            throw Unsupported{};
+        }
+        as.prologue();
+        scopes.emplace_back();
+        for (std::uint32_t i = 0; i < stmt->params.size(); i++) {
+            as.loadArgument(i);
+            declare(Type::Number);
+        }
+        for (Stmt *statement : stmt->body) {
+            execute(statement);
+        }
+        // Falling off the end returns nil
+        as.setKind(Code::Kind::Nil);
+        for (std::size_t jump : returns) {
+            as.patch(jump);
+        }
+        as.epilogue(slots);
+    }
+
+    const std::vector<std::uint8_t> &code() const
+    {
+        return as.bytes();
+    }
+
+private:
+    struct Local {
+        std::uint32_t slot = 0;
+        Type type = Type::Number;
+    };
+
+    object::Object visit(Literal *expr) override
+    {
+        if (auto number = std::get_if<object::Number>(&expr->value)) {
+            as.loadConstant(*number);
+            type = Type::Number;
+        } else if (auto boolean = std::get_if<object::Boolean>(&expr->value)) {
+            as.loadConstant(*boolean ? 1 : 0);
+            type = Type::Boolean;
+        } else {
+            throw Unsupported{};
+        }
+        return object::Null{};
+    }
+
+    object::Object visit(Logical *expr) override
+    {
+        expect(expr->left, Type::Boolean);
+        std::size_t skip = expr->op.kind == Token::Kind::Or ? as.jumpIfTrue() : as.jumpIfFalse();
+        expect(expr->right, Type::Boolean);
+        as.patch(skip);
+        return object::Null{};
+    }
+
+    object::Object visit(Unary *expr) override
+    {
+        Type operand = evaluate(expr->right);
+        if (expr->op.kind == Token::Kind::HyphenMinus and operand == Type::Number) {
+            as.flip(SignBit);
+            type = Type::Number;
+        } else if (expr->op.kind == Token::Kind::ExclamationMark and operand == Type::Boolean) {
+            as.flip(std::bit_cast<std::uint64_t>(1.0));
+            type = Type::Boolean;
+        } else if (expr->op.kind == Token::Kind::ExclamationMark) {
+            // Numbers are always truthy
+            as.loadConstant(0);
+            type = Type::Boolean;
+        } else {
+            throw Unsupported{};
+        }
+        return object::Null{};
+    }
+
+    object::Object visit(Binary *expr) override
+    {
+        // Operands seen as anything but numbers would fail the entry checks or leave the fast path
+        if (expr->feedback == Binary::Feedback::Strings or expr->feedback == Binary::Feedback::Generic) {
+            throw Unsupported{};
+        }
+        Type left = evaluate(expr->left);
+        as.push();
+        Type right = evaluate(expr->right);
+        as.popLeft();
+
+        switch (expr->op.kind) {
+        case Token::Kind::PlusSign:
+        case Token::Kind::HyphenMinus:
+        case Token::Kind::Asterisk:
+        case Token::Kind::Solidus:
+            if (left != Type::Number or right != Type::Number) {
+                throw Unsupported{};
+            }
+            as.arithmetic(expr->op.kind);
+            type = Type::Number;
+            break;
+        case Token::Kind::EqualEqual:
+        case Token::Kind::ExclaimEqual:
+            if (left != right) {
+                throw Unsupported{};
+            }
+            as.compare(expr->op.kind);
+            type = Type::Boolean;
+            break;
+        default:
+            if (left != Type::Number or right != Type::Number) {
+                throw Unsupported{};
+            }
+            as.compare(expr->op.kind);
+            type = Type::Boolean;
+            break;
+        }
+        return object::Null{};
+    }
+
+    object::Object visit(Grouping *expr) override
+    {
+        evaluate(expr->expression);
+        return object::Null{};
+    }
+
+    object::Object visit(Variable *expr) override
+    {
+        const Local &local = lookUp(expr->slot);
+        as.loadSlot(local.slot);
+        type = local.type;
+        return object::Null{};
+    }
+
+    object::Object visit(Assign *expr) override
+    {
+        const Local &local = lookUp(expr->slot);
+        expect(expr->value, local.type);
+        as.storeSlot(local.slot);
+        return object::Null{};
+    }
+
+    object::Object visit(Call *) override
+    {
+        throw Unsupported{};
+    }
+
+    object::Object visit(Get *) override
+    {
+        throw Unsupported{};
+    }
+
+    object::Object visit(Set *) override
+    {
+        throw Unsupported{};
+    }
+
+    object::Object visit(Super *) override
+    {
+        throw Unsupported{};
+    }
+
+    object::Object visit(This *) override
+    {
+        throw Unsupported{};
+    }
+
+    object::Object visit(ListExpr *) override
+    {
+        throw Unsupported{};
+    }
+
+    object::Object visit(MapExpr *) override
+    {
+        throw Unsupported{};
+    }
+
+    object::Object visit(GetIndex *) override
+    {
+        throw Unsupported{};
+    }
+
+    object::Object visit(SetIndex *) override
+    {
+        throw Unsupported{};
+    }
+
+    void visit(ExprStmt *stmt) override
+    {
+        evaluate(stmt->expression);
+    }
+
+    void visit(If *stmt) override
+    {
+        expect(stmt->condition, Type::Boolean);
+        std::size_t elseJump = as.jumpIfFalse();
+        execute(stmt->thenBranch);
+        if (stmt->elseBranch) {
+            std::size_t endJump = as.jump();
+            as.patch(elseJump);
+            execute(stmt->elseBranch);
+            as.patch(endJump);
+        } else {
+            as.patch(elseJump);
+        }
+    }
+
+    void visit(Return *stmt) override
+    {
+        if (stmt->value) {
+            Type value = evaluate(stmt->value);
+            as.setKind(value == Type::Number ? Code::Kind::Number : Code::Kind::Boolean);
+        } else {
+            as.setKind(Code::Kind::Nil);
+        }
+        returns.push_back(as.jump());
+    }
+
+    void visit(While *stmt) override
+    {
+        std::size_t start = as.here();
+        expect(stmt->condition, Type::Boolean);
+        std::size_t exitJump = as.jumpIfFalse();
+        execute(stmt->body);
+        as.jumpBack(start);
+        as.patch(exitJump);
+    }
+
+    void visit(Yield *) override
+    {
+        throw Unsupported{};
+    }
+
+    void visit(Block *stmt) override
+    {
+        // Like the Resolver, only a block declaring names has a scope
+        if (stmt->scoped) {
+            scopes.emplace_back();
+        }
+        for (Stmt *statement : stmt->statements) {
+            execute(statement);
+        }
+        if (stmt->scoped) {
+            scopes.pop_back();
+        }
+    }
+
+    void visit(Var *stmt) override
+    {
+        if (!stmt->initializer) {
+            throw Unsupported{};
+        }
+        declare(evaluate(stmt->initializer));
+    }
+
+    void visit(Print *) override
+    {
+        throw Unsupported{};
+    }
+
+    void visit(FuncStmt *) override
+    {
+        throw Unsupported{};
+    }
+
+    void visit(Class *) override
+    {
+        throw Unsupported{};
+    }
+
+    Type evaluate(Expr *expr)
+    {
+        expr->accept(static_cast<IExprVisitor<object::Object> *>(this));
+        return type;
+    }
+
+    void expect(Expr *expr, Type expected)
+    {
+        if (evaluate(expr) != expected) {
+            throw Unsupported{};
+        }
+    }
+
+    void execute(Stmt *stmt)
+    {
+        stmt->accept(static_cast<IStmtVisitor<void> *>(this));
+    }
+
+    // Stores xmm0 in a new slot, as the next local of the innermost scope
+    void declare(Type type)
+    {
+        as.storeSlot(slots);
+        scopes.back().push_back(Local{slots++, type});
+    }
+
+    // Globals and variables captured from an enclosing function have no slot here
+    const Local &lookUp(Slot slot)
+    {
+        if (!slot.isLocal() or static_cast<std::size_t>(slot.depth) >= scopes.size()) {
+            throw Unsupported{};
+        }
+        const std::vector<Local> &scope = scopes[scopes.size() - 1 - static_cast<std::size_t>(slot.depth)];
+        if (slot.index >= scope.size()) {
+            throw Unsupported{};
+        }
+        return scope[slot.index];
+    }
+
+    Assembler as;
+    Type type = Type::Number;
+    std::vector<std::vector<Local>> scopes;
+    std::uint32_t slots = 0;
+    std::vector<std::size_t> returns;
+};
+
+std::unique_ptr<Code> install(const std::vector<std::uint8_t> &bytes)
+{
+    auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t size = (bytes.size() + page - 1) / page * page;
+    void *memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(memory, bytes.data(), bytes.size());
+    // Never writable and executable at once
+    if (::mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        ::munmap(memory, size);
+        return nullptr;
+    }
+    return std::make_unique<Code>(memory, size);
+}
+
+}  // namespace
+#endif
+
+const Code *Compiler::compile(FuncStmt *function)
+{
+    if (std::exchange(function->compiled, true)) {
+        return function->code.get();
+    }
+#ifdef DRAFT_JIT_X86_64
+    try {
+        Generator generator;
+        generator.function(function);
+        function->code = install(generator.code());
+    } catch (const Unsupported &) {
+        // Stays in the interpreter
+    }
+#endif
+    return function->code.get();
+}
+
+Compiler &compiler()
+{
+    thread_local Compiler compiler;
+    return compiler;
+}
+
+}  // namespace draft::jit
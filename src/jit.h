@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "ast.h"
+
+namespace draft::jit {
+
+// Native code for one function, in a mapping of its own that is executable and no longer writable.
+// Arguments are passed as doubles, and since one function may return a number, a boolean or
+// nothing, the kind of the result is written through `kind`; a boolean comes back as 0 or 1
+class Code {
+public:
+    enum class Kind : std::uint8_t { Nil, Boolean, Number };
+    using Entry = double (*)(const double *arguments, Kind *kind);
+
+    Code(void *memory, std::size_t size);
+    ~Code();
+
+    double run(const double *arguments, Kind &kind) const
+    {
+        return reinterpret_cast<Entry>(memory)(arguments, &kind);
+    }
+
+    std::size_t size() const;
+
+private:
+    Code(const Code &other) = delete;
+    Code &operator=(const Code &other) = delete;
+
+    void *memory = nullptr;
+    std::size_t length = 0;
+};
+
+// Baseline compiler for the tree-walking interpreter's hot functions. It supports functions whose
+// parameters are numbers and whose body is locals, assignments, arithmetic, comparisons, logical
+// operators, if, while and return over numbers and booleans. Anything else, such as a call, a
+// global or a captured variable, keeps the function in the interpreter, and so does type feedback
+// showing an operator saw anything but numbers. Compiled code only checks its argument types on
+// entry: from there on every type is known, so a call whose arguments fail the check simply runs
+// in the interpreter instead
+class Compiler {
+public:
+    // Calls plus loop iterations after which a function is compiled
+    static constexpr std::size_t Threshold = 1000;
+    static constexpr std::size_t MaxArguments = 8;
+
+    // Code for the function, compiled the first time it is asked for and kept by the FuncStmt, so
+    // it goes when the tree does. nullptr when the function can't be compiled, or when there is no
+    // backend for this machine
+    const Code *compile(FuncStmt *function);
+};
+
+// The compiler of the calling thread, used by every interpreter running on it
+Compiler &compiler();
+
+}  // namespace draft::jit
@@ -1,8 +1,10 @@
 #include <iomanip>
 #include <iostream>
 
+#include "char_class.h"
 #include "driver.h"
 #include "lexer.h"
+#include "scan.h"
 
 namespace draft {
 
@@ -11,16 +13,37 @@ Lexer::Lexer(std::string_view source)
 {
 }
 
-std::vector<Token> Lexer::scanTokens()
+Lexer::Lexer(SourceReader &reader)
+    : reader{&reader}
 {
-    while (!isAtEnd()) {
+}
+
+Token Lexer::next()
+{
+    while (true) {
+        current = scan::skipWhitespace(source, current, line);
         // We are at the beginning of the next lexeme
         start = current;
+        if (isAtEnd()) {
+            if (refill()) {
+                continue;
+            }
+            return Token{Token::Kind::EndOfFile, "", line};
+        }
+        scanned.reset();
         scanToken();
+        if (scanned) {
+            return *scanned;
+        }
     }
+}
 
-    Token eof{Token::Kind::EndOfFile, "", object::Null{}, line};
-    tokens.emplace_back(std::move(eof));
+std::vector<Token> Lexer::scanTokens()
+{
+    std::vector<Token> tokens;
+    do {
+        tokens.push_back(next());
+    } while (tokens.back().kind != Token::Kind::EndOfFile);
     return tokens;
 }
 
@@ -29,6 +52,17 @@ bool Lexer::isAtEnd()
     return current >= source.length();
 }
 
+bool Lexer::refill()
+{
+    if (!reader or !reader->next(source.length() - start)) {
+        return false;
+    }
+    source = reader->text();
+    current -= start;
+    start = 0;
+    return true;
+}
+
 void Lexer::scanToken()
 {
     char c = advance();
@@ -45,6 +79,15 @@ void Lexer::scanToken()
     case '}':
         addToken(Token::Kind::RightCurlyBracket);
         break;
+    case '[':
+        addToken(Token::Kind::LeftSquareBracket);
+        break;
+    case ']':
+        addToken(Token::Kind::RightSquareBracket);
+        break;
+    case ':':
+        addToken(Token::Kind::Colon);
+        break;
     case ',':
         addToken(Token::Kind::Comma);
         break;
@@ -78,9 +121,7 @@ void Lexer::scanToken()
     case '/':
         if (match('/')) {
             // A comment goes until the end of the line
-            while (peek() != '\n' and !isAtEnd()) {
-                advance();
-            }
+            current = scan::find(source, current, '\n', line);
         } else {
             addToken(Token::Kind::Solidus);
         }
@@ -118,7 +159,7 @@ void Lexer::scanToken()
 
 char Lexer::advance()
 {
-    return source.at(current++);
+    return source[current++];
 }
 
 bool Lexer::match(char expected)
@@ -126,7 +167,7 @@ bool Lexer::match(char expected)
     if (isAtEnd()) {
         return false;
     }
-    if (source.at(current) != expected) {
+    if (source[current] != expected) {
         return false;
     }
     current++;
@@ -138,7 +179,7 @@ char Lexer::peek()
     if (isAtEnd()) {
         return '\0';
     }
-    return source.at(current);
+    return source[current];
 }
 
 char Lexer::peekNext()
@@ -146,16 +187,14 @@ char Lexer::peekNext()
     if (current + 1 >= source.length()) {
         return '\0';
     }
-    return source.at(current + 1);
+    return source[current + 1];
 }
 
 void Lexer::string(char quote)
 {
-    while (peek() != quote and not isAtEnd()) {
-        if (peek() == '\n') {
-            line++;
-        }
-        advance();
+    current = scan::find(source, current, quote, line);
+    while (isAtEnd() and refill()) {
+        current = scan::find(source, current, quote, line);
     }
 
     if (isAtEnd()) {
@@ -165,39 +204,26 @@ void Lexer::string(char quote)
 
     // The closing quote
     advance();
-
-    std::string_view value = substr();
-    // Trim the surrounding quotes
-    value.remove_prefix(1);
-    value.remove_suffix(1);
-    addToken(Token::Kind::StringLiteral, object::String{value});
+    addToken(Token::Kind::StringLiteral);
 }
 
 void Lexer::number()
 {
-    while (isDigit(peek())) {
-        advance();
-    }
+    current = scan::skipDigits(source, current);
 
     // Look for a fractional part
     if (peek() == '.' and isDigit(peekNext())) {
         // Consume the "."
         advance();
-
-        while (isDigit(peek())) {
-            advance();
-        }
+        current = scan::skipDigits(source, current);
     }
 
-    double value = std::stod(std::string{substr()});
-    addToken(Token::Kind::NumberLiteral, object::Number{value});
+    addToken(Token::Kind::NumberLiteral);
 }
 
 void Lexer::identifier()
 {
-    while (isAlphaNumeric(peek())) {
-        advance();
-    }
+    current = scan::skipAlphaNumeric(source, current);
 
     auto maybeKeyword = [](std::string_view sv) {
 #define KEYWORD(kind, name)       \
@@ -213,28 +239,17 @@ void Lexer::identifier()
 
 void Lexer::addToken(Token::Kind kind)
 {
-    addToken(kind, object::Null{});
-}
-
-void Lexer::addToken(Token::Kind kind, object::Object literal)
-{
-    Token t{kind, std::string{substr()}, literal, line};
-    tokens.emplace_back(std::move(t));
+    scanned.emplace(kind, substr(), line);
 }
 
 bool Lexer::isDigit(char c)
 {
-    return c >= '0' and c <= '9';
+    return hasClass(c, Digit);
 }
 
 bool Lexer::isAlpha(char c)
 {
-    return (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or c == '_';
-}
-
-bool Lexer::isAlphaNumeric(char c)
-{
-    return isAlpha(c) or isDigit(c);
+    return hasClass(c, Alpha);
 }
 
 std::string_view Lexer::substr()
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <optional>
 #include <string_view>
 #include <vector>
 
+#include "source_reader.h"
 #include "token.h"
 
 namespace draft {
@@ -10,12 +12,19 @@ namespace draft {
 class Lexer {
 public:
     explicit Lexer(std::string_view source);
+    // Lexes the input chunk by chunk as the reader provides it
+    explicit Lexer(SourceReader &reader);
+
+    // Scans the next token on demand, then keeps returning EndOfFile once the input is exhausted
+    Token next();
 
     std::vector<Token> scanTokens();
 
 private:
     bool isAtEnd();
     void scanToken();
+    // Continues into the next chunk of the reader, carrying over the lexeme scanned so far
+    bool refill();
 
     char advance();
     bool match(char expected);
@@ -27,21 +36,20 @@ private:
     void identifier();
 
     void addToken(Token::Kind kind);
-    void addToken(Token::Kind kind, object::Object literal);
 
     bool isDigit(char c);
     bool isAlpha(char c);
-    bool isAlphaNumeric(char c);
 
     std::string_view substr();
 
     void scanError(const std::string &message);
 
+    SourceReader *reader = nullptr;
     std::string_view source;
-    std::vector<Token> tokens;
+    std::optional<Token> scanned;
 
     std::size_t start = 0;
     std::size_t current = 0;
-    std::size_t line = 1;
+    std::uint32_t line = 1;
 };
 }  // namespace draft
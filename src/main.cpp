@@ -1,14 +1,75 @@
+#include <charconv>
 #include <vector>
 
 #include "driver.h"
+#include "optimizer.h"
 
 int processCommandLine(const std::vector<std::string> &args)
 {
     using namespace draft;
-    if (args.size() > 1) {
+    Driver::Options options;
+    std::vector<std::string> files;
+    for (const std::string &arg : args) {
+        if (arg == "--engine=tree") {
+            options.engine = Driver::Engine::TreeWalker;
+        } else if (arg == "--engine=vm") {
+            options.engine = Driver::Engine::VM;
+        } else if (arg.starts_with("--cache-dir=")) {
+            options.cacheDirectory = arg.substr(std::string_view{"--cache-dir="}.size());
+        } else if (arg.starts_with("--max-depth=")) {
+            std::string_view depth = std::string_view{arg}.substr(std::string_view{"--max-depth="}.size());
+            auto [end, error] = std::from_chars(depth.data(), depth.data() + depth.size(), options.maxCallDepth);
+            if (error != std::errc{} or end != depth.data() + depth.size() or options.maxCallDepth == 0) {
+                return Driver::usage();
+            }
+        } else if (arg.starts_with("--output-buffer=")) {
+            std::string_view bytes = std::string_view{arg}.substr(std::string_view{"--output-buffer="}.size());
+            auto [end, error] = std::from_chars(bytes.data(), bytes.data() + bytes.size(), options.outputBuffer);
+            if (error != std::errc{} or end != bytes.data() + bytes.size()) {
+                return Driver::usage();
+            }
+        } else if (arg.starts_with("--jobs=")) {
+            std::string_view jobs = std::string_view{arg}.substr(std::string_view{"--jobs="}.size());
+            auto [end, error] = std::from_chars(jobs.data(), jobs.data() + jobs.size(), options.jobs);
+            if (error != std::errc{} or end != jobs.data() + jobs.size()) {
+                return Driver::usage();
+            }
+        } else if (arg == "--profile") {
+            options.profile = "draft.folded";
+        } else if (arg.starts_with("--profile=")) {
+            options.profile = arg.substr(std::string_view{"--profile="}.size());
+            if (options.profile.empty()) {
+                return Driver::usage();
+            }
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg.starts_with("-O")) {
+            int level = arg.size() == 3 ? arg[2] - '0' : -1;
+            if (level < 0 or level > Optimizer::MaxLevel) {
+                return Driver::usage();
+            }
+            options.optimization = level;
+        } else if (arg.starts_with("--")) {
+            return Driver::usage();
+        } else {
+            files.push_back(arg);
+        }
+    }
+    // Only the tree-walker keeps a call stack to sample and counts what it does
+    if (!options.profile.empty() and options.engine != Driver::Engine::TreeWalker) {
+        io::writeLine("--profile requires --engine=tree", std::cerr);
+        return Driver::usage();
+    }
+    if (options.stats and options.engine != Driver::Engine::TreeWalker) {
+        io::writeLine("--stats requires --engine=tree", std::cerr);
         return Driver::usage();
-    } else if (args.size() == 1) {
-        return Driver::runFile(args.at(0));
+    }
+    Driver::configure(options);
+
+    if (files.size() > 1) {
+        return Driver::runFiles(files);
+    } else if (files.size() == 1) {
+        return Driver::runFile(files.at(0));
     }
     return Driver::runPrompt();
 }
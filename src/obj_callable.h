@@ -1,15 +1,21 @@
 #pragma once
 
+#include <span>
+
 #include "object.h"
 
 namespace draft::object {
 
+// Arguments of a call, viewing the interpreter's value stack. They are only valid until the callee
+// starts evaluating code of its own, so a callee copies out what it keeps
+using Arguments = std::span<const Object>;
+
 class Callable {
 public:
     virtual ~Callable() = default;
 
     virtual std::size_t arity() = 0;
-    virtual Object call(Interpreter *interpreter, std::vector<Object> arguments) = 0;
+    virtual Object call(Interpreter *interpreter, Arguments arguments) = 0;
 };
 
 }  // namespace draft::object
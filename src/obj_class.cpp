@@ -3,39 +3,41 @@
 #include "obj_instance.h"
 
 namespace draft::object {
-Class::Class(std::string name, ClassPtr superclass, std::map<std::string, object::FunctionPtr> methods)
-    : name{name}
-    , methods{methods}
-    , superclass{superclass}
+Class::Class(std::string name, ClassPtr superclass, MethodTable methods)
+    : name{std::move(name)}
+    , methods{std::move(methods)}
+    , superclass{std::move(superclass)}
 {
+    if (this->superclass) {
+        for (const auto &[methodName, method] : this->superclass->methods) {
+            this->methods.try_emplace(methodName, method);
+        }
+    }
+    initializer = findMethod("init");
 }
 
 std::size_t Class::arity()
 {
-    auto initializer = findMethod("init");
     if (initializer) {
         return initializer->arity();
     }
     return 0;
 }
 
-Object Class::call(Interpreter *interpreter, std::vector<Object> arguments)
+Object Class::call(Interpreter *interpreter, Arguments arguments)
 {
-    auto instance = std::make_shared<Instance>(*this);
-    auto initializer = findMethod("init");
+    // Instances share the class rather than copying its name and method table
+    auto instance = std::make_shared<Instance>(shared_from_this());
     if (initializer) {
-        initializer->bind(instance)->call(interpreter, arguments);
+        initializer->invoke(interpreter, instance, arguments);
     }
     return instance;
 }
 
-FunctionPtr Class::findMethod(std::string name)
+FunctionPtr Class::findMethod(std::string_view name) const
 {
-    if (methods.contains(name)) {
-        return methods.at(name);
-    }
-    if (superclass) {
-        return superclass->findMethod(name);
+    if (auto it = methods.find(name); it != methods.end()) {
+        return it->second;
     }
     return nullptr;
 }
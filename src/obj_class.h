@@ -1,6 +1,7 @@
 #pragma once
 
-#include <map>
+#include <string_view>
+#include <unordered_map>
 
 #include "obj_callable.h"
 #include "obj_function.h"
@@ -9,18 +10,30 @@ namespace draft::object {
 class Class;
 using ClassPtr = std::shared_ptr<Class>;
 
-class Class : public Callable {
+class Class : public Callable, public std::enable_shared_from_this<Class> {
 public:
-    Class(std::string name, ClassPtr superclass, std::map<std::string, object::FunctionPtr> methods);
+    // Hashes names transparently, so a method can be looked up by a token's lexeme
+    struct NameHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const
+        {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+    using MethodTable = std::unordered_map<std::string, object::FunctionPtr, NameHash, std::equal_to<>>;
+
+    Class(std::string name, ClassPtr superclass, MethodTable methods);
 
     std::size_t arity() override;
-    object::Object call(Interpreter *interpreter, std::vector<Object> arguments) override;
+    object::Object call(Interpreter *interpreter, Arguments arguments) override;
 
-    object::FunctionPtr findMethod(std::string name);
+    object::FunctionPtr findMethod(std::string_view name) const;
 
     std::string name;
 
-    std::map<std::string, object::FunctionPtr> methods;
+    // Own methods merged over the inherited ones, so a lookup never walks the superclass chain
+    MethodTable methods;
+    object::FunctionPtr initializer;
     ClassPtr superclass;
 };
 
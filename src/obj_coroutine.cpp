@@ -0,0 +1,161 @@
+#include "obj_coroutine.h"
+
+#include <utility>
+
+#if __has_include(<ucontext.h>) and __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <ucontext.h>
+#define DRAFT_HAS_UCONTEXT
+#endif
+
+#include "builtin.h"
+#include "interpreter.h"
+
+namespace draft::object {
+
+namespace {
+
+// Native stack of a coroutine. It is reserved rather than committed, so only the pages a body
+// touches take memory. A guard page below its end turns an overflow the checks miss into a crash
+constexpr std::size_t NativeStack = 2 * 1024 * 1024;
+constexpr std::size_t GuardPage = 4096;
+// Kept free below the limit the interpreter checks calls against, as on its own stack
+constexpr std::size_t NativeStackMargin = 128 * 1024;
+// Arguments a coroutine's calls may have pending at once on its value stack
+constexpr std::size_t ValueStack = 4096;
+
+// Thrown at the yield a closing coroutine is suspended at, and caught where its body started
+struct Closing {};
+
+thread_local Coroutine *starting = nullptr;
+
+}  // namespace
+
+struct Coroutine::Context {
+    Interpreter::Execution execution;
+#ifdef DRAFT_HAS_UCONTEXT
+    ~Context()
+    {
+        munmap(stack, NativeStack);
+    }
+
+    void *stack = nullptr;
+    ucontext_t self;
+    ucontext_t caller;
+#endif
+};
+
+Coroutine::Coroutine(FunctionPtr function, InstancePtr receiver, Arguments arguments)
+    : function{std::move(function)}
+    , receiver{std::move(receiver)}
+    , arguments{arguments.begin(), arguments.end()}
+{
+#ifndef DRAFT_HAS_UCONTEXT
+    throw NativeError{"Coroutines are not supported on this platform"};
+#endif
+}
+
+Coroutine::~Coroutine()
+{
+    close();
+}
+
+std::size_t Coroutine::arity()
+{
+    return 0;
+}
+
+Object Coroutine::call(Interpreter *interpreter, Arguments)
+{
+    return resume(interpreter);
+}
+
+Object Coroutine::resume(Interpreter *interpreter)
+{
+    if (done) {
+        return Null{};
+    }
+    if (running) {
+        throw NativeError{"A coroutine can't resume itself"};
+    }
+#ifdef DRAFT_HAS_UCONTEXT
+    if (!context) {
+        auto made = std::make_unique<Context>();
+        made->stack = mmap(nullptr, NativeStack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (made->stack == MAP_FAILED or getcontext(&made->self) != 0) {
+            made->stack = nullptr;
+            throw NativeError{"Out of memory for a coroutine"};
+        }
+        mprotect(made->stack, GuardPage, PROT_NONE);
+        made->self.uc_stack.ss_sp = made->stack;
+        made->self.uc_stack.ss_size = NativeStack;
+        made->self.uc_link = &made->caller;
+        makecontext(&made->self, [] { starting->run(); }, 0);
+
+        Interpreter::Execution &execution = made->execution;
+        execution.environment = interpreter->globals;
+        execution.stack.reserve(ValueStack);
+        execution.stackLimit = static_cast<const char *>(made->stack) + GuardPage + NativeStackMargin;
+        context = std::move(made);
+        this->interpreter = interpreter;
+        interpreter->coroutines.insert(this);
+        starting = this;
+    }
+
+    running = true;
+    Coroutine *outer = std::exchange(interpreter->coroutine, this);
+    interpreter->swapExecution(context->execution);
+    swapcontext(&context->caller, &context->self);
+    interpreter->swapExecution(context->execution);
+    interpreter->coroutine = outer;
+    running = false;
+
+    if (done) {
+        interpreter->coroutines.erase(this);
+        context.reset();
+    }
+    if (error) {
+        std::rethrow_exception(std::exchange(error, nullptr));
+    }
+#else
+    (void)interpreter;
+#endif
+    return std::exchange(yielded, Null{});
+}
+
+void Coroutine::run()
+{
+    try {
+        returned = function->execute(interpreter, receiver, arguments);
+        yielded = returned;
+    } catch (const Closing &) {
+    } catch (...) {
+        error = std::current_exception();
+    }
+    done = true;
+    // Returning switches to the caller, through uc_link
+}
+
+void Coroutine::suspend(Object value)
+{
+#ifdef DRAFT_HAS_UCONTEXT
+    yielded = std::move(value);
+    swapcontext(&context->self, &context->caller);
+    if (closing) {
+        throw Closing{};
+    }
+#else
+    (void)value;
+#endif
+}
+
+void Coroutine::close()
+{
+    if (!context or done or running) {
+        return;
+    }
+    closing = true;
+    resume(interpreter);
+}
+
+}  // namespace draft::object
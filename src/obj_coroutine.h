@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "obj_callable.h"
+#include "obj_function.h"
+
+namespace draft::object {
+
+// A call of a function that yields, made by calling the function. The body runs on a native stack
+// of its own, so it can be suspended wherever it is: at a yield, or for a task, at a sleep() or
+// await() however deep in its calls. Calling the coroutine resumes it: the call returns the value
+// yielded, or once the body has returned, what it returned and then nil
+class Coroutine : public Callable {
+public:
+    Coroutine(FunctionPtr function, InstancePtr receiver, Arguments arguments);
+    // A suspended body is unwound first, so what its frames hold is released
+    ~Coroutine() override;
+
+    std::size_t arity() override;
+    Object call(Interpreter *interpreter, Arguments arguments) override;
+
+    // Runs the body up to its next yield or its end, on behalf of `interpreter`
+    Object resume(Interpreter *interpreter);
+    // Called by the body, on the coroutine's own stack: hands `value` to resume() and returns once
+    // the coroutine is resumed again
+    void suspend(Object value);
+    // Unwinds a suspended body, leaving the coroutine finished
+    void close();
+
+    bool isDone() const
+    {
+        return done;
+    }
+    bool isRunning() const
+    {
+        return running;
+    }
+    // What the body returned, nil until it has
+    const Object &result() const
+    {
+        return returned;
+    }
+
+    // Kept by the Scheduler for a task: when it may run next, and what it waits for to finish
+    std::optional<std::chrono::steady_clock::time_point> wakeAt;
+    std::shared_ptr<Coroutine> awaiting;
+    bool scheduled = false;
+
+private:
+    struct Context;
+
+    void run();
+
+    FunctionPtr function;
+    InstancePtr receiver;
+    std::vector<Object> arguments;
+    // Made on the first resume, together with the native stack
+    std::unique_ptr<Context> context;
+    Interpreter *interpreter = nullptr;
+    Object yielded;
+    Object returned;
+    std::exception_ptr error;
+    bool running = false;
+    bool done = false;
+    bool closing = false;
+};
+
+using CoroutinePtr = std::shared_ptr<Coroutine>;
+
+}  // namespace draft::object
@@ -1,19 +1,19 @@
 #include "obj_function.h"
 
+#include <array>
+#include <utility>
+
 #include "interpreter.h"
+#include "obj_coroutine.h"
+#include "profiler.h"
 
 namespace draft {
-ReturnEx::ReturnEx(object::Object value)
-    : std::runtime_error{""}
-    , value{std::move(value)}
-{
-}
-
 namespace object {
-Function::Function(FuncStmt *declaration, EnvironmentPtr closure, bool isInitializer)
+Function::Function(FuncStmt *declaration, EnvironmentPtr closure, bool isInitializer, InstancePtr receiver)
     : declaration{declaration}
-    , closure{closure}
+    , closure{std::move(closure)}
     , isInitializer{isInitializer}
+    , receiver{std::move(receiver)}
 {
 }
 
@@ -25,36 +25,133 @@ std::size_t Function::arity()
     return 0;
 }
 
-object::Object Function::call(Interpreter *interpreter, std::vector<object::Object> arguments)
+object::Object Function::call(Interpreter *interpreter, Arguments arguments)
+{
+    return invoke(interpreter, receiver, arguments);
+}
+
+object::Object Function::invoke(Interpreter *interpreter, const InstancePtr &self, Arguments arguments)
 {
     if (!declaration) {
         return Null{};
     }
-    EnvironmentPtr env = std::make_shared<Environment>(closure);
-    auto params = declaration->params;
-    for (std::size_t i = 0; i < params.size(); ++i) {
-        env->define(params.at(i).lexeme, arguments.at(i));
+    if (declaration->generator) {
+        return coroutine(self, arguments);
     }
-    try {
-        interpreter->executeBlock(declaration->body, env);
-    } catch (const ReturnEx &returnValue) {
-        if (isInitializer) {
-            return closure->getAt(0, "this");
+#ifdef DRAFT_JIT
+    // Plain functions get native code once they are hot, methods always run here
+    if (!self) {
+        if (!tieredUp and ++hotness >= jit::Compiler::Threshold) {
+            tieredUp = true;
+            code = jit::compiler().compile(declaration);
+        }
+        if (code) {
+            if (std::optional<Object> result = runNative(arguments)) {
+                return *result;
+            }
         }
-        return returnValue.value;
     }
-    if (isInitializer) {
-        return closure->getAt(0, "this");
+#endif
+    return execute(interpreter, self, arguments);
+}
+
+Object Function::execute(Interpreter *interpreter, const InstancePtr &self, Arguments arguments)
+{
+#ifdef DRAFT_JIT
+    // The caller is running again however the body is left, a runtime error included
+    struct Restore {
+        Interpreter *interpreter;
+        Function *caller;
+        ~Restore()
+        {
+            interpreter->running = caller;
+        }
+    } restore{interpreter, interpreter->running};
+#endif
+    // A call in tail position takes over this invocation, so a chain of them runs in constant
+    // space. `callee` keeps the function that took over alive
+    Function *function = this;
+    FunctionPtr callee;
+    InstancePtr receiver = self;
+    EnvironmentPtr env = interpreter->makeEnvironment(closure);
+    if (receiver) {
+        env->define(receiver);
     }
+    for (const object::Object &argument : arguments) {
+        env->define(argument);
+    }
+    while (true) {
+#ifdef DRAFT_JIT
+        interpreter->running = function;
+#endif
+        interpreter->executeBlock(function->declaration->body, env);
+        interpreter->recycle(std::move(env));
+        if (!interpreter->tailCall.function) {
+            break;
+        }
 
+        Interpreter::TailCall next = std::exchange(interpreter->tailCall, {});
+        callee = std::move(next.function);
+        function = callee.get();
+        receiver = next.receiver ? std::move(next.receiver) : function->receiver;
+        env = interpreter->makeEnvironment(function->closure);
+        if (receiver) {
+            env->define(receiver);
+        }
+        for (std::size_t i = next.base; i < interpreter->stack.size(); i++) {
+            env->define(interpreter->stack[i]);
+        }
+        interpreter->stack.resize(next.base);
+        interpreter->returning = false;
+        if (!interpreter->frames.empty()) {
+            interpreter->frames.back() = function;
+        }
+        if (interpreter->profiler) {
+            interpreter->profiler->count(function);
+        }
+    }
+    Object result = interpreter->takeReturnValue();
+    if (function->isInitializer) {
+        return receiver;
+    }
+    return result;
+}
+
+#ifdef DRAFT_JIT
+std::optional<Object> Function::runNative(Arguments arguments)
+{
+    // The only guard: past it, the code knows the type of every value
+    std::array<double, jit::Compiler::MaxArguments> numbers{};
+    for (std::size_t i = 0; i < arguments.size(); i++) {
+        auto number = std::get_if<Number>(&arguments[i]);
+        if (!number) {
+            return std::nullopt;
+        }
+        numbers[i] = *number;
+    }
+    jit::Code::Kind kind = jit::Code::Kind::Nil;
+    double result = code->run(numbers.data(), kind);
+    switch (kind) {
+    case jit::Code::Kind::Number:
+        return result;
+    case jit::Code::Kind::Boolean:
+        return result != 0;
+    case jit::Code::Kind::Nil:
+        break;
+    }
     return Null{};
 }
+#endif
+
+std::shared_ptr<Coroutine> Function::coroutine(const InstancePtr &self, Arguments arguments)
+{
+    return std::make_shared<Coroutine>(std::make_shared<Function>(declaration, closure, isInitializer),
+                                       self ? self : receiver, arguments);
+}
 
 std::shared_ptr<Function> Function::bind(std::shared_ptr<Instance> instance)
 {
-    EnvironmentPtr env = std::make_shared<Environment>(closure);
-    env->define("this", std::move(instance));
-    return std::make_shared<Function>(declaration, env, isInitializer);
+    return std::make_shared<Function>(declaration, closure, isInitializer, std::move(instance));
 }
 
 }  // namespace object
@@ -1,30 +1,62 @@
 #pragma once
 
+#include <optional>
+
 #include "environment.h"
 #include "obj_callable.h"
+#ifdef DRAFT_JIT
+#include "jit.h"
+#endif
 
 namespace draft {
 class FuncStmt;
 
-class ReturnEx : public std::runtime_error {
-public:
-    explicit ReturnEx(object::Object value);
-    object::Object value;
-};
-
 namespace object {
+class Coroutine;
+
 class Function : public Callable {
 public:
-    Function(FuncStmt *declaration, EnvironmentPtr closure, bool isInitializer = false);
+    Function(FuncStmt *declaration, EnvironmentPtr closure, bool isInitializer = false, InstancePtr receiver = nullptr);
     std::size_t arity() override;
-    object::Object call(Interpreter *interpreter, std::vector<Object> arguments) override;
+    object::Object call(Interpreter *interpreter, Arguments arguments) override;
+    // Runs a method with `self` as "this", which lives in the first slot of the call environment.
+    // A function that yields is not run but returns a Coroutine of the call
+    object::Object invoke(Interpreter *interpreter, const InstancePtr &self, Arguments arguments);
+    // Runs the body as invoke() does a function that doesn't yield; how a Coroutine runs it
+    object::Object execute(Interpreter *interpreter, const InstancePtr &self, Arguments arguments);
+    // A Coroutine of a call, yielding or not, with `self` as "this" or else the bound receiver
+    std::shared_ptr<Coroutine> coroutine(const InstancePtr &self, Arguments arguments);
 
+    // Only needed when a method is used as a value; calls through obj.method() use invoke()
     std::shared_ptr<Function> bind(std::shared_ptr<Instance> instance);
 
+    const FuncStmt *getDeclaration() const
+    {
+        return declaration;
+    }
+
+#ifdef DRAFT_JIT
+    // Loops count towards how hot the function running them is
+    void countIteration()
+    {
+        hotness++;
+    }
+#endif
+
 private:
+#ifdef DRAFT_JIT
+    // Result of the native code, or nothing when the arguments are not all numbers
+    std::optional<Object> runNative(Arguments arguments);
+
+    std::size_t hotness = 0;
+    bool tieredUp = false;
+    const jit::Code *code = nullptr;
+#endif
+
     FuncStmt *declaration = nullptr;
     EnvironmentPtr closure;
     bool isInitializer = false;
+    InstancePtr receiver;
 };
 
 using FunctionPtr = std::shared_ptr<Function>;
@@ -1,28 +1,49 @@
 #include "obj_instance.h"
 
+#include <algorithm>
+
 namespace draft::object {
 
-Instance::Instance(Class klass)
+Instance::Instance(ClassPtr klass)
     : klass{std::move(klass)}
 {
 }
 
-Object Instance::getProperty(std::string name)
+Object Instance::getProperty(std::string_view name)
 {
-    if (fields.contains(name)) {
-        return fields.at(name);
+    if (const Object *field = getField(name)) {
+        return *field;
     }
 
-    FunctionPtr method = klass.findMethod(name);
+    FunctionPtr method = klass->findMethod(name);
     if (method) {
         return method->bind(shared_from_this());
     }
     return Null{};
 }
 
-void Instance::setProperty(std::string name, const Object &value)
+const Object *Instance::getField(std::string_view name) const
+{
+    auto field = std::ranges::find(fields, name, &decltype(fields)::value_type::first);
+    if (field != fields.end()) {
+        return &field->second;
+    }
+    return nullptr;
+}
+
+FunctionPtr Instance::findMethod(std::string_view name) const
 {
-    fields[name] = value;
+    return klass->findMethod(name);
+}
+
+void Instance::setProperty(std::string_view name, const Object &value)
+{
+    auto field = std::ranges::find(fields, name, &decltype(fields)::value_type::first);
+    if (field != fields.end()) {
+        field->second = value;
+        return;
+    }
+    fields.emplace_back(std::string{name}, value);
 }
 
 }  // namespace draft::object
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <map>
+#include <utility>
+#include <vector>
 
 #include "obj_class.h"
 
@@ -8,14 +9,18 @@ namespace draft::object {
 
 class Instance : public std::enable_shared_from_this<Instance> {
 public:
-    explicit Instance(Class klass);
+    explicit Instance(ClassPtr klass);
 
-    Object getProperty(std::string name);
-    void setProperty(std::string name, const object::Object &value);
+    Object getProperty(std::string_view name);
+    void setProperty(std::string_view name, const object::Object &value);
+
+    const Object *getField(std::string_view name) const;
+    FunctionPtr findMethod(std::string_view name) const;
 
 private:
-    Class klass;
-    std::map<std::string, Object> fields;
+    ClassPtr klass;
+    // Instances rarely have more than a handful of fields, so a flat vector beats a node-based map
+    std::vector<std::pair<std::string, Object>> fields;
 };
 
 }  // namespace draft::object
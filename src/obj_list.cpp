@@ -0,0 +1,192 @@
+#include "obj_list.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DRAFT_LIST_SSE2 1
+#else
+#define DRAFT_LIST_SSE2 0
+#endif
+
+namespace draft::object {
+
+List::List(std::vector<Object> elements)
+{
+    if (std::ranges::all_of(elements, [](const Object &element) { return std::holds_alternative<Number>(element); })) {
+        packed.reserve(elements.size());
+        for (const Object &element : elements) {
+            packed.push_back(std::get<Number>(element));
+        }
+    } else {
+        this->elements = std::move(elements);
+        generic = true;
+        for (const Object &element : this->elements) {
+            track(element, true);
+        }
+    }
+}
+
+List::List(std::vector<Number> numbers)
+    : packed{std::move(numbers)}
+{
+}
+
+std::size_t List::size() const
+{
+    return generic ? elements.size() : packed.size();
+}
+
+Object List::get(std::size_t index) const
+{
+    return generic ? elements[index] : Object{packed[index]};
+}
+
+void List::set(std::size_t index, const Object &value)
+{
+    if (!generic) {
+        if (auto number = std::get_if<Number>(&value)) {
+            packed[index] = *number;
+            return;
+        }
+        spill();
+    }
+    track(elements[index], false);
+    track(value, true);
+    elements[index] = value;
+}
+
+void List::push(const Object &value)
+{
+    if (!generic) {
+        if (auto number = std::get_if<Number>(&value)) {
+            packed.push_back(*number);
+            return;
+        }
+        spill();
+    }
+    track(value, true);
+    elements.push_back(value);
+}
+
+Object List::pop()
+{
+    if (!generic) {
+        Number last = packed.back();
+        packed.pop_back();
+        return last;
+    }
+    Object last = std::move(elements.back());
+    elements.pop_back();
+    track(last, false);
+    return last;
+}
+
+std::span<const Number> List::numbers()
+{
+    if (generic and others == 0) {
+        packed.reserve(elements.size());
+        for (const Object &element : elements) {
+            packed.push_back(std::get<Number>(element));
+        }
+        elements = {};
+        generic = false;
+    }
+    return generic ? std::span<const Number>{} : std::span<const Number>{packed};
+}
+
+bool List::isNumeric() const
+{
+    return !generic or others == 0;
+}
+
+void List::spill()
+{
+    elements.assign(packed.begin(), packed.end());
+    packed = {};
+    generic = true;
+}
+
+void List::track(const Object &value, bool added)
+{
+    if (!std::holds_alternative<Number>(value)) {
+        others += added ? 1 : -1;
+    }
+}
+
+// Lanes 0 and 1 are one SSE2 register, lanes 2 and 3 the other, and element i goes to lane i % 4
+// until fewer than four are left
+
+Number sum(std::span<const Number> values)
+{
+    std::size_t i = 0;
+    Number total = 0;
+#if DRAFT_LIST_SSE2
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    for (; i + 4 <= values.size(); i += 4) {
+        low = _mm_add_pd(low, _mm_loadu_pd(values.data() + i));
+        high = _mm_add_pd(high, _mm_loadu_pd(values.data() + i + 2));
+    }
+    alignas(16) Number lanes[4];
+    _mm_store_pd(lanes, low);
+    _mm_store_pd(lanes + 2, high);
+#else
+    Number lanes[4] = {};
+    for (; i + 4 <= values.size(); i += 4) {
+        for (std::size_t lane = 0; lane < 4; lane++) {
+            lanes[lane] += values[i + lane];
+        }
+    }
+#endif
+    total = (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+    for (; i < values.size(); i++) {
+        total += values[i];
+    }
+    return total;
+}
+
+Number dot(std::span<const Number> left, std::span<const Number> right)
+{
+    std::size_t i = 0;
+    Number total = 0;
+#if DRAFT_LIST_SSE2
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    for (; i + 4 <= left.size(); i += 4) {
+        low = _mm_add_pd(low, _mm_mul_pd(_mm_loadu_pd(left.data() + i), _mm_loadu_pd(right.data() + i)));
+        high = _mm_add_pd(high, _mm_mul_pd(_mm_loadu_pd(left.data() + i + 2), _mm_loadu_pd(right.data() + i + 2)));
+    }
+    alignas(16) Number lanes[4];
+    _mm_store_pd(lanes, low);
+    _mm_store_pd(lanes + 2, high);
+#else
+    Number lanes[4] = {};
+    for (; i + 4 <= left.size(); i += 4) {
+        for (std::size_t lane = 0; lane < 4; lane++) {
+            lanes[lane] += left[i + lane] * right[i + lane];
+        }
+    }
+#endif
+    total = (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+    for (; i < left.size(); i++) {
+        total += left[i] * right[i];
+    }
+    return total;
+}
+
+void add(std::span<const Number> values, Number addend, std::span<Number> out)
+{
+    std::size_t i = 0;
+#if DRAFT_LIST_SSE2
+    __m128d splat = _mm_set1_pd(addend);
+    for (; i + 2 <= values.size(); i += 2) {
+        _mm_storeu_pd(out.data() + i, _mm_add_pd(_mm_loadu_pd(values.data() + i), splat));
+    }
+#endif
+    for (; i < values.size(); i++) {
+        out[i] = values[i] + addend;
+    }
+}
+
+}  // namespace draft::object
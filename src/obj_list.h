@@ -0,0 +1,52 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "object.h"
+
+namespace draft::object {
+
+// A growable array. While every element is a number the elements are stored as plain doubles side
+// by side, which the bulk operations below run over; the first element of another type moves them
+// all into Objects. They are packed again when numbers() is asked for once the last element of
+// another type has been removed or overwritten
+class List {
+public:
+    List() = default;
+    explicit List(std::vector<Object> elements);
+    explicit List(std::vector<Number> numbers);
+
+    std::size_t size() const;
+    Object get(std::size_t index) const;
+    void set(std::size_t index, const Object &value);
+    void push(const Object &value);
+    // Removes and returns the last element; the list must not be empty
+    Object pop();
+
+    // The elements while all of them are numbers, packing them if need be; empty otherwise
+    std::span<const Number> numbers();
+    bool isNumeric() const;
+
+private:
+    void spill();
+    // Counts `value` in or out of the elements that aren't numbers
+    void track(const Object &value, bool added);
+
+    std::vector<Number> packed;
+    std::vector<Object> elements;
+    bool generic = false;
+    // Elements other than numbers, once generic
+    std::size_t others = 0;
+};
+
+// Kernels of the bulk operations. With SSE2 they take two numbers a step; the scalar versions keep
+// the same four partial sums and add them up in the same order
+
+Number sum(std::span<const Number> values);
+// The lengths must match
+Number dot(std::span<const Number> left, std::span<const Number> right);
+// out[i] = values[i] + addend, `out` being as long as `values`
+void add(std::span<const Number> values, Number addend, std::span<Number> out);
+
+}  // namespace draft::object
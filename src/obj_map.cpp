@@ -0,0 +1,206 @@
+#include "obj_map.h"
+
+#include <bit>
+#include <cstring>
+#include <functional>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DRAFT_MAP_SSE2 1
+#else
+#define DRAFT_MAP_SSE2 0
+#endif
+
+namespace draft::object {
+
+namespace {
+
+constexpr std::size_t GroupWidth = 16;
+constexpr std::size_t MinCapacity = 16;
+
+std::uint8_t h2(std::size_t hash)
+{
+    return static_cast<std::uint8_t>(hash & 0x7f);
+}
+
+// Bit i is set when byte i of the group at `control + start` equals `byte`. The index wraps
+// around, so the group may run past its end
+unsigned matchGroup(const std::vector<std::uint8_t> &control, std::size_t start, std::uint8_t byte)
+{
+    std::size_t mask = control.size() - 1;
+#if DRAFT_MAP_SSE2
+    alignas(16) std::uint8_t group[GroupWidth];
+    if (start + GroupWidth <= control.size()) {
+        std::memcpy(group, control.data() + start, GroupWidth);
+    } else {
+        for (std::size_t i = 0; i < GroupWidth; i++) {
+            group[i] = control[(start + i) & mask];
+        }
+    }
+    __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i *>(group));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(byte)))));
+#else
+    unsigned matches = 0;
+    for (std::size_t i = 0; i < GroupWidth; i++) {
+        if (control[(start + i) & mask] == byte) {
+            matches |= 1u << i;
+        }
+    }
+    return matches;
+#endif
+}
+
+std::size_t mix(std::size_t value)
+{
+    // The finalizer of splitmix64, so that the low bits used for h2 depend on all of the input
+    std::uint64_t x = value;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return static_cast<std::size_t>(x);
+}
+
+}  // namespace
+
+Map::Map()
+    : control(MinCapacity, Empty)
+    , slots(MinCapacity)
+{
+}
+
+std::size_t Map::size() const
+{
+    return values.size();
+}
+
+const Object *Map::find(const Object &key) const
+{
+    return find(key, hash(key));
+}
+
+const Object *Map::find(const Object &key, std::size_t hash) const
+{
+    std::size_t slot = lookUp(key, hash);
+    return slot == control.size() ? nullptr : &values[slots[slot]].value;
+}
+
+void Map::set(const Object &key, const Object &value)
+{
+    set(key, value, hash(key));
+}
+
+void Map::set(const Object &key, const Object &value, std::size_t keyHash)
+{
+    if (std::size_t slot = lookUp(key, keyHash); slot != control.size()) {
+        values[slots[slot]].value = value;
+        return;
+    }
+    // Keep at least one slot in eight empty, so that every probe sequence ends
+    if ((used + 1) * 8 > control.size() * 7) {
+        grow();
+    }
+    std::size_t slot = freeSlot(keyHash);
+    if (control[slot] == Empty) {
+        used++;
+    }
+    control[slot] = h2(keyHash);
+    slots[slot] = static_cast<std::uint32_t>(values.size());
+    values.push_back(Entry{key, value, keyHash});
+}
+
+bool Map::remove(const Object &key)
+{
+    std::size_t slot = lookUp(key, hash(key));
+    if (slot == control.size()) {
+        return false;
+    }
+    std::uint32_t position = slots[slot];
+    control[slot] = Deleted;
+    if (position + 1 != values.size()) {
+        const Entry &last = values.back();
+        slots[lookUp(last.key, last.hash)] = position;
+        values[position] = std::move(values.back());
+    }
+    values.pop_back();
+    return true;
+}
+
+std::span<const Map::Entry> Map::entries() const
+{
+    return values;
+}
+
+std::size_t Map::hash(const Object &key)
+{
+    auto visitor = [](auto &&arg) -> std::size_t {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, Null>) {
+            return 0;
+        } else if constexpr (std::is_same_v<T, Boolean>) {
+            return arg ? 1 : 2;
+        } else if constexpr (std::is_same_v<T, String>) {
+            return std::hash<std::string_view>{}(arg);
+        } else if constexpr (std::is_same_v<T, Number>) {
+            // -0 equals 0, so both hash as 0
+            return arg == 0 ? 3 : std::bit_cast<std::uint64_t>(arg);
+        } else {
+            return reinterpret_cast<std::uintptr_t>(arg.get());
+        }
+    };
+    return mix(std::visit(visitor, key) ^ key.index());
+}
+
+std::size_t Map::lookUp(const Object &key, std::size_t hash) const
+{
+    std::size_t mask = control.size() - 1;
+    std::size_t start = (hash >> 7) & mask;
+    // Triangular probing over groups visits every group of a power of two table
+    for (std::size_t step = GroupWidth;; step += GroupWidth) {
+        for (unsigned matches = matchGroup(control, start, h2(hash)); matches; matches &= matches - 1) {
+            std::size_t slot = (start + std::countr_zero(matches)) & mask;
+            const Entry &entry = values[slots[slot]];
+            if (entry.hash == hash and isEqual(entry.key, key)) {
+                return slot;
+            }
+        }
+        if (matchGroup(control, start, Empty)) {
+            return control.size();
+        }
+        start = (start + step) & mask;
+    }
+}
+
+std::size_t Map::freeSlot(std::size_t hash) const
+{
+    std::size_t mask = control.size() - 1;
+    std::size_t start = (hash >> 7) & mask;
+    for (std::size_t step = GroupWidth;; step += GroupWidth) {
+        unsigned free = matchGroup(control, start, Empty) | matchGroup(control, start, Deleted);
+        if (free) {
+            return (start + std::countr_zero(free)) & mask;
+        }
+        start = (start + step) & mask;
+    }
+}
+
+void Map::grow()
+{
+    // Deleted slots go away when the index is rebuilt, so the table only doubles if it is full of
+    // live entries
+    std::size_t capacity = control.size();
+    if ((values.size() + 1) * 8 > capacity * 7 / 2) {
+        capacity *= 2;
+    }
+    control.assign(capacity, Empty);
+    slots.assign(capacity, 0);
+    used = values.size();
+    for (std::size_t i = 0; i < values.size(); i++) {
+        std::size_t slot = freeSlot(values[i].hash);
+        control[slot] = h2(values[i].hash);
+        slots[slot] = static_cast<std::uint32_t>(i);
+    }
+}
+
+}  // namespace draft::object
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "object.h"
+
+namespace draft::object {
+
+// A hash table with any value as key: strings, numbers, booleans and nil by value, everything else
+// by identity. Entries sit side by side in insertion order, and an open-addressing index of
+// control bytes finds them, Swiss table style: each slot keeps 7 bits of its key's hash, so a probe
+// tests a group of 16 slots at once and compares keys only where those bits match. Every entry
+// keeps its full hash, computed once when the key is inserted, which growing the table reuses
+class Map {
+public:
+    struct Entry {
+        Object key;
+        Object value;
+        std::size_t hash = 0;
+    };
+
+    Map();
+
+    std::size_t size() const;
+    // The value of `key`, nullptr when there is none. `hash` is hash(key), if already known
+    const Object *find(const Object &key) const;
+    const Object *find(const Object &key, std::size_t hash) const;
+    void set(const Object &key, const Object &value);
+    void set(const Object &key, const Object &value, std::size_t hash);
+    // Whether there was an entry to remove. The last entry takes the place of the removed one
+    bool remove(const Object &key);
+
+    std::span<const Entry> entries() const;
+
+    static std::size_t hash(const Object &key);
+
+private:
+    static constexpr std::uint8_t Empty = 0x80;
+    static constexpr std::uint8_t Deleted = 0xfe;
+
+    // Slot holding the entry of `key`, or the size of the index
+    std::size_t lookUp(const Object &key, std::size_t hash) const;
+    // First empty or deleted slot on the probe sequence of `hash`
+    std::size_t freeSlot(std::size_t hash) const;
+    void grow();
+
+    std::vector<Entry> values;
+    // One control byte per slot: Empty, Deleted, or the low 7 bits of the hash of its key
+    std::vector<std::uint8_t> control;
+    // Position in `values` of the entry each full slot holds
+    std::vector<std::uint32_t> slots;
+    // Full and deleted slots, which both lengthen probe sequences
+    std::size_t used = 0;
+};
+
+}  // namespace draft::object
@@ -1,10 +1,68 @@
 #include "object.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 
+#include "obj_list.h"
+#include "obj_map.h"
+
 namespace draft::object {
 
+namespace {
+
+// Lists and maps being printed, so that one met again inside itself prints as [...] or {...}
+using Open = std::vector<const void *>;
+
+std::string str(const Object &obj, Open &open);
+
+std::string list2str(const List &list, Open &open)
+{
+    if (std::ranges::find(open, &list) != open.end()) {
+        return "[...]";
+    }
+    open.push_back(&list);
+    std::string text = "[";
+    for (std::size_t i = 0; i < list.size(); i++) {
+        if (i > 0) {
+            text += ", ";
+        }
+        text += str(list.get(i), open);
+    }
+    open.pop_back();
+    return text + "]";
+}
+
+std::string map2str(const Map &map, Open &open)
+{
+    if (std::ranges::find(open, &map) != open.end()) {
+        return "{...}";
+    }
+    open.push_back(&map);
+    std::string text = "{";
+    for (const Map::Entry &entry : map.entries()) {
+        if (text.size() > 1) {
+            text += ", ";
+        }
+        text += str(entry.key, open) + ": " + str(entry.value, open);
+    }
+    open.pop_back();
+    return text + "}";
+}
+
+std::string str(const Object &obj, Open &open)
+{
+    if (auto list = std::get_if<ListPtr>(&obj)) {
+        return list2str(**list, open);
+    }
+    if (auto map = std::get_if<MapPtr>(&obj)) {
+        return map2str(**map, open);
+    }
+    return obj2str(obj);
+}
+
+}  // namespace
+
 std::string obj2str(const Object &obj)
 {
     auto visitor = [](auto &&arg) -> std::string {
@@ -22,6 +80,12 @@ std::string obj2str(const Object &obj)
             ret = "callable";
         } else if constexpr (std::is_same_v<T, InstancePtr>) {
             ret = "instance";
+        } else if constexpr (std::is_same_v<T, ListPtr>) {
+            Open open;
+            ret = list2str(*arg, open);
+        } else if constexpr (std::is_same_v<T, MapPtr>) {
+            Open open;
+            ret = map2str(*arg, open);
         } else {
             throw std::runtime_error{"Unknown Object type"};
         }
@@ -13,6 +13,8 @@ class Function;
 namespace object {
 class Callable;
 class Instance;
+class List;
+class Map;
 
 using Null = std::monostate;
 using Boolean = bool;
@@ -20,7 +22,9 @@ using String = std::string;
 using Number = double;
 using CallablePtr = std::shared_ptr<Callable>;
 using InstancePtr = std::shared_ptr<Instance>;
-using Object = std::variant<Null, Boolean, String, Number, CallablePtr, InstancePtr>;
+using ListPtr = std::shared_ptr<List>;
+using MapPtr = std::shared_ptr<Map>;
+using Object = std::variant<Null, Boolean, String, Number, CallablePtr, InstancePtr, ListPtr, MapPtr>;
 
 std::string obj2str(const Object &obj);
 bool isTruthy(const Object &obj);
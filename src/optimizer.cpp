@@ -0,0 +1,517 @@
+#include "optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace draft {
+namespace {
+
+const object::Object *constant(Expr *expr)
+{
+    auto literal = dynamic_cast<Literal *>(expr);
+    return literal ? &literal->value : nullptr;
+}
+
+const object::Number *number(Expr *expr)
+{
+    const object::Object *value = constant(expr);
+    return value ? std::get_if<object::Number>(value) : nullptr;
+}
+
+bool isComparison(Token::Kind kind)
+{
+    switch (kind) {
+    case Token::Kind::GreaterThanSign:
+    case Token::Kind::GreaterEqual:
+    case Token::Kind::LessThanSign:
+    case Token::Kind::LessEqual:
+    case Token::Kind::ExclaimEqual:
+    case Token::Kind::EqualEqual:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Whether evaluating `expr` yields a number whenever it yields anything at all
+bool isNumeric(Expr *expr)
+{
+    if (number(expr)) {
+        return true;
+    }
+    if (auto unary = dynamic_cast<Unary *>(expr)) {
+        return unary->op.kind == Token::Kind::HyphenMinus;
+    }
+    if (auto binary = dynamic_cast<Binary *>(expr)) {
+        switch (binary->op.kind) {
+        case Token::Kind::HyphenMinus:
+        case Token::Kind::Asterisk:
+        case Token::Kind::Solidus:
+            return true;
+        case Token::Kind::PlusSign:
+            return isNumeric(binary->left) and isNumeric(binary->right);
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+// Whether evaluating `expr` yields a boolean whenever it yields anything at all
+bool isBoolean(Expr *expr)
+{
+    if (const object::Object *value = constant(expr)) {
+        return std::holds_alternative<object::Boolean>(*value);
+    }
+    if (auto unary = dynamic_cast<Unary *>(expr)) {
+        return unary->op.kind == Token::Kind::ExclamationMark;
+    }
+    if (auto binary = dynamic_cast<Binary *>(expr)) {
+        return isComparison(binary->op.kind);
+    }
+    return false;
+}
+
+template <typename List>
+void dropAfterReturn(List &statements)
+{
+    auto it = std::find_if(statements.begin(), statements.end(),
+                           [](Stmt *stmt) { return dynamic_cast<Return *>(stmt) != nullptr; });
+    if (it != statements.end()) {
+        statements.erase(std::next(it), statements.end());
+    }
+}
+
+}  // namespace
+
+Pass::Pass(memory::Arena &arena)
+    : arena{arena}
+{
+}
+
+void Pass::run(std::vector<Stmt *> &statements)
+{
+    rewriteList(statements);
+}
+
+Expr *Pass::rewrite(Expr *expr)
+{
+    return expr ? expr->accept(static_cast<IExprVisitor<Expr *> *>(this)) : nullptr;
+}
+
+Stmt *Pass::rewrite(Stmt *stmt)
+{
+    return stmt ? stmt->accept(static_cast<IStmtVisitor<Stmt *> *>(this)) : nullptr;
+}
+
+Stmt *Pass::rewriteRequired(Stmt *stmt)
+{
+    if (Stmt *rewritten = rewrite(stmt)) {
+        return rewritten;
+    }
+    return arena.make<Block>(AstList<Stmt *>{&arena});
+}
+
+template <typename List>
+void Pass::rewriteList(List &statements)
+{
+    for (Stmt *&stmt : statements) {
+        stmt = rewrite(stmt);
+    }
+    statements.erase(std::remove(statements.begin(), statements.end(), nullptr), statements.end());
+}
+
+Expr *Pass::visit(Literal *expr)
+{
+    return expr;
+}
+
+Expr *Pass::visit(Logical *expr)
+{
+    expr->left = rewrite(expr->left);
+    expr->right = rewrite(expr->right);
+    return expr;
+}
+
+Expr *Pass::visit(Unary *expr)
+{
+    expr->right = rewrite(expr->right);
+    return expr;
+}
+
+Expr *Pass::visit(Binary *expr)
+{
+    expr->left = rewrite(expr->left);
+    expr->right = rewrite(expr->right);
+    return expr;
+}
+
+Expr *Pass::visit(Call *expr)
+{
+    Expr *callee = rewrite(expr->callee);
+    if (callee != expr->callee) {
+        // A callee that became obj.name or super.name can now be invoked without binding
+        expr->callee = callee;
+        expr->method = dynamic_cast<Get *>(callee);
+        expr->superMethod = dynamic_cast<Super *>(callee);
+    }
+    for (Expr *&argument : expr->arguments) {
+        argument = rewrite(argument);
+    }
+    return expr;
+}
+
+Expr *Pass::visit(Grouping *expr)
+{
+    expr->expression = rewrite(expr->expression);
+    return expr;
+}
+
+Expr *Pass::visit(Variable *expr)
+{
+    return expr;
+}
+
+Expr *Pass::visit(Assign *expr)
+{
+    expr->value = rewrite(expr->value);
+    return expr;
+}
+
+Expr *Pass::visit(Get *expr)
+{
+    expr->object = rewrite(expr->object);
+    return expr;
+}
+
+Expr *Pass::visit(Set *expr)
+{
+    expr->object = rewrite(expr->object);
+    expr->value = rewrite(expr->value);
+    return expr;
+}
+
+Expr *Pass::visit(Super *expr)
+{
+    return expr;
+}
+
+Expr *Pass::visit(This *expr)
+{
+    return expr;
+}
+
+Expr *Pass::visit(ListExpr *expr)
+{
+    for (Expr *&element : expr->elements) {
+        element = rewrite(element);
+    }
+    return expr;
+}
+
+Expr *Pass::visit(MapExpr *expr)
+{
+    for (std::size_t i = 0; i < expr->keys.size(); i++) {
+        expr->keys[i] = rewrite(expr->keys[i]);
+        expr->values[i] = rewrite(expr->values[i]);
+    }
+    return expr;
+}
+
+Expr *Pass::visit(GetIndex *expr)
+{
+    expr->object = rewrite(expr->object);
+    expr->index = rewrite(expr->index);
+    return expr;
+}
+
+Expr *Pass::visit(SetIndex *expr)
+{
+    expr->object = rewrite(expr->object);
+    expr->index = rewrite(expr->index);
+    expr->value = rewrite(expr->value);
+    return expr;
+}
+
+Stmt *Pass::visit(ExprStmt *stmt)
+{
+    stmt->expression = rewrite(stmt->expression);
+    return stmt;
+}
+
+Stmt *Pass::visit(If *stmt)
+{
+    stmt->condition = rewrite(stmt->condition);
+    stmt->thenBranch = rewriteRequired(stmt->thenBranch);
+    stmt->elseBranch = rewrite(stmt->elseBranch);
+    return stmt;
+}
+
+Stmt *Pass::visit(FuncStmt *stmt)
+{
+    rewriteList(stmt->body);
+    return stmt;
+}
+
+Stmt *Pass::visit(Print *stmt)
+{
+    stmt->expression = rewrite(stmt->expression);
+    return stmt;
+}
+
+Stmt *Pass::visit(Return *stmt)
+{
+    Expr *value = rewrite(stmt->value);
+    if (value != stmt->value) {
+        stmt->value = value;
+        stmt->tailCall = dynamic_cast<Call *>(value);
+    }
+    return stmt;
+}
+
+Stmt *Pass::visit(While *stmt)
+{
+    stmt->condition = rewrite(stmt->condition);
+    stmt->body = rewriteRequired(stmt->body);
+    return stmt;
+}
+
+Stmt *Pass::visit(Yield *stmt)
+{
+    stmt->value = rewrite(stmt->value);
+    return stmt;
+}
+
+Stmt *Pass::visit(Block *stmt)
+{
+    rewriteList(stmt->statements);
+    return stmt;
+}
+
+Stmt *Pass::visit(Class *stmt)
+{
+    // A method is rewritten as the function it is, which no pass drops or replaces
+    for (FuncStmt *method : stmt->methods) {
+        rewrite(method);
+    }
+    return stmt;
+}
+
+Stmt *Pass::visit(Var *stmt)
+{
+    stmt->initializer = rewrite(stmt->initializer);
+    return stmt;
+}
+
+Expr *GroupingElimination::visit(Grouping *expr)
+{
+    return rewrite(expr->expression);
+}
+
+Expr *ConstantFolding::visit(Logical *expr)
+{
+    Pass::visit(expr);
+    const object::Object *left = constant(expr->left);
+    if (!left) {
+        return expr;
+    }
+    // Both operators yield the left operand when it decides the result, and the right one otherwise
+    bool decided = expr->op.kind == Token::Kind::Or ? object::isTruthy(*left) : !object::isTruthy(*left);
+    return decided ? expr->left : expr->right;
+}
+
+Expr *ConstantFolding::visit(Unary *expr)
+{
+    Pass::visit(expr);
+    const object::Object *right = constant(expr->right);
+    if (!right) {
+        return expr;
+    }
+    switch (expr->op.kind) {
+    case Token::Kind::HyphenMinus:
+        if (auto value = std::get_if<object::Number>(right)) {
+            return arena.make<Literal>(-*value);
+        }
+        break;
+    case Token::Kind::ExclamationMark:
+        return arena.make<Literal>(!object::isTruthy(*right));
+    default:
+        break;
+    }
+    return expr;
+}
+
+Expr *ConstantFolding::visit(Binary *expr)
+{
+    Pass::visit(expr);
+    const object::Object *left = constant(expr->left);
+    const object::Object *right = constant(expr->right);
+    if (!left or !right) {
+        return expr;
+    }
+
+    switch (expr->op.kind) {
+    case Token::Kind::ExclaimEqual:
+        return arena.make<Literal>(!object::isEqual(*left, *right));
+    case Token::Kind::EqualEqual:
+        return arena.make<Literal>(object::isEqual(*left, *right));
+    case Token::Kind::PlusSign: {
+        auto a = std::get_if<object::String>(left);
+        auto b = std::get_if<object::String>(right);
+        if (a and b) {
+            return arena.make<Literal>(*a + *b);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    auto a = std::get_if<object::Number>(left);
+    auto b = std::get_if<object::Number>(right);
+    if (!a or !b) {
+        return expr;
+    }
+    switch (expr->op.kind) {
+    case Token::Kind::GreaterThanSign:
+        return arena.make<Literal>(*a > *b);
+    case Token::Kind::GreaterEqual:
+        return arena.make<Literal>(*a >= *b);
+    case Token::Kind::LessThanSign:
+        return arena.make<Literal>(*a < *b);
+    case Token::Kind::LessEqual:
+        return arena.make<Literal>(*a <= *b);
+    case Token::Kind::HyphenMinus:
+        return arena.make<Literal>(*a - *b);
+    case Token::Kind::PlusSign:
+        return arena.make<Literal>(*a + *b);
+    case Token::Kind::Solidus:
+        return arena.make<Literal>(*a / *b);
+    case Token::Kind::Asterisk:
+        return arena.make<Literal>(*a * *b);
+    default:
+        return expr;
+    }
+}
+
+Stmt *DeadBranchElimination::visit(ExprStmt *stmt)
+{
+    Pass::visit(stmt);
+    return constant(stmt->expression) ? nullptr : stmt;
+}
+
+Stmt *DeadBranchElimination::visit(If *stmt)
+{
+    Pass::visit(stmt);
+    if (const object::Object *condition = constant(stmt->condition)) {
+        return object::isTruthy(*condition) ? stmt->thenBranch : stmt->elseBranch;
+    }
+    return stmt;
+}
+
+Stmt *DeadBranchElimination::visit(While *stmt)
+{
+    Pass::visit(stmt);
+    const object::Object *condition = constant(stmt->condition);
+    return condition and !object::isTruthy(*condition) ? nullptr : stmt;
+}
+
+Stmt *DeadBranchElimination::visit(FuncStmt *stmt)
+{
+    Pass::visit(stmt);
+    dropAfterReturn(stmt->body);
+    return stmt;
+}
+
+Stmt *DeadBranchElimination::visit(Block *stmt)
+{
+    Pass::visit(stmt);
+    dropAfterReturn(stmt->statements);
+    return stmt;
+}
+
+Expr *StrengthReduction::visit(Unary *expr)
+{
+    Pass::visit(expr);
+    // !!x is x for a boolean and -(-x) is x for a number
+    auto inner = dynamic_cast<Unary *>(expr->right);
+    if (inner and inner->op.kind == expr->op.kind) {
+        if (expr->op.kind == Token::Kind::ExclamationMark and isBoolean(inner->right)) {
+            return inner->right;
+        }
+        if (expr->op.kind == Token::Kind::HyphenMinus and isNumeric(inner->right)) {
+            return inner->right;
+        }
+    }
+    return expr;
+}
+
+Expr *StrengthReduction::visit(Binary *expr)
+{
+    Pass::visit(expr);
+    const object::Number *left = number(expr->left);
+    const object::Number *right = number(expr->right);
+
+    switch (expr->op.kind) {
+    case Token::Kind::Solidus:
+        if (right and *right == 1 and isNumeric(expr->left)) {
+            return expr->left;
+        }
+        if (right) {
+            // Dividing by a power of two and multiplying by its reciprocal both round the same exact
+            // quotient, as long as the reciprocal is itself a normal number
+            int exponent = 0;
+            double reciprocal = 1 / *right;
+            if (std::abs(std::frexp(*right, &exponent)) == 0.5 and std::isnormal(reciprocal)) {
+                expr->op = Token{Token::Kind::Asterisk, "*", expr->op.line};
+                expr->right = arena.make<Literal>(reciprocal);
+            }
+        }
+        break;
+    case Token::Kind::Asterisk:
+        if (right and *right == 1 and isNumeric(expr->left)) {
+            return expr->left;
+        }
+        if (left and *left == 1 and isNumeric(expr->right)) {
+            return expr->right;
+        }
+        break;
+    case Token::Kind::HyphenMinus:
+        // x - 0 is x even for -0, unlike x + 0
+        if (right and *right == 0 and isNumeric(expr->left)) {
+            return expr->left;
+        }
+        break;
+    default:
+        break;
+    }
+    return expr;
+}
+
+Optimizer::Optimizer(int level)
+    : Optimizer{level, ownArena}
+{
+}
+
+Optimizer::Optimizer(int level, memory::Arena &arena)
+{
+    if (level >= 1) {
+        passes.push_back(std::make_unique<GroupingElimination>(arena));
+        passes.push_back(std::make_unique<ConstantFolding>(arena));
+    }
+    if (level >= 2) {
+        passes.push_back(std::make_unique<StrengthReduction>(arena));
+    }
+    if (level >= 1) {
+        passes.push_back(std::make_unique<DeadBranchElimination>(arena));
+    }
+}
+
+void Optimizer::optimize(std::vector<Stmt *> &statements)
+{
+    for (const std::unique_ptr<Pass> &pass : passes) {
+        pass->run(statements);
+    }
+}
+
+}  // namespace draft
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "arena.h"
+#include "ast.h"
+
+namespace draft {
+
+// A rewrite of the resolved AST. Each visit returns the node that takes the place of the visited
+// one, and a statement returns nullptr to be dropped. The default visits rewrite the children in
+// place and keep the node, so a pass only overrides the nodes it cares about. Rewrites never add
+// or remove a declaration, so the slots the Resolver recorded stay valid
+class Pass : public IExprVisitor<Expr *>, public IStmtVisitor<Stmt *> {
+public:
+    explicit Pass(memory::Arena &arena);
+
+    void run(std::vector<Stmt *> &statements);
+
+protected:
+    Expr *rewrite(Expr *expr);
+    Stmt *rewrite(Stmt *stmt);
+    // For a statement that must stay, such as a loop body: a dropped one becomes an empty block
+    Stmt *rewriteRequired(Stmt *stmt);
+    template <typename List>
+    void rewriteList(List &statements);
+
+    Expr *visit(Literal *expr) override;
+    Expr *visit(Logical *expr) override;
+    Expr *visit(Unary *expr) override;
+    Expr *visit(Binary *expr) override;
+    Expr *visit(Call *expr) override;
+    Expr *visit(Grouping *expr) override;
+    Expr *visit(Variable *expr) override;
+    Expr *visit(Assign *expr) override;
+    Expr *visit(Get *expr) override;
+    Expr *visit(Set *expr) override;
+    Expr *visit(Super *expr) override;
+    Expr *visit(This *expr) override;
+    Expr *visit(ListExpr *expr) override;
+    Expr *visit(MapExpr *expr) override;
+    Expr *visit(GetIndex *expr) override;
+    Expr *visit(SetIndex *expr) override;
+
+    Stmt *visit(ExprStmt *stmt) override;
+    Stmt *visit(If *stmt) override;
+    Stmt *visit(FuncStmt *stmt) override;
+    Stmt *visit(Print *stmt) override;
+    Stmt *visit(Return *stmt) override;
+    Stmt *visit(While *stmt) override;
+    Stmt *visit(Yield *stmt) override;
+    Stmt *visit(Block *stmt) override;
+    Stmt *visit(Class *stmt) override;
+    Stmt *visit(Var *stmt) override;
+
+    // Nodes made by a pass come from the optimizer's arena
+    memory::Arena &arena;
+};
+
+// Unwraps parenthesized expressions, which only ever mattered to the parser
+class GroupingElimination : public Pass {
+public:
+    using Pass::Pass;
+
+protected:
+    using Pass::visit;
+    Expr *visit(Grouping *expr) override;
+};
+
+// Evaluates operators over literals ahead of time. Anything that would fail at run time is left
+// alone, so the error is still reported where and when it happens
+class ConstantFolding : public Pass {
+public:
+    using Pass::Pass;
+
+protected:
+    using Pass::visit;
+    Expr *visit(Logical *expr) override;
+    Expr *visit(Unary *expr) override;
+    Expr *visit(Binary *expr) override;
+};
+
+// Drops branches and loops whose condition is a literal, statements after a return and literals
+// evaluated for nothing
+class DeadBranchElimination : public Pass {
+public:
+    using Pass::Pass;
+
+protected:
+    using Pass::visit;
+    Stmt *visit(ExprStmt *stmt) override;
+    Stmt *visit(If *stmt) override;
+    Stmt *visit(While *stmt) override;
+    Stmt *visit(FuncStmt *stmt) override;
+    Stmt *visit(Block *stmt) override;
+};
+
+// Replaces operations by cheaper ones with the same result: division by a power of two becomes a
+// multiplication, and identities such as x * 1 or !!(a < b) go away once the operand type is known
+class StrengthReduction : public Pass {
+public:
+    using Pass::Pass;
+
+protected:
+    using Pass::visit;
+    Expr *visit(Unary *expr) override;
+    Expr *visit(Binary *expr) override;
+};
+
+// Runs the passes of an optimization level over a resolved program: level 0 leaves it as parsed,
+// level 1 removes groupings and dead branches and folds constants, level 2 also reduces strength
+class Optimizer {
+public:
+    static constexpr int MaxLevel = 2;
+
+    explicit Optimizer(int level);
+    // Makes the new nodes in `arena`, so the program can outlive the optimizer
+    Optimizer(int level, memory::Arena &arena);
+
+    void optimize(std::vector<Stmt *> &statements);
+
+private:
+    // Keeps the nodes made by the passes, unless the optimizer was given an arena
+    memory::Arena ownArena;
+    std::vector<std::unique_ptr<Pass>> passes;
+};
+
+}  // namespace draft
@@ -0,0 +1,68 @@
+#include "output.h"
+
+#include <charconv>
+
+namespace draft {
+
+namespace {
+
+// Fixed notation of the largest double: 309 digits, the point and six decimals
+constexpr std::size_t NumberMax = 320;
+
+}  // namespace
+
+Output::Output(std::ostream &stream, std::size_t capacity)
+    : stream{stream}
+{
+    setCapacity(capacity);
+}
+
+Output::~Output()
+{
+    flush();
+}
+
+void Output::write(std::string_view text)
+{
+    if (buffer.size() + text.size() > capacity) {
+        flush();
+        if (text.size() >= capacity) {
+            stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+            return;
+        }
+    }
+    buffer.append(text);
+}
+
+void Output::writeNumber(double number)
+{
+    char digits[NumberMax];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), number, std::chars_format::fixed, 6);
+    write({digits, error == std::errc{} ? static_cast<std::size_t>(end - digits) : 0});
+}
+
+void Output::endLine()
+{
+    write("\n");
+    if (capacity == 0) {
+        stream.flush();
+    }
+}
+
+void Output::flush()
+{
+    if (!buffer.empty()) {
+        stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+    stream.flush();
+}
+
+void Output::setCapacity(std::size_t capacity)
+{
+    flush();
+    this->capacity = capacity;
+    buffer.reserve(capacity);
+}
+
+}  // namespace draft
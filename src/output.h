@@ -0,0 +1,36 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace draft {
+
+// What print writes, collected into one write to the stream per `capacity` bytes. An engine
+// flushes it when a run ends or fails, so output and error messages keep their order; with no
+// capacity every line is written and flushed as it is printed
+class Output {
+public:
+    static constexpr std::size_t DefaultCapacity = 64 * 1024;
+
+    explicit Output(std::ostream &stream = std::cout, std::size_t capacity = DefaultCapacity);
+    ~Output();
+
+    Output(const Output &) = delete;
+    Output &operator=(const Output &) = delete;
+
+    void write(std::string_view text);
+    // Same text as std::to_string, formatted without a temporary string
+    void writeNumber(double number);
+    void endLine();
+    void flush();
+
+    void setCapacity(std::size_t capacity);
+
+private:
+    std::ostream &stream;
+    std::size_t capacity = DefaultCapacity;
+    std::string buffer;
+};
+
+}  // namespace draft
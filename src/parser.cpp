@@ -28,7 +28,21 @@ Nonterminal       Call to that rule's function
 ?                 if statement
 */
 Parser::Parser(const std::vector<Token> &tokens)
-    : tokens{tokens}
+    : pending{tokens}
+    , currentToken{pull()}
+{
+}
+
+Parser::Parser(Lexer &lexer)
+    : lexer{&lexer}
+    , currentToken{lexer.next()}
+{
+}
+
+Parser::Parser(Lexer &lexer, memory::Arena &arena)
+    : arena{&arena}
+    , lexer{&lexer}
+    , currentToken{lexer.next()}
 {
 }
 
@@ -56,7 +70,7 @@ Expr *Parser::expression()
 // assignment :: ( call "." )? IDENTIFIER "=" assignment | logic_or ;
 Expr *Parser::assignment()
 {
-    Expr *expr = logicOr();
+    Expr *expr = binary(Precedence::Or);
     if (match(Token::Kind::EqualsSign)) {
         Token equals = previous();
         Expr *value = assignment();
@@ -67,81 +81,76 @@ Expr *Parser::assignment()
         } else if (instanceof <Get>(expr)) {
             auto get = dynamic_cast<Get *>(expr);
             return makeAstNode<Set>(get->object, get->name, value);
+        } else if (instanceof <GetIndex>(expr)) {
+            auto get = dynamic_cast<GetIndex *>(expr);
+            return makeAstNode<SetIndex>(get->object, get->bracket, get->index, value);
         }
         Driver::error(equals.line, "Invalid assignment target");
     }
     return expr;
 }
 
-// equality :: comparison ( ( "!=" | "==" ) comparision )* ;
-Expr *Parser::equality()
-{
-    Expr *expr = comparison();
-    while (match(Token::Kind::ExclaimEqual, Token::Kind::EqualEqual)) {
-        Token op = previous();
-        Expr *right = comparison();
-        expr = makeAstNode<Binary>(expr, op, right);
+Parser::Precedence Parser::infixPrecedence(Token::Kind kind)
+{
+    switch (kind) {
+    case Token::Kind::Or:
+        return Precedence::Or;
+    case Token::Kind::And:
+        return Precedence::And;
+    case Token::Kind::ExclaimEqual:
+        [[fallthrough]];
+    case Token::Kind::EqualEqual:
+        return Precedence::Equality;
+    case Token::Kind::GreaterThanSign:
+        [[fallthrough]];
+    case Token::Kind::GreaterEqual:
+        [[fallthrough]];
+    case Token::Kind::LessThanSign:
+        [[fallthrough]];
+    case Token::Kind::LessEqual:
+        return Precedence::Comparison;
+    case Token::Kind::HyphenMinus:
+        [[fallthrough]];
+    case Token::Kind::PlusSign:
+        return Precedence::Term;
+    case Token::Kind::Solidus:
+        [[fallthrough]];
+    case Token::Kind::Asterisk:
+        return Precedence::Factor;
+    default:
+        return Precedence::None;
     }
-    return expr;
 }
 
-// comparison :: term ( ( ">" | ">=" | "<" | "<=" ) term )* ;
-Expr *Parser::comparison()
-{
-    Expr *expr = term();
-    while (match(Token::Kind::GreaterThanSign, Token::Kind::GreaterEqual, Token::Kind::LessThanSign,
-                 Token::Kind::LessEqual)) {
-        Token op = previous();
-        Expr *right = term();
-        expr = makeAstNode<Binary>(expr, op, right);
-    }
-    return expr;
-}
+/*
+Precedence climbing over the binary levels of the grammar, all left-associative:
 
-// term :: factor ( ("-" | "+" ) factor )* ;
-Expr *Parser::term()
-{
-    Expr *expr = factor();
-    while (match(Token::Kind::HyphenMinus, Token::Kind::PlusSign)) {
-        Token op = previous();
-        Expr *right = factor();
-        expr = makeAstNode<Binary>(expr, op, right);
-    }
-    return expr;
-}
+logic_or   :: logic_and ( "or" logic_and )* ;
+logic_and  :: equality ( "and" equality )* ;
+equality   :: comparison ( ( "!=" | "==" ) comparison )* ;
+comparison :: term ( ( ">" | ">=" | "<" | "<=" ) term )* ;
+term       :: factor ( ( "-" | "+" ) factor )* ;
+factor     :: unary ( ( "/" | "*" ) unary )* ;
 
-// factor :: unary ( ( "/" | "*" ) unary )* ;
-Expr *Parser::factor()
+An operand is parsed once and then extended by every operator binding at least as tightly as
+`minimum`, instead of descending through one function per level
+*/
+Expr *Parser::binary(Precedence minimum)
 {
     Expr *expr = unary();
-    while (match(Token::Kind::Solidus, Token::Kind::Asterisk)) {
-        Token op = previous();
-        Expr *right = unary();
-        expr = makeAstNode<Binary>(expr, op, right);
-    }
-    return expr;
-}
-
-// logic_or :: logic_and ( "or" logic_and )* ;
-Expr *Parser::logicOr()
-{
-    Expr *expr = logicAnd();
-    while (match(Token::Kind::Or)) {
-        Token op = previous();
-        Expr *right = logicAnd();
-        expr = makeAstNode<Logical>(expr, op, right);
-    }
-    return expr;
-}
-
-// logic_and :: equality ( "and" equality )* ;
-Expr *Parser::logicAnd()
-{
-    Expr *expr = equality();
-    while (match(Token::Kind::And)) {
-        Token op = previous();
-        Expr *right = equality();
-        expr = makeAstNode<Logical>(expr, op, right);
+    while (true) {
+        Precedence precedence = infixPrecedence(peek().kind);
+        if (precedence == Precedence::None or precedence < minimum) {
+            break;
+        }
+        Token op = advance();
+        auto tighter = static_cast<Precedence>(static_cast<std::uint8_t>(precedence) + 1);
+        Expr *right = binary(tighter);
+        if (precedence == Precedence::Or or precedence == Precedence::And) {
+            expr = makeAstNode<Logical>(expr, op, right);
+        } else {
+            expr = makeAstNode<Binary>(expr, op, right);
+        }
     }
     return expr;
 }
@@ -168,6 +177,10 @@ Expr *Parser::call()
         } else if (match(Token::Kind::FullStop)) {
             Token name = consume(Token::Kind::Identifier, "Expect property name after '.'");
             expr = makeAstNode<Get>(expr, name);
+        } else if (match(Token::Kind::LeftSquareBracket)) {
+            Expr *index = expression();
+            Token bracket = consume(Token::Kind::RightSquareBracket, "Expect ']' after index");
+            expr = makeAstNode<GetIndex>(expr, bracket, index);
         } else {
             break;
         }
@@ -179,7 +192,7 @@ Expr *Parser::call()
 // also handle zero-argument case
 Expr *Parser::finishCall(Expr *callee)
 {
-    std::vector<Expr *> arguments;
+    AstList<Expr *> arguments = makeList<Expr *>();
     if (!check(Token::Kind::RightParenthesis)) {
         do {
             if (arguments.size() >= 255) {
@@ -191,7 +204,7 @@ Expr *Parser::finishCall(Expr *callee)
 
     Token paren = consume(Token::Kind::RightParenthesis, "Expect ')' after arguments");
 
-    return makeAstNode<Call>(callee, paren, arguments);
+    return makeAstNode<Call>(callee, paren, std::move(arguments));
 }
 
 // primary :: "true" | "false" | "nil" | "this" | NUMBER | STRING | IDENTIFIER
@@ -208,7 +221,7 @@ Expr *Parser::primary()
         return makeAstNode<Literal>(object::Null{});
     }
     if (match(Token::Kind::NumberLiteral, Token::Kind::StringLiteral)) {
-        return makeAstNode<Literal>(previous().literal);
+        return makeAstNode<Literal>(previous().literal());
     }
     if (match(Token::Kind::Super)) {
         Token keyword = previous();
@@ -229,6 +242,31 @@ Expr *Parser::primary()
         return makeAstNode<Grouping>(expr);
     }
 
+    if (match(Token::Kind::LeftSquareBracket)) {
+        AstList<Expr *> elements = makeList<Expr *>();
+        if (!check(Token::Kind::RightSquareBracket)) {
+            do {
+                elements.emplace_back(expression());
+            } while (match(Token::Kind::Comma));
+        }
+        Token bracket = consume(Token::Kind::RightSquareBracket, "Expect ']' after list elements");
+        return makeAstNode<ListExpr>(bracket, std::move(elements));
+    }
+
+    if (match(Token::Kind::LeftCurlyBracket)) {
+        AstList<Expr *> keys = makeList<Expr *>();
+        AstList<Expr *> values = makeList<Expr *>();
+        if (!check(Token::Kind::RightCurlyBracket)) {
+            do {
+                keys.emplace_back(expression());
+                consume(Token::Kind::Colon, "Expect ':' after map key");
+                values.emplace_back(expression());
+            } while (match(Token::Kind::Comma));
+        }
+        Token brace = consume(Token::Kind::RightCurlyBracket, "Expect '}' after map entries");
+        return makeAstNode<MapExpr>(brace, std::move(keys), std::move(values));
+    }
+
     throw RuntimeError{peek(), "Expect expression"};
 }
 
@@ -263,26 +301,26 @@ Stmt *Parser::classDeclaration()
         superclass = makeAstNode<Variable>(previous());
     }
     consume(Token::Kind::LeftCurlyBracket, "Expect '{' before class body");
-    std::vector<FuncStmt *> methods;
+    AstList<FuncStmt *> methods = makeList<FuncStmt *>();
     while (!check(Token::Kind::RightCurlyBracket) and !isAtEnd()) {
-        methods.emplace_back(function("method"));
+        methods.emplace_back(function(Method));
     }
     consume(Token::Kind::RightCurlyBracket, "Expect '}' after class body");
-    return makeAstNode<Class>(name, superclass, methods);
+    return makeAstNode<Class>(name, superclass, std::move(methods));
 }
 
 // funDecl :: "fun" function ;
 Stmt *Parser::funDeclaration()
 {
-    return function("function");
+    return function(Function);
 }
 
 // function :: IDENTIFIER "(" parameters? ")" block ;
-FuncStmt *Parser::function(std::string kind)
+FuncStmt *Parser::function(const FunctionKind &kind)
 {
-    Token name = consume(Token::Kind::Identifier, "Expect " + kind + " name");
-    consume(Token::Kind::LeftParenthesis, "Expect '(' after " + kind + " name");
-    std::vector<Token> parameters;
+    Token name = consume(Token::Kind::Identifier, kind.name);
+    consume(Token::Kind::LeftParenthesis, kind.parenthesis);
+    AstList<Token> parameters = makeList<Token>();
     if (!check(Token::Kind::RightParenthesis)) {
         do {
             if (parameters.size() >= 255) {
@@ -293,9 +331,9 @@ FuncStmt *Parser::function(std::string kind)
         } while (match(Token::Kind::Comma));
     }
     consume(Token::Kind::RightParenthesis, "Expect ')' after parameters");
-    consume(Token::Kind::LeftCurlyBracket, "Expect '{' before " + kind + " body");
-    std::vector<Stmt *> body = block();
-    return makeAstNode<FuncStmt>(name, parameters, body);
+    consume(Token::Kind::LeftCurlyBracket, kind.body);
+    AstList<Stmt *> body = block();
+    return makeAstNode<FuncStmt>(name, std::move(parameters), std::move(body));
 }
 
 // varDecl :: "var" IDENTIFIER ( "=" expression )? ";" ;
@@ -310,7 +348,7 @@ Stmt *Parser::varDeclaration()
     return makeAstNode<Var>(name, initializer);
 }
 
-// statement :: exprStmt | forStmt | ifStmt | printStmt | returnStmt | whileStmt | block ;
+// statement :: exprStmt | forStmt | ifStmt | printStmt | returnStmt | whileStmt | yieldStmt | block ;
 Stmt *Parser::statement()
 {
     if (match(Token::Kind::For)) {
@@ -328,6 +366,9 @@ Stmt *Parser::statement()
     if (match(Token::Kind::While)) {
         return whileStatement();
     }
+    if (match(Token::Kind::Yield)) {
+        return yieldStatement();
+    }
     if (match(Token::Kind::LeftCurlyBracket)) {
         return makeAstNode<Block>(block());
     }
@@ -373,10 +414,10 @@ Stmt *Parser::forStatement()
     */
 
     if (increment != nullptr) {
-        std::vector<Stmt *> stmts;
+        AstList<Stmt *> stmts = makeList<Stmt *>();
         stmts.emplace_back(body);
         stmts.emplace_back(makeAstNode<ExprStmt>(increment));
-        body = makeAstNode<Block>(stmts);
+        body = makeAstNode<Block>(std::move(stmts));
     }
     if (condition == nullptr) {
         condition = makeAstNode<Literal>(object::Boolean{true});
@@ -384,7 +425,7 @@ Stmt *Parser::forStatement()
     body = makeAstNode<While>(condition, body);
 
     if (initializer) {
-        std::vector<Stmt *> stmts;
+        AstList<Stmt *> stmts = makeList<Stmt *>();
         stmts.emplace_back(initializer);
         stmts.emplace_back(body);
         body = makeAstNode<Block>(std::move(stmts));
@@ -427,6 +468,18 @@ Stmt *Parser::returnStatement()
     return makeAstNode<Return>(keyword, value);
 }
 
+// yieldStmt :: "yield" expression? ";" ;
+Stmt *Parser::yieldStatement()
+{
+    Token keyword = previous();
+    Expr *value = nullptr;
+    if (!check(Token::Kind::Semicolon)) {
+        value = expression();
+    }
+    consume(Token::Kind::Semicolon, "Expect ';' after yield value");
+    return makeAstNode<Yield>(keyword, value);
+}
+
 // whileStmt :: "while" "(" expression ")" statement ;
 Stmt *Parser::whileStatement()
 {
@@ -439,9 +492,9 @@ Stmt *Parser::whileStatement()
 }
 
 // block :: "{" declaration* "}" ;
-std::vector<Stmt *> Parser::block()
+AstList<Stmt *> Parser::block()
 {
-    std::vector<Stmt *> statements;
+    AstList<Stmt *> statements = makeList<Stmt *>();
     while (!check(Token::Kind::RightCurlyBracket) and !isAtEnd()) {
         statements.emplace_back(declaration());
     }
@@ -462,20 +515,21 @@ bool Parser::isAtEnd()
     return peek().kind == Token::Kind::EndOfFile;
 }
 
-Token Parser::peek()
+const Token &Parser::peek()
 {
-    return tokens.at(current);
+    return currentToken;
 }
 
-Token Parser::previous()
+const Token &Parser::previous()
 {
-    return tokens.at(current - 1);
+    return previousToken;
 }
 
-Token Parser::advance()
+const Token &Parser::advance()
 {
     if (!isAtEnd()) {
-        current++;
+        previousToken = currentToken;
+        currentToken = pull();
     }
     return previous();
 }
@@ -488,7 +542,7 @@ bool Parser::check(Token::Kind kind)
     return peek().kind == kind;
 }
 
-Token Parser::consume(Token::Kind kind, const std::string &message)
+const Token &Parser::consume(Token::Kind kind, const char *message)
 {
     if (check(kind)) {
         return advance();
@@ -496,6 +550,19 @@ Token Parser::consume(Token::Kind kind, const std::string &message)
     throw RuntimeError{peek(), message};
 }
 
+Token Parser::pull()
+{
+    if (lexer) {
+        return lexer->next();
+    }
+    if (pending.empty()) {
+        return Token{Token::Kind::EndOfFile, "", previousToken.line};
+    }
+    Token token = pending.front();
+    pending = pending.subspan(1);
+    return token;
+}
+
 void Parser::synchronize()
 {
     advance();
@@ -521,6 +588,8 @@ void Parser::synchronize()
         case Token::Kind::Print:
             [[fallthrough]];
         case Token::Kind::Return:
+            [[fallthrough]];
+        case Token::Kind::Yield:
             return;
         default:
             break;
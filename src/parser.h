@@ -1,8 +1,10 @@
 #pragma once
 
+#include <span>
 #include <vector>
 
 #include "ast.h"
+#include "lexer.h"
 #include "token.h"
 
 namespace draft {
@@ -17,18 +19,27 @@ public:
 class Parser {
 public:
     explicit Parser(const std::vector<Token> &tokens);
+    // Pulls tokens from the lexer as it goes, never holding more than the current and previous one
+    explicit Parser(Lexer &lexer);
+    // Makes the nodes in `arena`, so they can outlive the parser
+    Parser(Lexer &lexer, memory::Arena &arena);
 
     std::vector<Stmt *> parse();
 
+    // The arena holding the parsed nodes
+    const memory::Arena::Stats &arenaStats() const
+    {
+        return arena->stats();
+    }
+
 private:
+    // Binding power of infix operators, weakest first
+    enum class Precedence : std::uint8_t { None, Or, And, Equality, Comparison, Term, Factor };
+    static Precedence infixPrecedence(Token::Kind kind);
+
     Expr *expression();
     Expr *assignment();
-    Expr *equality();
-    Expr *comparison();
-    Expr *term();
-    Expr *factor();
-    Expr *logicOr();
-    Expr *logicAnd();
+    Expr *binary(Precedence minimum);
     Expr *unary();
     Expr *call();
     Expr *finishCall(Expr *callee);
@@ -37,7 +48,19 @@ private:
     Stmt *declaration();
     Stmt *classDeclaration();
     Stmt *funDeclaration();
-    FuncStmt *function(std::string kind);
+    // Error messages for a function or method declaration, literal so that nothing is built unless
+    // one is reported
+    struct FunctionKind {
+        const char *name;
+        const char *parenthesis;
+        const char *body;
+    };
+    static constexpr FunctionKind Function{"Expect function name", "Expect '(' after function name",
+                                           "Expect '{' before function body"};
+    static constexpr FunctionKind Method{"Expect method name", "Expect '(' after method name",
+                                         "Expect '{' before method body"};
+
+    FuncStmt *function(const FunctionKind &kind);
     Stmt *varDeclaration();
     Stmt *statement();
     Stmt *forStatement();
@@ -45,57 +68,60 @@ private:
     Stmt *printStatement();
     Stmt *returnStatement();
     Stmt *whileStatement();
-    std::vector<Stmt *> block();
+    Stmt *yieldStatement();
+    AstList<Stmt *> block();
     Stmt *expressionStatement();
 
     // Checks if we've run out of tokens to parse
     bool isAtEnd();
     // Returns the current token we have yet to consume
-    Token peek();
+    const Token &peek();
     // Returns the most recently consumed token
-    Token previous();
+    const Token &previous();
     // Consumes the current token and returns it
-    Token advance();
+    const Token &advance();
     // Returns true if the current token is of the given kind
     bool check(Token::Kind kind);
     // Checks to see if the next token is of the expected kind
-    Token consume(Token::Kind kind, const std::string &msg);
+    const Token &consume(Token::Kind kind, const char *message);
     // Discard tokens until it thinks it has found a statement boundary
     void synchronize();
+    // Takes the next token from the lexer, or from the tokens lexed up front
+    Token pull();
 
     // This checks to see if the curret token has any of the given kinds. If so, it consumes the
     // token and returns true. Otherwise it returns false and leaves the current token alone
     template <typename... TokenKind>
-    bool match(TokenKind &&... kinds)
+    bool match(TokenKind... kinds)
     {
-        std::vector<Token::Kind> kindvec = {kinds...};
-        for (Token::Kind kind : kindvec) {
-            if (check(kind)) {
-                advance();
-                return true;
-            }
+        if ((check(kinds) or ...)) {
+            advance();
+            return true;
         }
         return false;
     }
 
-    template <typename T>
-    T *makeAstNode()
+    template <typename T, typename... Args>
+    T *makeAstNode(Args &&...args)
     {
-        T *node = new (&arena) T{};
-        return node;
+        return arena->make<T>(std::forward<Args>(args)...);
     }
 
-    template <typename T, typename... Args>
-    T *makeAstNode(Args... args)
+    // An empty list allocating from the arena
+    template <typename T>
+    AstList<T> makeList()
     {
-        T *node = new (&arena) T{std::forward<Args>(args)...};
-        return node;
+        return AstList<T>{arena};
     }
 
-    memory::Arena arena;
+    // The parser's own arena, unless it was given one
+    memory::Arena ownArena;
+    memory::Arena *arena = &ownArena;
 
-    const std::vector<Token> &tokens;
-    std::size_t current = 0;
+    Lexer *lexer = nullptr;
+    std::span<const Token> pending;
+    Token currentToken{Token::Kind::EndOfFile, "", 0};
+    Token previousToken{Token::Kind::EndOfFile, "", 0};
 };
 
 }  // namespace draft
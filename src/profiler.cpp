@@ -0,0 +1,185 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+#if __has_include(<sys/time.h>)
+#include <sys/time.h>
+#define DRAFT_HAS_ITIMER
+#endif
+
+#include "ast.h"
+#include "builtin.h"
+#include "driver.h"
+#include "obj_class.h"
+#include "obj_function.h"
+
+namespace draft {
+
+namespace {
+
+// Label of the top-level code, at the root of every stack
+constexpr auto scriptLabel = "<script>";
+
+}  // namespace
+
+Profiler::Profiler(std::string path, std::chrono::microseconds interval)
+    : path{std::move(path)}
+    , interval{interval}
+{
+    script.label = scriptLabel;
+    script.calls = 1;
+}
+
+Profiler::~Profiler()
+{
+    stop();
+}
+
+void Profiler::start()
+{
+    pending = 0;
+    running = true;
+    begin = std::clock();
+#ifdef DRAFT_HAS_ITIMER
+    struct sigaction action = {};
+    action.sa_handler = onTimer;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(interval);
+    itimerval timer = {};
+    timer.it_interval.tv_sec = seconds.count();
+    timer.it_interval.tv_usec = (interval - seconds).count();
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+}
+
+void Profiler::stop()
+{
+    if (!running) {
+        return;
+    }
+    running = false;
+    milliseconds += 1000.0 * (std::clock() - begin) / CLOCKS_PER_SEC;
+#ifdef DRAFT_HAS_ITIMER
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    std::signal(SIGPROF, SIG_DFL);
+#endif
+    pending = 0;
+}
+
+void Profiler::finish()
+{
+    stop();
+    std::ofstream file{path};
+    if (file.fail()) {
+        io::writeLine("Can't write profile: " + path, std::cerr);
+    } else {
+        io::write(folded(), file);
+    }
+    io::write(table(), std::cerr);
+}
+
+void Profiler::onTimer(int)
+{
+    pending = 1;
+}
+
+void Profiler::sample(std::span<object::Callable *const> stack)
+{
+    pending = 0;
+    samples++;
+    script.total++;
+    if (stack.empty()) {
+        script.self++;
+    }
+    scratch.clear();
+    for (object::Callable *callee : stack) {
+        Entry &caller = entry(callee);
+        if (caller.seen != samples) {
+            caller.seen = samples;
+            caller.total++;
+        }
+        scratch.push_back(&caller);
+    }
+    if (!stack.empty()) {
+        entry(stack.back()).self++;
+    }
+    stacks[scratch]++;
+}
+
+void Profiler::count(object::Callable *callee)
+{
+    entry(callee).calls++;
+}
+
+Profiler::Entry &Profiler::entry(object::Callable *callee)
+{
+    if (auto function = dynamic_cast<object::Function *>(callee)) {
+        const FuncStmt *declaration = function->getDeclaration();
+        auto [it, inserted] = entries.try_emplace(declaration);
+        if (inserted) {
+            it->second.label = std::string{declaration->name.lexeme} + ":" + std::to_string(declaration->name.line);
+        }
+        return it->second;
+    }
+    auto [it, inserted] = entries.try_emplace(callee);
+    if (inserted) {
+        if (auto klass = dynamic_cast<object::Class *>(callee)) {
+            it->second.label = klass->name;
+        } else if (auto native = dynamic_cast<NativeFunction *>(callee)) {
+            it->second.label = native->name;
+        } else {
+            it->second.label = "<native>";
+        }
+    }
+    return it->second;
+}
+
+std::string Profiler::folded() const
+{
+    std::string text;
+    for (const auto &[stack, count] : stacks) {
+        text += scriptLabel;
+        for (const Entry *entry : stack) {
+            text += ";" + entry->label;
+        }
+        text += " " + std::to_string(count) + "\n";
+    }
+    return text;
+}
+
+std::string Profiler::table() const
+{
+    std::vector<const Entry *> sorted{&script};
+    for (const auto &[key, entry] : entries) {
+        sorted.push_back(&entry);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Entry *a, const Entry *b) {
+        return std::pair{a->self, a->total} > std::pair{b->self, b->total};
+    });
+    auto share = [this](std::size_t count) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.1f", samples ? milliseconds * count / samples : 0.0);
+        return std::string{text};
+    };
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-32s %12s %12s %12s\n", "function", "self ms", "total ms", "calls");
+    std::string text = line;
+    for (const Entry *entry : sorted) {
+        std::snprintf(line, sizeof(line), "%-32s %12s %12s %12zu\n", entry->label.c_str(),
+                      share(entry->self).c_str(), share(entry->total).c_str(),
+                      entry->calls);
+        text += line;
+    }
+    return text;
+}
+
+}  // namespace draft
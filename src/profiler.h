@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <cstddef>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "obj_callable.h"
+
+namespace draft {
+
+// Sampling profiler of the tree-walking interpreter. A CPU-time timer raises a flag on every
+// interval, and the interpreter takes the sample at its next call or loop iteration, so nothing
+// but the flag is touched from the signal handler. Without a profiler the interpreter only tests
+// a null pointer. The timer is per process, so one profiler runs at a time.
+//
+// Functions are labelled with their name and the line they are declared on, classes and natives
+// with their name. The stacks are written out folded, one line per distinct stack with the number of samples
+// it got, which flame graph tools read as they are; a table of self and total time with the
+// number of calls of each function goes to stderr
+class Profiler {
+public:
+    static constexpr std::chrono::microseconds DefaultInterval{1000};
+
+    explicit Profiler(std::string path, std::chrono::microseconds interval = DefaultInterval);
+    ~Profiler();
+
+    void start();
+    // Stops sampling and writes out the profile
+    void finish();
+
+    // Whether a sample is due, to be taken at the next safe point
+    bool due() const
+    {
+        return pending != 0;
+    }
+    void sample(std::span<object::Callable *const> stack);
+    void count(object::Callable *callee);
+
+    std::string folded() const;
+    std::string table() const;
+
+private:
+    Profiler(const Profiler &other) = delete;
+    Profiler &operator=(const Profiler &other) = delete;
+
+    // A function closure made from one declaration shares its key with every other one
+    using Key = const void *;
+
+    struct Entry {
+        std::string label;
+        std::size_t calls = 0;
+        std::size_t self = 0;
+        std::size_t total = 0;
+        // Last sample counted in `total`, so recursion counts once per sample
+        std::size_t seen = 0;
+    };
+
+    Entry &entry(object::Callable *callee);
+    void stop();
+
+    static void onTimer(int);
+    static inline volatile std::sig_atomic_t pending = 0;
+
+    std::string path;
+    std::chrono::microseconds interval;
+    bool running = false;
+    // Processor time the profile covers, which the samples split up: the timer may fire less often
+    // than asked for
+    std::clock_t begin = 0;
+    double milliseconds = 0;
+    std::size_t samples = 0;
+    // The top-level code, below every stack
+    Entry script;
+    std::map<Key, Entry> entries;
+    // Samples per stack of entries, which the map keeps in place
+    std::map<std::vector<const Entry *>, std::size_t> stacks;
+    std::vector<const Entry *> scratch;
+};
+
+}  // namespace draft
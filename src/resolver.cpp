@@ -3,10 +3,6 @@
 #include "driver.h"
 
 namespace draft {
-Resolver::Resolver(Interpreter *interpreter)
-    : interpreter{interpreter}
-{
-}
 
 object::Object Resolver::visit(Literal *)
 {
@@ -54,19 +50,19 @@ object::Object Resolver::visit(Variable *expr)
     if (!scopes.empty()) {
         auto &scope = scopes.back();
         if (auto it = scope.find(expr->name.lexeme); it != scope.end()) {
-            if (!it->second) {
+            if (!it->second.defined) {
                 Driver::error(expr->name.line, "Can't read local variable in its own initializer");
             }
         }
     }
-    resolveLocal(expr, expr->name);
+    resolveLocal(expr->slot, expr->name);
     return object::Null{};
 }
 
 object::Object Resolver::visit(Assign *expr)
 {
     resolve(expr->value);
-    resolveLocal(expr, expr->name);
+    resolveLocal(expr->slot, expr->name);
     return object::Null{};
 }
 
@@ -90,7 +86,7 @@ object::Object Resolver::visit(Super *expr)
     } else if (currentClass != ClassType::Subclass) {
         Driver::error(expr->keyword.line, "Can't use 'super' in a class with no superclass");
     }
-    resolveLocal(expr, expr->keyword);
+    resolveLocal(expr->slot, expr->keyword);
     return object::Null{};
 }
 
@@ -100,7 +96,39 @@ object::Object Resolver::visit(This *expr)
         Driver::error(expr->keyword.line, "Can't use 'this' outside of a class");
         return object::Null{};
     }
-    resolveLocal(expr, expr->keyword);
+    resolveLocal(expr->slot, expr->keyword);
+    return object::Null{};
+}
+
+object::Object Resolver::visit(ListExpr *expr)
+{
+    for (Expr *element : expr->elements) {
+        resolve(element);
+    }
+    return object::Null{};
+}
+
+object::Object Resolver::visit(MapExpr *expr)
+{
+    for (std::size_t i = 0; i < expr->keys.size(); i++) {
+        resolve(expr->keys[i]);
+        resolve(expr->values[i]);
+    }
+    return object::Null{};
+}
+
+object::Object Resolver::visit(GetIndex *expr)
+{
+    resolve(expr->object);
+    resolve(expr->index);
+    return object::Null{};
+}
+
+object::Object Resolver::visit(SetIndex *expr)
+{
+    resolve(expr->object);
+    resolve(expr->index);
+    resolve(expr->value);
     return object::Null{};
 }
 
@@ -122,7 +150,7 @@ void Resolver::visit(FuncStmt *stmt)
 {
     declare(stmt->name);
     define(stmt->name);
-    resolveFunction(stmt);
+    resolveFunction(stmt, FunctionType::Function);
 }
 
 void Resolver::visit(Print *stmt)
@@ -149,8 +177,26 @@ void Resolver::visit(While *stmt)
     resolve(stmt->body);
 }
 
+void Resolver::visit(Yield *stmt)
+{
+    if (currentFunction == FunctionType::None) {
+        Driver::error(stmt->keyword.line, "Can't yield from top-level code");
+    } else if (currentFunction == FunctionType::Initializer) {
+        Driver::error(stmt->keyword.line, "Can't yield from an initializer");
+    } else {
+        currentDeclaration->generator = true;
+    }
+    if (stmt->value) {
+        resolve(stmt->value);
+    }
+}
+
 void Resolver::visit(Block *stmt)
 {
+    if (!stmt->scoped) {
+        resolve(stmt->statements);
+        return;
+    }
     beginScope();
     resolve(stmt->statements);
     endScope();
@@ -172,14 +218,8 @@ void Resolver::visit(Class *stmt)
         }
 
         beginScope();
-        scopes.back()["super"] = true;
+        scopes.back().emplace("super", Binding{true, 0});
     }
-    beginScope();
-    auto back = scopes.back();
-    back["this"] = true;
-    scopes.pop_back();
-    scopes.emplace_back(back);
-
     for (FuncStmt *method : stmt->methods) {
         FunctionType declaration = FunctionType::Method;
         if (method->name.lexeme == "init") {
@@ -187,7 +227,6 @@ void Resolver::visit(Class *stmt)
         }
         resolveFunction(method, declaration);
     }
-    endScope();
     if (stmt->superclass) {
         endScope();
     }
@@ -203,7 +242,7 @@ void Resolver::visit(Var *stmt)
     define(stmt->name);
 }
 
-void Resolver::resolve(const std::vector<Stmt *> &statements)
+void Resolver::resolve(std::span<Stmt *const> statements)
 {
     for (Stmt *statement : statements) {
         resolve(statement);
@@ -240,7 +279,8 @@ void Resolver::declare(Token name)
     if (scope.contains(name.lexeme)) {
         Driver::error(name.line, "Already a variable with this name in this scope");
     }
-    scope.emplace(name.lexeme, false);
+    // Slots are numbered in declaration order, the same order the Interpreter defines them in
+    scope.emplace(name.lexeme, Binding{false, scope.size()});
 }
 
 void Resolver::define(Token name)
@@ -248,14 +288,15 @@ void Resolver::define(Token name)
     if (scopes.empty()) {
         return;
     }
-    scopes.back()[name.lexeme] = true;
+    scopes.back()[name.lexeme].defined = true;
 }
 
-void Resolver::resolveLocal(Expr *expr, Token name)
+void Resolver::resolveLocal(Slot &slot, const Token &name)
 {
     for (int i = scopes.size() - 1; i >= 0; i--) {
-        if (scopes.at(i).contains(name.lexeme)) {
-            interpreter->resolve(expr, scopes.size() - 1 - i);
+        const Scope &scope = scopes.at(i);
+        if (auto it = scope.find(name.lexeme); it != scope.end()) {
+            slot = Slot{static_cast<int>(scopes.size() - 1 - i), it->second.slot};
             return;
         }
     }
@@ -264,8 +305,14 @@ void Resolver::resolveLocal(Expr *expr, Token name)
 void Resolver::resolveFunction(FuncStmt *function, FunctionType type)
 {
     FunctionType enclosing = currentFunction;
+    FuncStmt *enclosingDeclaration = currentDeclaration;
     currentFunction = type;
+    currentDeclaration = function;
     beginScope();
+    // A method receives "this" in the first slot of its call environment, ahead of the parameters
+    if (type == FunctionType::Method or type == FunctionType::Initializer) {
+        scopes.back().emplace("this", Binding{true, 0});
+    }
     for (Token param : function->params) {
         declare(param);
         define(param);
@@ -273,6 +320,7 @@ void Resolver::resolveFunction(FuncStmt *function, FunctionType type)
     resolve(function->body);
     endScope();
     currentFunction = enclosing;
+    currentDeclaration = enclosingDeclaration;
 }
 
 }  // namespace draft
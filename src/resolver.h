@@ -1,21 +1,22 @@
 #pragma once
 
 #include <map>
+#include <span>
 #include <stack>
+#include <string_view>
 
 #include "ast.h"
 
 namespace draft {
-class Interpreter;
 
+// Resolver performs static checks and records in every Variable, Assign, This and Super node the
+// slot of the local variable it refers to
 class Resolver : public IExprVisitor<object::Object>, IStmtVisitor<void> {
 public:
     enum class FunctionType { None, Function, Initializer, Method };
     enum class ClassType { None, Class, Subclass };
 
-    explicit Resolver(Interpreter *interpreter);
-
-    void resolve(const std::vector<Stmt *> &statements);
+    void resolve(std::span<Stmt *const> statements);
 
 private:
     object::Object visit(Literal *expr) override;
@@ -30,6 +31,10 @@ private:
     object::Object visit(Set *expr) override;
     object::Object visit(Super *expr) override;
     object::Object visit(This *expr) override;
+    object::Object visit(ListExpr *expr) override;
+    object::Object visit(MapExpr *expr) override;
+    object::Object visit(GetIndex *expr) override;
+    object::Object visit(SetIndex *expr) override;
 
     void visit(ExprStmt *stmt) override;
     void visit(If *stmt) override;
@@ -37,6 +42,7 @@ private:
     void visit(Print *stmt) override;
     void visit(Return *stmt) override;
     void visit(While *stmt) override;
+    void visit(Yield *stmt) override;
     void visit(Block *stmt) override;
     void visit(Class *stmt) override;
     void visit(Var *stmt) override;
@@ -48,14 +54,19 @@ private:
     void endScope();
     void declare(Token name);
     void define(Token name);
-    void resolveLocal(Expr *expr, Token name);
+    void resolveLocal(Slot &slot, const Token &name);
     void resolveFunction(FuncStmt *function, FunctionType type = FunctionType::None);
 
-    Interpreter *interpreter = nullptr;
-
-    using Scope = std::map<std::string, bool>;
+    struct Binding {
+        bool defined = false;
+        std::size_t slot = 0;
+    };
+    // Names view the source text, which outlives the resolution pass
+    using Scope = std::map<std::string_view, Binding>;
     std::vector<Scope> scopes;
     FunctionType currentFunction = FunctionType::None;
+    // The function being resolved, marked a generator if it yields
+    FuncStmt *currentDeclaration = nullptr;
     ClassType currentClass = ClassType::None;
 };
 
@@ -0,0 +1,216 @@
+#include "scan.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "char_class.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DRAFT_SCAN_SSE2 1
+#else
+#define DRAFT_SCAN_SSE2 0
+#endif
+
+namespace draft::scan {
+
+namespace {
+
+constexpr std::size_t Width = 16;
+
+template <typename Predicate>
+std::size_t skipScalar(std::string_view text, std::size_t pos, Predicate inRun)
+{
+    while (pos < text.size() and inRun(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+// Length of the well-formed UTF-8 sequence starting at `pos`, or zero. Follows the table of
+// well-formed byte sequences in the Unicode standard, which rules out overlong forms, surrogates
+// and code points past U+10FFFF by narrowing the range of the second byte
+std::size_t sequenceLength(std::string_view text, std::size_t pos)
+{
+    auto byte = [&](std::size_t i) { return static_cast<unsigned char>(text[pos + i]); };
+    auto within = [&](std::size_t i, unsigned char lo, unsigned char hi) {
+        return pos + i < text.size() and byte(i) >= lo and byte(i) <= hi;
+    };
+
+    unsigned char lead = byte(0);
+    if (lead < 0x80) {
+        return 1;
+    }
+    if (lead >= 0xC2 and lead <= 0xDF) {
+        return within(1, 0x80, 0xBF) ? 2 : 0;
+    }
+    if (lead >= 0xE0 and lead <= 0xEF) {
+        unsigned char lo = lead == 0xE0 ? 0xA0 : 0x80;
+        unsigned char hi = lead == 0xED ? 0x9F : 0xBF;
+        return within(1, lo, hi) and within(2, 0x80, 0xBF) ? 3 : 0;
+    }
+    if (lead >= 0xF0 and lead <= 0xF4) {
+        unsigned char lo = lead == 0xF0 ? 0x90 : 0x80;
+        unsigned char hi = lead == 0xF4 ? 0x8F : 0xBF;
+        return within(1, lo, hi) and within(2, 0x80, 0xBF) and within(3, 0x80, 0xBF) ? 4 : 0;
+    }
+    return 0;
+}
+
+#if DRAFT_SCAN_SSE2
+
+__m128i load(const char *p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+__m128i splat(char c)
+{
+    return _mm_set1_epi8(c);
+}
+
+// Unsigned lo <= c <= hi per byte, which SSE2 only offers through min and max
+__m128i inRange(__m128i c, char lo, char hi)
+{
+    __m128i aboveLo = _mm_cmpeq_epi8(_mm_max_epu8(c, splat(lo)), c);
+    __m128i belowHi = _mm_cmpeq_epi8(_mm_min_epu8(c, splat(hi)), c);
+    return _mm_and_si128(aboveLo, belowHi);
+}
+
+unsigned mask(__m128i matches)
+{
+    return static_cast<unsigned>(_mm_movemask_epi8(matches));
+}
+
+// Advances over whole chunks while every byte matches; stops at the first chunk with a mismatch
+// and returns the offset of that byte
+template <typename Classify>
+std::size_t skipVector(std::string_view text, std::size_t pos, Classify classify)
+{
+    while (text.size() - pos >= Width) {
+        unsigned outside = ~mask(classify(load(text.data() + pos))) & 0xffff;
+        if (outside) {
+            return pos + std::countr_zero(outside);
+        }
+        pos += Width;
+    }
+    return pos;
+}
+
+#endif
+
+}  // namespace
+
+std::size_t skipWhitespace(std::string_view text, std::size_t pos, std::uint32_t &lines)
+{
+#if DRAFT_SCAN_SSE2
+    while (text.size() - pos >= Width) {
+        __m128i c = load(text.data() + pos);
+        unsigned newlines = mask(_mm_cmpeq_epi8(c, splat('\n')));
+        unsigned blanks = mask(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, splat(' ')), _mm_cmpeq_epi8(c, splat('\t'))),
+                                            _mm_cmpeq_epi8(c, splat('\r'))));
+        unsigned outside = ~(newlines | blanks) & 0xffff;
+        if (outside) {
+            unsigned run = std::countr_zero(outside);
+            lines += std::popcount(newlines & ((1u << run) - 1));
+            return pos + run;
+        }
+        lines += std::popcount(newlines);
+        pos += Width;
+    }
+#endif
+    while (pos < text.size() and hasClass(text[pos], Whitespace | NewLine)) {
+        if (text[pos] == '\n') {
+            lines++;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+std::size_t skipDigits(std::string_view text, std::size_t pos)
+{
+#if DRAFT_SCAN_SSE2
+    pos = skipVector(text, pos, [](__m128i c) { return inRange(c, '0', '9'); });
+#endif
+    return skipScalar(text, pos, [](char c) { return hasClass(c, Digit); });
+}
+
+std::size_t skipAlphaNumeric(std::string_view text, std::size_t pos)
+{
+#if DRAFT_SCAN_SSE2
+    pos = skipVector(text, pos, [](__m128i c) {
+        // Setting bit 5 folds upper case onto lower case without pulling anything else into a-z
+        __m128i letters = inRange(_mm_or_si128(c, splat(0x20)), 'a', 'z');
+        __m128i digits = inRange(c, '0', '9');
+        __m128i underscores = _mm_cmpeq_epi8(c, splat('_'));
+        return _mm_or_si128(_mm_or_si128(letters, digits), underscores);
+    });
+#endif
+    return skipScalar(text, pos, [](char c) { return hasClass(c, Alpha | Digit); });
+}
+
+std::size_t find(std::string_view text, std::size_t pos, char byte, std::uint32_t &lines)
+{
+#if DRAFT_SCAN_SSE2
+    while (text.size() - pos >= Width) {
+        __m128i c = load(text.data() + pos);
+        unsigned newlines = mask(_mm_cmpeq_epi8(c, splat('\n')));
+        unsigned found = mask(_mm_cmpeq_epi8(c, splat(byte)));
+        if (found) {
+            unsigned offset = std::countr_zero(found);
+            lines += std::popcount(newlines & ((1u << offset) - 1));
+            return pos + offset;
+        }
+        lines += std::popcount(newlines);
+        pos += Width;
+    }
+#endif
+    while (pos < text.size() and text[pos] != byte) {
+        if (text[pos] == '\n') {
+            lines++;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+std::size_t indexLines(std::string_view text, std::vector<std::size_t> &lineStarts)
+{
+    std::size_t invalid = text.size();
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+#if DRAFT_SCAN_SSE2
+        if (text.size() - pos >= Width) {
+            __m128i c = load(text.data() + pos);
+            unsigned newlines = mask(_mm_cmpeq_epi8(c, splat('\n')));
+            // The sign bits are set exactly for the bytes outside ASCII
+            unsigned nonAscii = mask(c);
+            unsigned ascii = nonAscii ? std::countr_zero(nonAscii) : Width;
+            if (ascii < Width) {
+                newlines &= (1u << ascii) - 1;
+            }
+            for (; newlines; newlines &= newlines - 1) {
+                lineStarts.push_back(pos + std::countr_zero(newlines) + 1);
+            }
+            pos += ascii;
+            if (ascii == Width) {
+                continue;
+            }
+        }
+#endif
+        std::size_t length = sequenceLength(text, pos);
+        if (length == 0) {
+            // Keep indexing past a malformed byte, lines are still wanted for reporting it
+            invalid = std::min(invalid, pos);
+            length = 1;
+        }
+        if (text[pos] == '\n') {
+            lineStarts.push_back(pos + 1);
+        }
+        pos += length;
+    }
+    return invalid;
+}
+
+}  // namespace draft::scan
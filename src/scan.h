@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace draft::scan {
+
+// Run scanners for the lexer's hot loops. Each starts at `pos` and returns the offset of the first
+// byte that ends the run, or the size of the text. With SSE2 they test 16 bytes at a time and
+// finish the tail with the scalar lookup through charClasses
+
+// Spaces, tabs, carriage returns and newlines; adds the newlines skipped to `lines`
+std::size_t skipWhitespace(std::string_view text, std::size_t pos, std::uint32_t &lines);
+std::size_t skipDigits(std::string_view text, std::size_t pos);
+// Letters, digits and underscores
+std::size_t skipAlphaNumeric(std::string_view text, std::size_t pos);
+// Offset of the next `byte`; adds the newlines passed on the way to `lines`
+std::size_t find(std::string_view text, std::size_t pos, char byte, std::uint32_t &lines);
+
+// Validates the text as UTF-8 and, in the same pass, appends the offset just past every newline to
+// `lineStarts`. Returns the offset of the first byte of a malformed or truncated sequence, or the
+// size of the text; malformed bytes do not stop the indexing. Blocks of ASCII take 16 bytes a step
+std::size_t indexLines(std::string_view text, std::vector<std::size_t> &lineStarts);
+
+}  // namespace draft::scan
@@ -0,0 +1,103 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+#include "builtin.h"
+#include "interpreter.h"
+#include "obj_coroutine.h"
+
+namespace draft {
+
+void Scheduler::add(std::shared_ptr<object::Coroutine> task)
+{
+    task->scheduled = true;
+    ready.push_back(std::move(task));
+}
+
+void Scheduler::run(Interpreter *interpreter, const std::function<bool()> &finished, Clock::time_point deadline)
+{
+    while (!finished()) {
+        for (std::size_t i = 0; i < awaiting.size();) {
+            if (awaiting[i]->awaiting->isDone()) {
+                awaiting[i]->awaiting = nullptr;
+                ready.push_back(std::move(awaiting[i]));
+                awaiting[i] = std::move(awaiting.back());
+                awaiting.pop_back();
+            } else {
+                i++;
+            }
+        }
+        if (ready.empty()) {
+            if (sleeping.empty()) {
+                return;
+            }
+            std::this_thread::sleep_until(std::min(sleeping.top().wakeAt, deadline));
+        }
+        while (!sleeping.empty() and sleeping.top().wakeAt <= Clock::now()) {
+            ready.push_back(sleeping.top().task);
+            sleeping.pop();
+        }
+        if (ready.empty()) {
+            continue;
+        }
+
+        std::shared_ptr<object::Coroutine> task = std::move(ready.front());
+        ready.pop_front();
+        // A task someone resumed by calling it goes on as their coroutine, until it is awaited
+        if (task->isRunning()) {
+            task->scheduled = false;
+            continue;
+        }
+        object::Coroutine *outer = std::exchange(running, task.get());
+        task->resume(interpreter);
+        running = outer;
+
+        if (task->isDone()) {
+            task->scheduled = false;
+        } else if (task->wakeAt) {
+            sleeping.push({*std::exchange(task->wakeAt, std::nullopt), std::move(task)});
+        } else if (task->awaiting) {
+            awaiting.push_back(std::move(task));
+        } else {
+            ready.push_back(std::move(task));
+        }
+    }
+}
+
+object::Coroutine *Scheduler::current(const Interpreter *interpreter) const
+{
+    return running and interpreter->getCoroutine() == running ? running : nullptr;
+}
+
+void Scheduler::sleep(Interpreter *interpreter, Clock::time_point until)
+{
+    if (object::Coroutine *task = current(interpreter)) {
+        task->wakeAt = until;
+        task->suspend(object::Null{});
+        return;
+    }
+    run(interpreter, [until] { return Clock::now() >= until; }, until);
+    std::this_thread::sleep_until(until);
+}
+
+void Scheduler::await(Interpreter *interpreter, const std::shared_ptr<object::Coroutine> &coroutine)
+{
+    if (!coroutine->scheduled and !coroutine->isDone()) {
+        add(coroutine);
+    }
+    if (object::Coroutine *task = current(interpreter)) {
+        if (task == coroutine.get()) {
+            throw NativeError{"A task can't await itself"};
+        }
+        while (!coroutine->isDone()) {
+            task->awaiting = coroutine;
+            task->suspend(object::Null{});
+        }
+        return;
+    }
+    run(interpreter, [&coroutine] { return coroutine->isDone(); });
+}
+
+}  // namespace draft
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+namespace draft {
+class Interpreter;
+namespace object {
+class Coroutine;
+}  // namespace object
+
+// Runs coroutines as tasks, taking turns on the interpreter's thread. A task runs until it yields,
+// sleeps or awaits another one, and then the next ready task runs. There is no I/O to poll for
+// yet, so waiting for the earliest sleeper is all the loop ever blocks on
+class Scheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void add(std::shared_ptr<object::Coroutine> task);
+
+    // Runs tasks until `finished` holds or no task can run any more: those left are waiting for a
+    // task that never ends. While every task sleeps, waits for the first to wake up, or for
+    // `deadline` if that comes sooner
+    void run(Interpreter *interpreter, const std::function<bool()> &finished,
+             Clock::time_point deadline = Clock::time_point::max());
+
+    // The task whose turn it is, when the code running is its own rather than that of a coroutine
+    // it resumed. Only then can it give up its turn
+    object::Coroutine *current(const Interpreter *interpreter) const;
+
+    // What sleep() and await() do: from a task, give up the turn until the time has come or the
+    // coroutine has finished; from anywhere else, run the other tasks meanwhile
+    void sleep(Interpreter *interpreter, Clock::time_point until);
+    void await(Interpreter *interpreter, const std::shared_ptr<object::Coroutine> &coroutine);
+
+private:
+    struct Sleeper {
+        Clock::time_point wakeAt;
+        std::shared_ptr<object::Coroutine> task;
+
+        bool operator>(const Sleeper &other) const
+        {
+            return wakeAt > other.wakeAt;
+        }
+    };
+
+    std::deque<std::shared_ptr<object::Coroutine>> ready;
+    std::priority_queue<Sleeper, std::vector<Sleeper>, std::greater<>> sleeping;
+    std::vector<std::shared_ptr<object::Coroutine>> awaiting;
+    object::Coroutine *running = nullptr;
+};
+
+}  // namespace draft
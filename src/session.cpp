@@ -0,0 +1,16 @@
+#include "session.h"
+
+namespace draft {
+
+std::string_view Session::add(const std::string &source)
+{
+    unit = nodes.mark();
+    return sources.getSource(sources.makeSource(source)).text();
+}
+
+void Session::discard()
+{
+    nodes.rewind(unit);
+}
+
+}  // namespace draft
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "arena.h"
+#include "source_manager.h"
+
+namespace draft {
+
+// An incremental compilation session, such as the prompt's. The sources it is given and the nodes
+// parsed or made from them live as long as the session, since what one source declares is called
+// by the ones after it; each new source is parsed into the blocks the earlier ones left free
+class Session {
+public:
+    // Keeps a copy of `source` for the session and returns it, starting a new unit
+    std::string_view add(const std::string &source);
+    // Destroys the nodes of the newest unit, once it failed to compile and nothing can refer to them
+    void discard();
+
+    memory::Arena &arena()
+    {
+        return nodes;
+    }
+
+private:
+    SourceManager sources;
+    memory::Arena nodes;
+    // Where the newest unit begins
+    memory::Arena::Mark unit;
+};
+
+}  // namespace draft
@@ -1,16 +1,165 @@
 #include "source.h"
 
-#include <codecvt>
-#include <locale>
+#include <algorithm>
+
+#include "scan.h"
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DRAFT_HAS_MMAP
+#endif
 
 namespace draft {
+namespace {
+
+constexpr Source::Char replacementCharacter = U'\uFFFD';
+
+bool isContinuation(unsigned char byte)
+{
+    return (byte & 0xC0) == 0x80;
+}
+
+// Decodes the code point starting at `pos` and sets `length` to the number of bytes it takes.
+// Malformed, overlong and surrogate sequences decode to U+FFFD one byte at a time
+Source::Char decode(std::string_view utf8, std::size_t pos, std::size_t &length)
+{
+    auto lead = static_cast<unsigned char>(utf8[pos]);
+    length = 1;
+    if (lead < 0x80) {
+        return lead;
+    }
+
+    std::size_t count = 0;
+    Source::Char min = 0;
+    Source::Char c = 0;
+    if ((lead & 0xE0) == 0xC0) {
+        count = 1;
+        min = 0x80;
+        c = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+        count = 2;
+        min = 0x800;
+        c = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+        count = 3;
+        min = 0x10000;
+        c = lead & 0x07;
+    } else {
+        return replacementCharacter;
+    }
+    if (pos + count >= utf8.size()) {
+        return replacementCharacter;
+    }
+    for (std::size_t i = 1; i <= count; ++i) {
+        auto byte = static_cast<unsigned char>(utf8[pos + i]);
+        if (!isContinuation(byte)) {
+            return replacementCharacter;
+        }
+        c = (c << 6) | (byte & 0x3F);
+    }
+    if (c < min or c > 0x10FFFF or (c >= 0xD800 and c <= 0xDFFF)) {
+        return replacementCharacter;
+    }
+    length = count + 1;
+    return c;
+}
+
+void encode(Source::Char c, std::string &utf8)
+{
+    if (c > 0x10FFFF or (c >= 0xD800 and c <= 0xDFFF)) {
+        c = replacementCharacter;
+    }
+    if (c < 0x80) {
+        utf8 += static_cast<char>(c);
+    } else if (c < 0x800) {
+        utf8 += static_cast<char>(0xC0 | (c >> 6));
+        utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        utf8 += static_cast<char>(0xE0 | (c >> 12));
+        utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        utf8 += static_cast<char>(0xF0 | (c >> 18));
+        utf8 += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    }
+}
+
+#ifdef DRAFT_HAS_MMAP
+class Mapping {
+public:
+    Mapping(void *data, std::size_t size)
+        : data{data}
+        , size{size}
+    {
+    }
+    ~Mapping()
+    {
+        ::munmap(data, size);
+    }
+
+    void *data = nullptr;
+    std::size_t size = 0;
 
-std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> conv;
+private:
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+};
+#endif
+
+}  // namespace
 
 Source::Source(const std::string &utf8)
-    : buf{fromStdString(utf8)}
 {
-    calculateLineOffsets();
+    auto owned = std::make_shared<const std::string>(utf8);
+    buf = *owned;
+    storage = std::move(owned);
+}
+
+std::optional<Source> Source::map(const std::string &path)
+{
+#ifdef DRAFT_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    struct stat info {};
+    void *data = MAP_FAILED;
+    if (::fstat(fd, &info) == 0 and S_ISREG(info.st_mode) and info.st_size > 0) {
+        data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return std::nullopt;
+    }
+    auto size = static_cast<std::size_t>(info.st_size);
+    ::madvise(data, size, MADV_SEQUENTIAL);
+
+    Source source;
+    auto mapping = std::make_shared<const Mapping>(data, size);
+    source.buf = std::string_view{static_cast<const char *>(data), size};
+    source.storage = std::move(mapping);
+    return source;
+#else
+    (void)path;
+    return std::nullopt;
+#endif
+}
+
+std::string_view Source::text() const
+{
+    return buf;
+}
+
+Source::Offset Source::invalidOffset() const
+{
+    index();
+    return invalid;
 }
 
 Source::Position Source::positionAt(Offset offset) const
@@ -23,11 +172,18 @@ Source::Position Source::positionAt(Offset offset) const
 
     offset = std::min(offset, buf.size() - 1);
 
+    index();
     auto it = std::upper_bound(lineOffsets.begin(), lineOffsets.end(), offset);
-    auto index = std::distance(lineOffsets.begin(), std::prev(it));
+    auto line = std::distance(lineOffsets.begin(), std::prev(it));
+
+    // Columns count code points, so skip the continuation bytes of the line
+    std::string_view prefix = buf.substr(lineOffsets[line], offset - lineOffsets[line]);
+    auto continuations = std::count_if(prefix.begin(), prefix.end(), [](char c) {
+        return isContinuation(static_cast<unsigned char>(c));
+    });
 
-    pos.line = index + 1;
-    pos.column = offset - lineOffsets.at(index) + 1;
+    pos.line = line + 1;
+    pos.column = prefix.size() - continuations + 1;
     return pos;
 }
 
@@ -37,47 +193,55 @@ std::string Source::lineAt(std::uint32_t line) const
         return "";
     }
 
+    index();
     line -= 1;  // expect lines numbering from one
     if (line >= lineOffsets.size()) {
         return "";
     }
 
-    auto begin = lineOffsets.at(line);
-    auto end = line == lineOffsets.size() - 1 ? buf.size() : lineOffsets.at(line + 1);
-    Buffer utf32 = buf.substr(begin, end - begin);
-    return toStdString(utf32);
+    auto begin = lineOffsets[line];
+    auto end = line == lineOffsets.size() - 1 ? buf.size() : lineOffsets[line + 1];
+    return std::string{buf.substr(begin, end - begin)};
 }
 
 Source::Char Source::charAt(Offset offset) const
 {
     if (offset < buf.size()) {
-        return buf.at(offset);
+        std::size_t length = 0;
+        return decode(buf, offset, length);
     }
     return '\0';
 }
 
 std::string Source::toStdString(const std::u32string &utf32)
 {
-    return conv.to_bytes(utf32);
+    std::string utf8;
+    utf8.reserve(utf32.size());
+    for (Char c : utf32) {
+        encode(c, utf8);
+    }
+    return utf8;
 }
 
 std::u32string Source::fromStdString(const std::string &utf8)
 {
-    return conv.from_bytes(utf8);
+    std::u32string utf32;
+    utf32.reserve(utf8.size());
+    std::size_t length = 0;
+    for (std::size_t pos = 0; pos < utf8.size(); pos += length) {
+        utf32 += decode(utf8, pos, length);
+    }
+    return utf32;
 }
 
-void Source::calculateLineOffsets()
+void Source::index() const
 {
-    lineOffsets.clear();
-    bool isLineStart = true;
-    for (Offset i = 0; i < buf.size(); ++i) {
-        if (isLineStart) {
-            lineOffsets.push_back(i);
-        }
-        isLineStart = buf.at(i) == '\n';
-    }
-    if (isLineStart and buf.size() != 0) {
-        lineOffsets.push_back(buf.size());
+    if (indexed) {
+        return;
     }
+    indexed = true;
+    lineOffsets.assign({0});
+    invalid = scan::indexLines(buf, lineOffsets);
 }
+
 }  // namespace draft
@@ -1,16 +1,22 @@
 #pragma once
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace draft {
 
+// Source text kept as the UTF-8 bytes it was read as. The text is either owned or mapped from a
+// file, and is never moved, so the Lexer and the tokens it produces can view it directly. Code
+// points are decoded only when asked for
 class Source {
 public:
     using Id = std::uint64_t;
-    using Buffer = std::u32string;
     using Char = char32_t;
 
+    // Byte offset into the UTF-8 text
     using Offset = std::size_t;
     struct Position {
         std::uint32_t line = 0;
@@ -25,18 +31,34 @@ public:
     Source() = default;
     explicit Source(const std::string &utf8);
 
+    // Maps the file read-only. Returns nothing if it cannot be mapped, e.g. a pipe or an empty file
+    static std::optional<Source> map(const std::string &path);
+
+    std::string_view text() const;
+
+    // Offset of the first byte that is not part of a well-formed UTF-8 sequence, or the size of
+    // the text when it is entirely valid
+    Offset invalidOffset() const;
+
     Position positionAt(Offset offset) const;
     std::string lineAt(std::uint32_t line) const;
+    // Code point starting at the offset, U+FFFD if the bytes there are not valid UTF-8
     Char charAt(Offset offset) const;
 
     static std::string toStdString(const std::u32string &utf32);
     static std::u32string fromStdString(const std::string &utf8);
 
 private:
-    void calculateLineOffsets();
+    // Validates the text and indexes its lines in one pass, on first use
+    void index() const;
 
-    Buffer buf;
-    std::vector<Offset> lineOffsets;
+    // Keeps the bytes viewed by `buf` alive: an owned string or a mapping
+    std::shared_ptr<const void> storage;
+    std::string_view buf;
+    // Built on first use, since most runs never report a position
+    mutable std::vector<Offset> lineOffsets;
+    mutable Offset invalid = 0;
+    mutable bool indexed = false;
 };
 
 }  // namespace draft
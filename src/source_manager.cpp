@@ -3,10 +3,15 @@
 namespace draft {
 
 Source::Id SourceManager::makeSource(const std::string &source, const std::string &path)
+{
+    return addSource(Source{source}, path);
+}
+
+Source::Id SourceManager::addSource(Source source, const std::string &path)
 {
     Source::Id id = sources.size();
     paths.emplace_back(path);
-    sources.emplace_back(source);
+    sources.emplace_back(std::move(source));
     return id;
 }
 
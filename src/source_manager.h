@@ -9,6 +9,7 @@ namespace draft {
 class SourceManager {
 public:
     Source::Id makeSource(const std::string &source, const std::string &path = "");
+    Source::Id addSource(Source source, const std::string &path = "");
 
     const std::string &getPath(Source::Id id) const;
     const Source &getSource(Source::Id id) const;
@@ -0,0 +1,52 @@
+#include "source_reader.h"
+
+#include <algorithm>
+
+namespace draft {
+
+SourceReader::SourceReader(std::istream &stream, std::size_t chunkSize)
+    : stream{stream}
+    , chunkSize{std::max<std::size_t>(chunkSize, 1)}
+{
+}
+
+std::string_view SourceReader::text() const
+{
+    if (chunks.empty()) {
+        return {};
+    }
+    return chunks.back();
+}
+
+bool SourceReader::next(std::size_t keep)
+{
+    std::string_view current = text();
+    keep = std::min(keep, current.size());
+
+    std::string chunk{current.substr(current.size() - keep)};
+    chunk += rest;
+    rest.clear();
+
+    while (stream) {
+        // Grows geometrically when a line, or a string literal, is longer than a chunk
+        std::size_t offset = chunk.size();
+        chunk.resize(offset + std::max(chunkSize, offset));
+        stream.read(chunk.data() + offset, static_cast<std::streamsize>(chunk.size() - offset));
+        chunk.resize(offset + static_cast<std::size_t>(stream.gcount()));
+
+        std::size_t newline = chunk.rfind('\n');
+        if (newline != std::string::npos and newline >= keep) {
+            rest.assign(chunk, newline + 1);
+            chunk.resize(newline + 1);
+            break;
+        }
+    }
+
+    if (chunk.size() == keep) {
+        return false;
+    }
+    chunks.push_back(std::move(chunk));
+    return true;
+}
+
+}  // namespace draft
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <deque>
+#include <istream>
+#include <string>
+#include <string_view>
+
+namespace draft {
+
+// Reads a stream in chunks, so lexing can start before the whole input is in memory. Chunks end
+// just after a newline, or at the end of the input, hence only a string literal spanning lines
+// can be split between two of them
+class SourceReader {
+public:
+    static constexpr std::size_t ChunkSize = 64 * 1024;
+
+    explicit SourceReader(std::istream &stream, std::size_t chunkSize = ChunkSize);
+
+    // Text of the current chunk, empty before the first call to next()
+    std::string_view text() const;
+
+    // Moves on to the next chunk, which starts with the last `keep` bytes of the current one.
+    // Returns false once the input is exhausted
+    bool next(std::size_t keep = 0);
+
+private:
+    std::istream &stream;
+    std::size_t chunkSize = ChunkSize;
+    // Chunks are never released: tokens, and the AST built from them, view the text in place
+    std::deque<std::string> chunks;
+    // Partial line read past the end of the current chunk
+    std::string rest;
+};
+
+}  // namespace draft
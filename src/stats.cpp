@@ -0,0 +1,46 @@
+#include "stats.h"
+
+#include <cstdio>
+#include <string_view>
+
+namespace draft {
+
+namespace {
+
+constexpr std::array<std::string_view, static_cast<std::size_t>(Stats::Node::Count)> nodeNames = {
+    "Literal",  "Logical",  "Unary",    "Binary",   "Call",     "Grouping", "Variable", "Assign",
+    "Get",      "Set",      "Super",    "This",     "ListExpr", "MapExpr",  "GetIndex", "SetIndex",
+    "ExprStmt", "If",       "FuncStmt", "Print",    "Return",   "While",    "Yield",    "Block",
+    "Class",    "Var",
+};
+
+void line(std::string &text, std::string_view name, std::uint64_t value)
+{
+    char row[64];
+    std::snprintf(row, sizeof(row), "%-24.*s %12llu\n", static_cast<int>(name.size()), name.data(),
+                  static_cast<unsigned long long>(value));
+    text += row;
+}
+
+}  // namespace
+
+std::string Stats::report() const
+{
+    std::string text;
+    line(text, "calls", calls);
+    line(text, "environments", environments);
+    line(text, "environments reused", environmentsReused);
+    line(text, "instances", instances);
+    line(text, "field hits", fieldHits);
+    line(text, "method hits", methodHits);
+    line(text, "property misses", propertyMisses);
+    line(text, "concatenations", concatenations);
+    line(text, "arena bytes", arenaBytes);
+    line(text, "arena blocks", arenaBlocks);
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        line(text, "nodes " + std::string{nodeNames[i]}, nodes[i]);
+    }
+    return text;
+}
+
+}  // namespace draft
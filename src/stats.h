@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace draft {
+
+// Counters of one tree-walker run, kept while the interpreter has a Stats to fill. Node counts are
+// per evaluation, and the fused loop tests and steps count the nodes they stand for
+struct Stats {
+    enum class Node : std::uint8_t {
+        Literal,
+        Logical,
+        Unary,
+        Binary,
+        Call,
+        Grouping,
+        Variable,
+        Assign,
+        Get,
+        Set,
+        Super,
+        This,
+        ListExpr,
+        MapExpr,
+        GetIndex,
+        SetIndex,
+        ExprStmt,
+        If,
+        FuncStmt,
+        Print,
+        Return,
+        While,
+        Yield,
+        Block,
+        Class,
+        Var,
+        Count,
+    };
+
+    void count(Node node)
+    {
+        nodes[static_cast<std::size_t>(node)]++;
+    }
+
+    // One "name value" line per counter
+    std::string report() const;
+
+    std::array<std::uint64_t, static_cast<std::size_t>(Node::Count)> nodes{};
+    std::uint64_t calls = 0;
+    // Environments allocated, and those taken from the pool instead
+    std::uint64_t environments = 0;
+    std::uint64_t environmentsReused = 0;
+    std::uint64_t instances = 0;
+    // The tree-walker has no property cache: a property is found among the fields, among the
+    // methods, or not at all
+    std::uint64_t fieldHits = 0;
+    std::uint64_t methodHits = 0;
+    std::uint64_t propertyMisses = 0;
+    std::uint64_t concatenations = 0;
+    // What the parser's arena holds for the program
+    std::size_t arenaBytes = 0;
+    std::size_t arenaBlocks = 0;
+};
+
+}  // namespace draft
@@ -1,5 +1,7 @@
 #include "token.h"
 
+#include <charconv>
+
 namespace draft {
 
 static std::string kind2str(Token::Kind kind)
@@ -17,17 +19,32 @@ static std::string kind2str(Token::Kind kind)
     return "Unrecognized";
 }
 
-Token::Token(Kind kind, Lexeme lexeme, object::Object literal, std::size_t line)
-    : kind{kind}
-    , lexeme{std::move(lexeme)}
-    , literal{std::move(literal)}
+Token::Token(Kind kind, Lexeme lexeme, std::uint32_t line)
+    : lexeme{lexeme}
     , line{line}
+    , kind{kind}
+{
+}
+
+std::string Token::toString() const
 {
+    return kind2str(kind) + " " + std::string{lexeme} + " " + object::obj2str(literal());
 }
 
-std::string Token::toString()
+object::Object Token::literal() const
 {
-    return kind2str(kind) + " " + lexeme + " " + object::obj2str(literal);
+    switch (kind) {
+    case Kind::NumberLiteral: {
+        double value = 0;
+        std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+        return object::Number{value};
+    }
+    case Kind::StringLiteral:
+        // Trim the surrounding quotes
+        return object::String{lexeme.substr(1, lexeme.size() - 2)};
+    default:
+        return object::Null{};
+    }
 }
 
 }  // namespace draft
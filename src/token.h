@@ -1,30 +1,37 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 #include "object.h"
 
 namespace draft {
 
-using Lexeme = std::string;
+// Views the source text, which must outlive every token lexed from it
+using Lexeme = std::string_view;
 
+// Small and trivially copyable: the lexeme points into the source and literal values are decoded
+// from it on demand
 class Token {
 public:
-    enum class Kind {
+    enum class Kind : std::uint8_t {
         Unrecognized,
 #define TOKEN(kind) kind,
 #include "token.def"
         EndOfFile,
     };
 
-    Token(Kind kind, Lexeme lexeme, object::Object literal, std::size_t line);
+    Token(Kind kind, Lexeme lexeme, std::uint32_t line);
 
-    std::string toString();
+    std::string toString() const;
+
+    // Value of a number or string literal, null for any other kind of token
+    object::Object literal() const;
 
-    const Kind kind = Kind::Unrecognized;
     Lexeme lexeme;
-    object::Object literal;
-    std::size_t line = 0;
+    std::uint32_t line = 0;
+    Kind kind = Kind::Unrecognized;
 };
 
 }  // namespace draft
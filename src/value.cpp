@@ -0,0 +1,65 @@
+#include "value.h"
+
+#include "vm_object.h"
+
+namespace draft::vm {
+
+bool isFalsey(Value value)
+{
+    return value.isNil() or (value.isBool() and !value.asBool());
+}
+
+bool valuesEqual(Value a, Value b)
+{
+    if (a.isNil() or b.isNil()) {
+        return a.isNil() and b.isNil();
+    }
+    if (a.isBool() and b.isBool()) {
+        return a.asBool() == b.asBool();
+    }
+    if (a.isNumber() and b.isNumber()) {
+        return a.asNumber() == b.asNumber();
+    }
+    // Strings are interned, so identity is equality for every object
+    if (a.isObj() and b.isObj()) {
+        return a.asObj() == b.asObj();
+    }
+    return false;
+}
+
+// Mirrors object::obj2str so that both engines print the same text
+std::string toString(Value value)
+{
+    if (value.isNil()) {
+        return "nil";
+    }
+    if (value.isBool()) {
+        return value.asBool() ? "true" : "false";
+    }
+    if (value.isNumber()) {
+        return std::to_string(value.asNumber());
+    }
+    switch (value.asObj()->type) {
+    case ObjType::String:
+        return as<ObjString>(value)->chars;
+    case ObjType::Instance:
+        return "instance";
+    case ObjType::Function:
+        [[fallthrough]];
+    case ObjType::Native:
+        [[fallthrough]];
+    case ObjType::Closure:
+        [[fallthrough]];
+    case ObjType::Class:
+        [[fallthrough]];
+    case ObjType::BoundMethod:
+        return "callable";
+    case ObjType::Shape:
+        [[fallthrough]];
+    case ObjType::Upvalue:
+        break;
+    }
+    return "internal";
+}
+
+}  // namespace draft::vm
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <string>
+
+namespace draft::vm {
+
+class Obj;
+
+// Value is the representation the bytecode VM keeps on its stack, in constant tables and in
+// object fields. Unlike object::Object it never owns anything: heap values are plain pointers
+// managed by vm::Heap, so copying a Value is always a trivial copy.
+//
+// With DRAFT_NAN_BOXING a Value is a single 64-bit word. Any bit pattern that is not a quiet NaN
+// with the bits below is a double; the remaining patterns carry nil, the booleans, or, with the
+// sign bit set, a 48-bit object pointer. Without it Value is a tagged union, which is easier to
+// inspect in a debugger.
+class Value {
+public:
+#ifdef DRAFT_NAN_BOXING
+    constexpr Value() = default;
+
+    static constexpr Value nil()
+    {
+        return Value{QuietNan | TagNil};
+    }
+    static constexpr Value boolean(bool value)
+    {
+        return Value{QuietNan | (value ? TagTrue : TagFalse)};
+    }
+    static constexpr Value number(double value)
+    {
+        return Value{std::bit_cast<std::uint64_t>(value)};
+    }
+    static Value object(Obj *value)
+    {
+        return Value{SignBit | QuietNan | static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(value))};
+    }
+
+    constexpr bool isNil() const
+    {
+        return bits == (QuietNan | TagNil);
+    }
+    constexpr bool isBool() const
+    {
+        return (bits | 1) == (QuietNan | TagTrue);
+    }
+    constexpr bool isNumber() const
+    {
+        return (bits & QuietNan) != QuietNan;
+    }
+    constexpr bool isObj() const
+    {
+        return (bits & (QuietNan | SignBit)) == (QuietNan | SignBit);
+    }
+
+    constexpr bool asBool() const
+    {
+        return bits == (QuietNan | TagTrue);
+    }
+    constexpr double asNumber() const
+    {
+        return std::bit_cast<double>(bits);
+    }
+    Obj *asObj() const
+    {
+        return reinterpret_cast<Obj *>(static_cast<std::uintptr_t>(bits & ~(SignBit | QuietNan)));
+    }
+
+private:
+    static constexpr std::uint64_t SignBit = 0x8000000000000000;
+    static constexpr std::uint64_t QuietNan = 0x7ffc000000000000;
+    static constexpr std::uint64_t TagNil = 1;
+    static constexpr std::uint64_t TagFalse = 2;
+    static constexpr std::uint64_t TagTrue = 3;
+
+    constexpr explicit Value(std::uint64_t bits)
+        : bits{bits}
+    {
+    }
+
+    std::uint64_t bits = QuietNan | TagNil;
+#else
+    enum class Type : std::uint8_t { Nil, Boolean, Number, Object };
+
+    constexpr Value() = default;
+
+    static constexpr Value nil()
+    {
+        return Value{};
+    }
+    static constexpr Value boolean(bool value)
+    {
+        Value v;
+        v.type = Type::Boolean;
+        v.as.boolean = value;
+        return v;
+    }
+    static constexpr Value number(double value)
+    {
+        Value v;
+        v.type = Type::Number;
+        v.as.number = value;
+        return v;
+    }
+    static constexpr Value object(Obj *value)
+    {
+        Value v;
+        v.type = Type::Object;
+        v.as.obj = value;
+        return v;
+    }
+
+    constexpr bool isNil() const
+    {
+        return type == Type::Nil;
+    }
+    constexpr bool isBool() const
+    {
+        return type == Type::Boolean;
+    }
+    constexpr bool isNumber() const
+    {
+        return type == Type::Number;
+    }
+    constexpr bool isObj() const
+    {
+        return type == Type::Object;
+    }
+
+    constexpr bool asBool() const
+    {
+        return as.boolean;
+    }
+    constexpr double asNumber() const
+    {
+        return as.number;
+    }
+    constexpr Obj *asObj() const
+    {
+        return as.obj;
+    }
+
+private:
+    Type type = Type::Nil;
+    union {
+        bool boolean;
+        double number;
+        Obj *obj = nullptr;
+    } as;
+#endif
+};
+
+#ifdef DRAFT_NAN_BOXING
+static_assert(sizeof(Value) == sizeof(std::uint64_t), "NaN-boxed Value must fit in one word");
+#endif
+
+// false and nil are falsey, and everything else is truthy
+bool isFalsey(Value value);
+bool valuesEqual(Value a, Value b);
+std::string toString(Value value);
+
+}  // namespace draft::vm
@@ -0,0 +1,688 @@
+#include "vm.h"
+
+#include <chrono>
+#include <ctime>
+
+#include "driver.h"
+
+// Threaded dispatch through a table of label addresses is a GNU extension; other compilers fall
+// back to a plain switch inside a loop
+#if defined(__GNUC__) || defined(__clang__)
+#define DRAFT_COMPUTED_GOTO 1
+#else
+#define DRAFT_COMPUTED_GOTO 0
+#endif
+
+namespace draft::vm {
+
+namespace {
+
+Value clockNative(int, Value *)
+{
+    namespace cr = std::chrono;
+    auto now = cr::system_clock::now();
+    auto epoch = now.time_since_epoch();
+    auto seconds = cr::duration_cast<cr::seconds>(epoch).count();
+    return Value::number(static_cast<double>(seconds));
+}
+
+Value clockNsNative(int, Value *)
+{
+    namespace cr = std::chrono;
+    auto now = cr::steady_clock::now().time_since_epoch();
+    return Value::number(static_cast<double>(cr::duration_cast<cr::nanoseconds>(now).count()));
+}
+
+Value cpuTimeNative(int, Value *)
+{
+    return Value::number(static_cast<double>(std::clock()) / CLOCKS_PER_SEC);
+}
+
+}  // namespace
+
+VM::Error::Error(std::size_t line, const std::string &message)
+    : std::runtime_error{message}
+    , line{line}
+{
+}
+
+VM::VM()
+    : stack{std::make_unique<Value[]>(StackMax)}
+{
+    resetStack();
+    objects.addRoots(this);
+    initString = objects.makeString("init");
+    defineNative("clock", 0, clockNative);
+    defineNative("clock_ns", 0, clockNsNative);
+    defineNative("cpu_time", 0, cpuTimeNative);
+}
+
+VM::~VM()
+{
+    objects.removeRoots(this);
+}
+
+void VM::interpret(ObjFunction *script)
+{
+    if (std::optional<Error> failure = run(script)) {
+        Driver::error(failure->line, failure->what());
+        std::exit(draft::exit::software);
+    }
+}
+
+std::optional<VM::Error> VM::run(ObjFunction *script)
+{
+    std::optional<Error> failure;
+    try {
+        // Keep the script reachable while its closure is allocated
+        push(Value::object(script));
+        ObjClosure *closure = objects.make<ObjClosure>(script);
+        pop();
+        push(Value::object(closure));
+        call(closure, 0);
+        dispatch();
+    } catch (const Error &err) {
+        resetStack();
+        failure = err;
+    }
+    sink.flush();
+    return failure;
+}
+
+Heap &VM::heap()
+{
+    return objects;
+}
+
+Output &VM::output()
+{
+    return sink;
+}
+
+void VM::markRoots(Heap &heap)
+{
+    for (Value *slot = stack.get(); slot < stackTop; slot++) {
+        heap.markValue(*slot);
+    }
+    for (std::size_t i = 0; i < frameCount; i++) {
+        heap.markObject(frames[i].closure);
+    }
+    for (ObjUpvalue *upvalue = openUpvalues; upvalue; upvalue = upvalue->nextOpen) {
+        heap.markObject(upvalue);
+    }
+    for (auto &[name, value] : globals) {
+        heap.markObject(name);
+        heap.markValue(value);
+    }
+    heap.markObject(initString);
+}
+
+void VM::dispatch()
+{
+    CallFrame *frame = &frames[frameCount - 1];
+    std::uint8_t *ip = frame->ip;
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<std::uint16_t>((ip[-2] << 8) | ip[-1]))
+#define READ_CONSTANT() (frame->closure->function->chunk.constants[READ_SHORT()])
+#define READ_STRING() as<ObjString>(READ_CONSTANT())
+#define READ_CACHE() (frame->closure->function->chunk.caches[READ_SHORT()])
+#define RUNTIME_ERROR(message) \
+    do {                       \
+        frame->ip = ip;        \
+        runtimeError(message); \
+    } while (false)
+#define BINARY_OP(makeValue, op)                                      \
+    do {                                                              \
+        if (!peek(0).isNumber() or !peek(1).isNumber()) {             \
+            RUNTIME_ERROR("Operands must be numbers");                \
+        }                                                             \
+        double b = pop().asNumber();                                  \
+        stackTop[-1] = Value::makeValue(stackTop[-1].asNumber() op b); \
+    } while (false)
+
+#if DRAFT_COMPUTED_GOTO
+    static void *dispatchTable[] = {
+#define OPCODE(name) &&op_##name,
+#include "opcode.def"
+    };
+#define DISPATCH() goto *dispatchTable[READ_BYTE()]
+#define CASE(name) op_##name
+    DISPATCH();
+#else
+#define DISPATCH() break
+#define CASE(name) case OpCode::name
+    while (true) {
+        switch (static_cast<OpCode>(READ_BYTE())) {
+#endif
+
+    CASE(Constant) :
+    {
+        push(READ_CONSTANT());
+        DISPATCH();
+    }
+    CASE(Nil) :
+    {
+        push(Value::nil());
+        DISPATCH();
+    }
+    CASE(True) :
+    {
+        push(Value::boolean(true));
+        DISPATCH();
+    }
+    CASE(False) :
+    {
+        push(Value::boolean(false));
+        DISPATCH();
+    }
+    CASE(Pop) :
+    {
+        pop();
+        DISPATCH();
+    }
+    CASE(GetLocal) :
+    {
+        std::uint8_t slot = READ_BYTE();
+        push(frame->slots[slot]);
+        DISPATCH();
+    }
+    CASE(SetLocal) :
+    {
+        std::uint8_t slot = READ_BYTE();
+        frame->slots[slot] = peek(0);
+        DISPATCH();
+    }
+    CASE(GetGlobal) :
+    {
+        ObjString *name = READ_STRING();
+        auto it = globals.find(name);
+        if (it == globals.end()) {
+            RUNTIME_ERROR("Undefined variable '" + name->chars + "'");
+        }
+        push(it->second);
+        DISPATCH();
+    }
+    CASE(DefineGlobal) :
+    {
+        ObjString *name = READ_STRING();
+        globals[name] = pop();
+        DISPATCH();
+    }
+    CASE(SetGlobal) :
+    {
+        ObjString *name = READ_STRING();
+        auto it = globals.find(name);
+        if (it == globals.end()) {
+            RUNTIME_ERROR("Undefined variable '" + name->chars + "'");
+        }
+        it->second = peek(0);
+        DISPATCH();
+    }
+    CASE(GetUpvalue) :
+    {
+        std::uint8_t slot = READ_BYTE();
+        push(*frame->closure->upvalues[slot]->location);
+        DISPATCH();
+    }
+    CASE(SetUpvalue) :
+    {
+        std::uint8_t slot = READ_BYTE();
+        *frame->closure->upvalues[slot]->location = peek(0);
+        DISPATCH();
+    }
+    CASE(GetProperty) :
+    {
+        if (!isObjType(peek(0), ObjType::Instance)) {
+            RUNTIME_ERROR("Only instances have properties");
+        }
+        ObjInstance *instance = as<ObjInstance>(peek(0));
+        ObjString *name = READ_STRING();
+        PropertyCache &cache = READ_CACHE();
+        const PropertyCache::Entry *entry = lookUpProperty(cache, instance->shape, name);
+        if (!entry) {
+            // Like the tree-walker, a missing property reads as nil
+            stackTop[-1] = Value::nil();
+        } else if (entry->method) {
+            bindMethod(entry->method);
+        } else {
+            stackTop[-1] = instance->fields[entry->slot];
+        }
+        DISPATCH();
+    }
+    CASE(SetProperty) :
+    {
+        if (!isObjType(peek(1), ObjType::Instance)) {
+            RUNTIME_ERROR("Only instances have fields");
+        }
+        ObjInstance *instance = as<ObjInstance>(peek(1));
+        ObjString *name = READ_STRING();
+        PropertyCache &cache = READ_CACHE();
+        const PropertyCache::Entry *entry = cache.find(instance->shape);
+        if (!entry) {
+            ObjShape *shape = instance->shape;
+            if (auto it = shape->slots.find(name); it != shape->slots.end()) {
+                entry = cache.add({.shape = shape, .slot = it->second});
+            } else {
+                ObjShape *grown = addField(shape, name);
+                entry = cache.add({.shape = shape, .slot = grown->slots.at(name), .transition = grown});
+            }
+        }
+        if (entry->transition) {
+            instance->shape = entry->transition;
+            instance->fields.push_back(peek(0));
+        } else {
+            instance->fields[entry->slot] = peek(0);
+        }
+        Value value = pop();
+        pop();
+        push(value);
+        DISPATCH();
+    }
+    CASE(GetSuper) :
+    {
+        ObjString *name = READ_STRING();
+        ObjClass *superclass = as<ObjClass>(pop());
+        auto method = superclass->methods.find(name);
+        if (method == superclass->methods.end()) {
+            RUNTIME_ERROR("Undefined property '" + name->chars + "'");
+        }
+        bindMethod(method->second);
+        DISPATCH();
+    }
+    CASE(Equal) :
+    {
+        Value b = pop();
+        stackTop[-1] = Value::boolean(valuesEqual(stackTop[-1], b));
+        DISPATCH();
+    }
+    CASE(NotEqual) :
+    {
+        Value b = pop();
+        stackTop[-1] = Value::boolean(!valuesEqual(stackTop[-1], b));
+        DISPATCH();
+    }
+    CASE(Greater) :
+    {
+        BINARY_OP(boolean, >);
+        DISPATCH();
+    }
+    CASE(GreaterEqual) :
+    {
+        BINARY_OP(boolean, >=);
+        DISPATCH();
+    }
+    CASE(Less) :
+    {
+        BINARY_OP(boolean, <);
+        DISPATCH();
+    }
+    CASE(LessEqual) :
+    {
+        BINARY_OP(boolean, <=);
+        DISPATCH();
+    }
+    CASE(Add) :
+    {
+        Value b = peek(0);
+        Value a = peek(1);
+        if (a.isNumber() and b.isNumber()) {
+            pop();
+            stackTop[-1] = Value::number(a.asNumber() + b.asNumber());
+        } else if (isObjType(a, ObjType::String) and isObjType(b, ObjType::String)) {
+            ObjString *result = objects.concatenate(as<ObjString>(a), as<ObjString>(b));
+            pop();
+            stackTop[-1] = Value::object(result);
+        } else {
+            RUNTIME_ERROR("Operands must be two numbers or two strings");
+        }
+        DISPATCH();
+    }
+    CASE(Subtract) :
+    {
+        BINARY_OP(number, -);
+        DISPATCH();
+    }
+    CASE(Multiply) :
+    {
+        BINARY_OP(number, *);
+        DISPATCH();
+    }
+    CASE(Divide) :
+    {
+        BINARY_OP(number, /);
+        DISPATCH();
+    }
+    CASE(Not) :
+    {
+        stackTop[-1] = Value::boolean(isFalsey(stackTop[-1]));
+        DISPATCH();
+    }
+    CASE(Negate) :
+    {
+        if (!peek(0).isNumber()) {
+            RUNTIME_ERROR("Operand must be a number");
+        }
+        stackTop[-1] = Value::number(-stackTop[-1].asNumber());
+        DISPATCH();
+    }
+    CASE(Print) :
+    {
+        Value value = pop();
+        if (value.isNumber()) {
+            sink.writeNumber(value.asNumber());
+        } else {
+            sink.write(toString(value));
+        }
+        sink.endLine();
+        DISPATCH();
+    }
+    CASE(Jump) :
+    {
+        std::uint16_t offset = READ_SHORT();
+        ip += offset;
+        DISPATCH();
+    }
+    CASE(JumpIfFalse) :
+    {
+        std::uint16_t offset = READ_SHORT();
+        if (isFalsey(peek(0))) {
+            ip += offset;
+        }
+        DISPATCH();
+    }
+    CASE(Loop) :
+    {
+        std::uint16_t offset = READ_SHORT();
+        ip -= offset;
+        DISPATCH();
+    }
+    CASE(Call) :
+    {
+        int argCount = READ_BYTE();
+        frame->ip = ip;
+        callValue(peek(argCount), argCount);
+        frame = &frames[frameCount - 1];
+        ip = frame->ip;
+        DISPATCH();
+    }
+    CASE(Invoke) :
+    {
+        ObjString *name = READ_STRING();
+        PropertyCache &cache = READ_CACHE();
+        int argCount = READ_BYTE();
+        frame->ip = ip;
+        invoke(name, cache, argCount);
+        frame = &frames[frameCount - 1];
+        ip = frame->ip;
+        DISPATCH();
+    }
+    CASE(SuperInvoke) :
+    {
+        ObjString *name = READ_STRING();
+        int argCount = READ_BYTE();
+        ObjClass *superclass = as<ObjClass>(pop());
+        auto method = superclass->methods.find(name);
+        if (method == superclass->methods.end()) {
+            RUNTIME_ERROR("Undefined property '" + name->chars + "'");
+        }
+        frame->ip = ip;
+        call(method->second, argCount);
+        frame = &frames[frameCount - 1];
+        ip = frame->ip;
+        DISPATCH();
+    }
+    CASE(Closure) :
+    {
+        ObjFunction *function = as<ObjFunction>(READ_CONSTANT());
+        ObjClosure *closure = objects.make<ObjClosure>(function);
+        push(Value::object(closure));
+        for (auto &upvalue : closure->upvalues) {
+            std::uint8_t isLocal = READ_BYTE();
+            std::uint8_t index = READ_BYTE();
+            if (isLocal) {
+                upvalue = captureUpvalue(frame->slots + index);
+            } else {
+                upvalue = frame->closure->upvalues[index];
+            }
+        }
+        DISPATCH();
+    }
+    CASE(CloseUpvalue) :
+    {
+        closeUpvalues(stackTop - 1);
+        pop();
+        DISPATCH();
+    }
+    CASE(Return) :
+    {
+        Value result = pop();
+        closeUpvalues(frame->slots);
+        frameCount--;
+        stackTop = frame->slots;
+        if (frameCount == 0) {
+            return;
+        }
+        push(result);
+        frame = &frames[frameCount - 1];
+        ip = frame->ip;
+        DISPATCH();
+    }
+    CASE(Class) :
+    {
+        ObjClass *klass = objects.make<ObjClass>(READ_STRING());
+        push(Value::object(klass));
+        klass->shape = objects.make<ObjShape>(klass);
+        DISPATCH();
+    }
+    CASE(Inherit) :
+    {
+        Value superclass = peek(1);
+        if (!isObjType(superclass, ObjType::Class)) {
+            RUNTIME_ERROR("Superclass must be a class");
+        }
+        // Copy-down inheritance: methods defined afterwards override the inherited ones
+        ObjClass *subclass = as<ObjClass>(peek(0));
+        subclass->methods = as<ObjClass>(superclass)->methods;
+        pop();
+        DISPATCH();
+    }
+    CASE(Method) :
+    {
+        ObjString *name = READ_STRING();
+        ObjClass *klass = as<ObjClass>(peek(1));
+        klass->methods[name] = as<ObjClosure>(peek(0));
+        pop();
+        DISPATCH();
+    }
+
+#if !DRAFT_COMPUTED_GOTO
+        }
+    }
+#endif
+
+#undef CASE
+#undef DISPATCH
+#undef BINARY_OP
+#undef RUNTIME_ERROR
+#undef READ_CACHE
+#undef READ_STRING
+#undef READ_CONSTANT
+#undef READ_SHORT
+#undef READ_BYTE
+}
+
+void VM::resetStack()
+{
+    stackTop = stack.get();
+    frameCount = 0;
+    openUpvalues = nullptr;
+}
+
+void VM::callValue(Value callee, int argCount)
+{
+    if (callee.isObj()) {
+        switch (callee.asObj()->type) {
+        case ObjType::BoundMethod: {
+            ObjBoundMethod *bound = as<ObjBoundMethod>(callee);
+            stackTop[-argCount - 1] = bound->receiver;
+            call(bound->method, argCount);
+            return;
+        }
+        case ObjType::Class: {
+            ObjClass *klass = as<ObjClass>(callee);
+            stackTop[-argCount - 1] = Value::object(objects.make<ObjInstance>(klass));
+            if (auto it = klass->methods.find(initString); it != klass->methods.end()) {
+                call(it->second, argCount);
+            } else if (argCount != 0) {
+                runtimeError("Expected 0 arguments but got " + std::to_string(argCount));
+            }
+            return;
+        }
+        case ObjType::Closure:
+            call(as<ObjClosure>(callee), argCount);
+            return;
+        case ObjType::Native: {
+            ObjNative *native = as<ObjNative>(callee);
+            if (argCount != native->arity) {
+                runtimeError("Expected " + std::to_string(native->arity) + " arguments but got " +
+                             std::to_string(argCount));
+            }
+            Value result = native->function(argCount, stackTop - argCount);
+            stackTop -= argCount + 1;
+            push(result);
+            return;
+        }
+        default:
+            break;
+        }
+    }
+    runtimeError("Can only call functions and classes");
+}
+
+void VM::call(ObjClosure *closure, int argCount)
+{
+    if (argCount != closure->function->arity) {
+        runtimeError("Expected " + std::to_string(closure->function->arity) + " arguments but got " +
+                     std::to_string(argCount));
+    }
+    if (frameCount == FramesMax) {
+        runtimeError("Stack overflow");
+    }
+    CallFrame *frame = &frames[frameCount++];
+    frame->closure = closure;
+    frame->ip = closure->function->chunk.code.data();
+    frame->slots = stackTop - argCount - 1;
+}
+
+// Calls the method `name` of the receiver below the arguments, with the receiver staying in slot
+// zero as "this". A field of that name is called as an ordinary value instead
+void VM::invoke(ObjString *name, PropertyCache &cache, int argCount)
+{
+    Value receiver = peek(argCount);
+    if (!isObjType(receiver, ObjType::Instance)) {
+        runtimeError("Only instances have properties");
+    }
+    ObjInstance *instance = as<ObjInstance>(receiver);
+    const PropertyCache::Entry *entry = lookUpProperty(cache, instance->shape, name);
+    if (!entry) {
+        runtimeError("Can only call functions and classes");
+    }
+    if (entry->method) {
+        call(entry->method, argCount);
+        return;
+    }
+    Value field = instance->fields[entry->slot];
+    stackTop[-argCount - 1] = field;
+    callValue(field, argCount);
+}
+
+// Resolves `name` on instances of `shape` to a field slot or a method, remembering the answer in
+// the access site's cache. Returns null if the shape has neither
+const PropertyCache::Entry *VM::lookUpProperty(PropertyCache &cache, ObjShape *shape, ObjString *name)
+{
+    if (const PropertyCache::Entry *entry = cache.find(shape)) {
+        return entry;
+    }
+    if (auto it = shape->slots.find(name); it != shape->slots.end()) {
+        return cache.add({.shape = shape, .slot = it->second});
+    }
+    if (auto it = shape->klass->methods.find(name); it != shape->klass->methods.end()) {
+        return cache.add({.shape = shape, .method = it->second});
+    }
+    return nullptr;
+}
+
+void VM::bindMethod(ObjClosure *method)
+{
+    ObjBoundMethod *bound = objects.make<ObjBoundMethod>(peek(0), method);
+    stackTop[-1] = Value::object(bound);
+}
+
+// Follows the transition for `name`, creating the child shape the first time a field is added
+ObjShape *VM::addField(ObjShape *shape, ObjString *name)
+{
+    if (auto it = shape->transitions.find(name); it != shape->transitions.end()) {
+        return it->second;
+    }
+    ObjShape *child = objects.make<ObjShape>(shape, name);
+    shape->transitions.emplace(name, child);
+    return child;
+}
+
+// Reuses an existing upvalue for the slot if one is open, so closures share variables
+ObjUpvalue *VM::captureUpvalue(Value *local)
+{
+    ObjUpvalue *prev = nullptr;
+    ObjUpvalue *upvalue = openUpvalues;
+    while (upvalue and upvalue->location > local) {
+        prev = upvalue;
+        upvalue = upvalue->nextOpen;
+    }
+    if (upvalue and upvalue->location == local) {
+        return upvalue;
+    }
+
+    ObjUpvalue *created = objects.make<ObjUpvalue>(local);
+    created->nextOpen = upvalue;
+    if (prev) {
+        prev->nextOpen = created;
+    } else {
+        openUpvalues = created;
+    }
+    return created;
+}
+
+void VM::closeUpvalues(Value *last)
+{
+    while (openUpvalues and openUpvalues->location >= last) {
+        ObjUpvalue *upvalue = openUpvalues;
+        upvalue->closed = *upvalue->location;
+        upvalue->location = &upvalue->closed;
+        openUpvalues = upvalue->nextOpen;
+    }
+}
+
+void VM::defineNative(const std::string &name, int arity, NativeFn function)
+{
+    // Both objects stay on the stack so that neither allocation can collect the other
+    push(Value::object(objects.makeString(name)));
+    push(Value::object(objects.make<ObjNative>(function, arity)));
+    globals[as<ObjString>(peek(1))] = peek(0);
+    pop();
+    pop();
+}
+
+void VM::runtimeError(const std::string &message)
+{
+    std::size_t line = 0;
+    if (frameCount > 0) {
+        const CallFrame &frame = frames[frameCount - 1];
+        const Chunk &chunk = frame.closure->function->chunk;
+        std::size_t instruction = frame.ip - chunk.code.data() - 1;
+        line = chunk.lines.at(instruction);
+    }
+    throw Error{line, message};
+}
+
+}  // namespace draft::vm
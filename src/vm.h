@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "heap.h"
+#include "output.h"
+
+namespace draft::vm {
+
+// Stack-based virtual machine executing the bytecode produced by vm::Compiler. Globals and the
+// heap outlive a single interpret() call, so the REPL can feed it one line at a time.
+class VM : public Roots {
+public:
+    VM();
+    ~VM() override;
+
+    class Error : public std::runtime_error {
+    public:
+        Error(std::size_t line, const std::string &message);
+
+        std::size_t line = 0;
+    };
+
+    // Runs the script, reporting a runtime error and exiting the process with it
+    void interpret(ObjFunction *script);
+    // Runs the script and returns the runtime error that stopped it, if any. The stack is reset
+    // then, while globals stay, so the VM can run the next script
+    std::optional<Error> run(ObjFunction *script);
+
+    Heap &heap();
+    // Where print writes; it is flushed as run() returns
+    Output &output();
+
+    void markRoots(Heap &heap) override;
+
+private:
+
+    struct CallFrame {
+        ObjClosure *closure = nullptr;
+        std::uint8_t *ip = nullptr;
+        Value *slots = nullptr;
+    };
+
+    static constexpr std::size_t FramesMax = 1024;
+    static constexpr std::size_t StackMax = FramesMax * 256;
+
+    void dispatch();
+
+    void push(Value value)
+    {
+        *stackTop++ = value;
+    }
+    Value pop()
+    {
+        return *--stackTop;
+    }
+    Value peek(std::size_t distance) const
+    {
+        return stackTop[-1 - static_cast<std::ptrdiff_t>(distance)];
+    }
+
+    void resetStack();
+    void callValue(Value callee, int argCount);
+    void call(ObjClosure *closure, int argCount);
+    void invoke(ObjString *name, PropertyCache &cache, int argCount);
+    const PropertyCache::Entry *lookUpProperty(PropertyCache &cache, ObjShape *shape, ObjString *name);
+    void bindMethod(ObjClosure *method);
+    ObjShape *addField(ObjShape *shape, ObjString *name);
+    ObjUpvalue *captureUpvalue(Value *local);
+    void closeUpvalues(Value *last);
+    void defineNative(const std::string &name, int arity, NativeFn function);
+
+    [[noreturn]] void runtimeError(const std::string &message);
+
+    Heap objects;
+    std::unique_ptr<Value[]> stack;
+    Value *stackTop = nullptr;
+    std::array<CallFrame, FramesMax> frames;
+    std::size_t frameCount = 0;
+    ObjUpvalue *openUpvalues = nullptr;
+    std::unordered_map<ObjString *, Value> globals;
+    ObjString *initString = nullptr;
+    Output sink;
+};
+
+}  // namespace draft::vm
@@ -0,0 +1,76 @@
+#include "vm_object.h"
+
+namespace draft::vm {
+
+Obj::Obj(ObjType type)
+    : type{type}
+{
+}
+
+ObjString::ObjString(std::string chars)
+    : Obj{ObjType::String}
+    , chars{std::move(chars)}
+{
+}
+
+ObjFunction::ObjFunction()
+    : Obj{ObjType::Function}
+{
+}
+
+ObjNative::ObjNative(NativeFn function, int arity)
+    : Obj{ObjType::Native}
+    , function{function}
+    , arity{arity}
+{
+}
+
+ObjUpvalue::ObjUpvalue(Value *slot)
+    : Obj{ObjType::Upvalue}
+    , location{slot}
+{
+}
+
+ObjClosure::ObjClosure(ObjFunction *function)
+    : Obj{ObjType::Closure}
+    , function{function}
+    , upvalues(function->upvalueCount, nullptr)
+{
+}
+
+ObjClass::ObjClass(ObjString *name)
+    : Obj{ObjType::Class}
+    , name{name}
+{
+}
+
+ObjShape::ObjShape(ObjClass *klass)
+    : Obj{ObjType::Shape}
+    , klass{klass}
+{
+}
+
+ObjShape::ObjShape(ObjShape *parent, ObjString *name)
+    : Obj{ObjType::Shape}
+    , klass{parent->klass}
+    , parent{parent}
+    , slots{parent->slots}
+{
+    slots.emplace(name, static_cast<std::uint32_t>(slots.size()));
+}
+
+ObjInstance::ObjInstance(ObjClass *klass)
+    : Obj{ObjType::Instance}
+    , klass{klass}
+    , shape{klass->shape}
+{
+}
+
+ObjBoundMethod::ObjBoundMethod(Value receiver, ObjClosure *method)
+    : Obj{ObjType::BoundMethod}
+    , receiver{receiver}
+    , method{method}
+{
+}
+
+}  // namespace draft::vm
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chunk.h"
+#include "value.h"
+
+namespace draft::vm {
+
+enum class ObjType : std::uint8_t { String, Function, Native, Closure, Upvalue, Class, Shape, Instance, BoundMethod };
+
+// Common header of every heap object owned by the VM. Objects are chained through `next` so the
+// collector can sweep them
+class Obj {
+public:
+    explicit Obj(ObjType type);
+    virtual ~Obj() = default;
+
+    const ObjType type;
+    bool marked = false;
+    Obj *next = nullptr;
+
+private:
+    Obj(const Obj &) = delete;
+    Obj &operator=(const Obj &) = delete;
+};
+
+class ObjString : public Obj {
+public:
+    explicit ObjString(std::string chars);
+
+    const std::string chars;
+};
+
+class ObjFunction : public Obj {
+public:
+    ObjFunction();
+
+    int arity = 0;
+    int upvalueCount = 0;
+    Chunk chunk;
+    ObjString *name = nullptr;
+};
+
+using NativeFn = Value (*)(int argCount, Value *args);
+
+class ObjNative : public Obj {
+public:
+    ObjNative(NativeFn function, int arity);
+
+    NativeFn function = nullptr;
+    int arity = 0;
+};
+
+class ObjUpvalue : public Obj {
+public:
+    explicit ObjUpvalue(Value *slot);
+
+    // Points into the stack while the variable is live, and to `closed` once it is hoisted
+    Value *location = nullptr;
+    Value closed;
+    ObjUpvalue *nextOpen = nullptr;
+};
+
+class ObjClosure : public Obj {
+public:
+    explicit ObjClosure(ObjFunction *function);
+
+    ObjFunction *function = nullptr;
+    std::vector<ObjUpvalue *> upvalues;
+};
+
+class ObjShape;
+
+class ObjClass : public Obj {
+public:
+    explicit ObjClass(ObjString *name);
+
+    ObjString *name = nullptr;
+    std::unordered_map<ObjString *, ObjClosure *> methods;
+    // Shape of a freshly created instance, the root of this class's transition tree
+    ObjShape *shape = nullptr;
+};
+
+// Hidden class: the layout shared by every instance that gained the same fields in the same order.
+// Adding a field moves an instance along a transition to a child shape, so instances built alike
+// end up sharing one shape and property caches can key on it
+class ObjShape : public Obj {
+public:
+    explicit ObjShape(ObjClass *klass);
+    ObjShape(ObjShape *parent, ObjString *name);
+
+    ObjClass *klass = nullptr;
+    ObjShape *parent = nullptr;
+    std::unordered_map<ObjString *, std::uint32_t> slots;
+    std::unordered_map<ObjString *, ObjShape *> transitions;
+};
+
+class ObjInstance : public Obj {
+public:
+    explicit ObjInstance(ObjClass *klass);
+
+    ObjClass *klass = nullptr;
+    ObjShape *shape = nullptr;
+    // Indexed by the slots of `shape`
+    std::vector<Value> fields;
+};
+
+class ObjBoundMethod : public Obj {
+public:
+    ObjBoundMethod(Value receiver, ObjClosure *method);
+
+    Value receiver;
+    ObjClosure *method = nullptr;
+};
+
+inline bool isObjType(Value value, ObjType type)
+{
+    return value.isObj() and value.asObj()->type == type;
+}
+
+template <typename T>
+inline T *as(Value value)
+{
+    return static_cast<T *>(value.asObj());
+}
+
+}  // namespace draft::vm
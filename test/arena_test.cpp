@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <arena.h>
+#include <ast.h>
+
+using namespace draft;
+
+namespace {
+
+struct Counted {
+    explicit Counted(int &live)
+        : live{live}
+    {
+        live++;
+    }
+    ~Counted()
+    {
+        live--;
+    }
+
+    int &live;
+};
+
+}  // namespace
+
+TEST(ArenaTest, LargeObjectsGetTheirOwnBlocks)
+{
+    memory::Arena arena;
+    auto *small = arena.make<std::array<char, 16>>();
+    auto *large = arena.make<std::array<char, 64 * 1024>>();
+    auto *next = arena.make<std::array<char, 16>>();
+    ASSERT_NE(nullptr, large);
+    EXPECT_EQ(1, arena.stats().largeObjects);
+    EXPECT_EQ(2, arena.stats().blocks);
+    // The small allocations keep sharing the first block
+    EXPECT_EQ(small->data() + 16, next->data());
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(arena.allocate(24, 64)) % 64);
+}
+
+TEST(ArenaTest, BlocksGrowGeometrically)
+{
+    memory::Arena arena;
+    for (int i = 0; i < 1000; i++) {
+        arena.make<std::array<char, 1000>>();
+    }
+    EXPECT_GE(arena.stats().bytesAllocated, 1000 * 1000);
+    EXPECT_LT(arena.stats().blocks, 10);
+    EXPECT_EQ(0, arena.stats().largeObjects);
+}
+
+TEST(ArenaTest, DestructorsRunOnResetAndDestruction)
+{
+    int live = 0;
+    {
+        memory::Arena arena;
+        for (int i = 0; i < 3; i++) {
+            arena.make<Counted>(live);
+        }
+        EXPECT_EQ(100u, arena.make<std::string>(100, 'x')->size());
+        EXPECT_EQ(3, live);
+        EXPECT_EQ(4, arena.stats().destructors);
+
+        arena.reset();
+        EXPECT_EQ(0, live);
+        EXPECT_EQ(1, arena.stats().blocks);
+        EXPECT_EQ(0, arena.stats().bytesAllocated);
+
+        arena.make<Counted>(live);
+        EXPECT_EQ(1, live);
+    }
+    EXPECT_EQ(0, live);
+}
+
+TEST(ArenaTest, PmrContainersAllocateFromTheArena)
+{
+    memory::Arena arena;
+    AstList<int> list{&arena};
+    for (int i = 0; i < 1000; i++) {
+        list.push_back(i);
+    }
+    EXPECT_GE(arena.stats().bytesAllocated, 1000 * sizeof(int));
+    EXPECT_EQ(&arena, list.get_allocator().resource());
+}
+
+TEST(ArenaTest, RewindTakesBackWhatCameAfterTheMark)
+{
+    int live = 0;
+    memory::Arena arena;
+    arena.make<Counted>(live);
+    memory::Arena::Mark mark = arena.mark();
+    std::size_t bytes = arena.stats().bytesAllocated;
+
+    for (int i = 0; i < 1000; i++) {
+        arena.make<Counted>(live);
+    }
+    arena.make<std::array<std::byte, 64 * 1024>>();
+    EXPECT_EQ(1001, live);
+    EXPECT_EQ(1, arena.stats().largeObjects);
+
+    arena.rewind(mark);
+    EXPECT_EQ(1, live);
+    EXPECT_EQ(1, arena.stats().blocks);
+    EXPECT_EQ(0, arena.stats().largeObjects);
+    EXPECT_EQ(1, arena.stats().destructors);
+    EXPECT_EQ(bytes, arena.stats().bytesAllocated);
+
+    // The memory after the mark is handed out again
+    EXPECT_EQ(mark.ptr, reinterpret_cast<std::byte *>(arena.make<Counted>(live)));
+}
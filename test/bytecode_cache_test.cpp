@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <bytecode_cache.h>
+#include <compiler.h>
+#include <lexer.h>
+#include <parser.h>
+#include <resolver.h>
+#include <vm.h>
+
+using namespace draft;
+
+namespace {
+
+constexpr auto program = R"(
+fun makeCounter() { var i = 0; fun count() { i = i + 1; return i; } return count; }
+class Pair { init(a, b) { this.a = a; this.b = b; } sum() { return this.a + this.b; } }
+var counter = makeCounter(); counter();
+print counter(); print Pair(1.5, 2).sum(); print "text" + "!"; print nil == false;
+)";
+
+vm::ObjFunction *compile(vm::VM &machine, const std::string &code)
+{
+    Lexer lexer{code};
+    Parser parser{lexer};
+    std::vector<Stmt *> statements = parser.parse();
+    Resolver resolver;
+    resolver.resolve(statements);
+    vm::Compiler compiler{machine.heap()};
+    return compiler.compile(statements);
+}
+
+std::string interpret(vm::VM &machine, vm::ObjFunction *script)
+{
+    testing::internal::CaptureStdout();
+    machine.interpret(script);
+    return testing::internal::GetCapturedStdout();
+}
+
+class BytecodeCacheTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "draft_bytecode_cache_test";
+};
+
+}  // namespace
+
+TEST_F(BytecodeCacheTest, LoadedScriptRunsLikeTheCompiledOne)
+{
+    vm::BytecodeCache cache{directory};
+    vm::VM compiled;
+    vm::ObjFunction *script = compile(compiled, program);
+    ASSERT_NE(nullptr, script);
+    cache.store(program, script);
+    std::string expected = interpret(compiled, script);
+
+    vm::VM loaded;
+    loaded.heap().tune(vm::Heap::Tuning{0, 2.0, true});
+    vm::ObjFunction *cached = cache.load(program, loaded.heap());
+    ASSERT_NE(nullptr, cached);
+    EXPECT_EQ(expected, interpret(loaded, cached));
+    EXPECT_EQ(nullptr, cache.load(std::string{program} + " ", loaded.heap()));
+}
+
+TEST_F(BytecodeCacheTest, TruncatedEntriesAreIgnored)
+{
+    vm::BytecodeCache cache{directory};
+    vm::VM machine;
+    cache.store(program, compile(machine, program));
+
+    ASSERT_EQ(1, std::distance(std::filesystem::directory_iterator{directory}, {}));
+    std::filesystem::path entry = std::filesystem::directory_iterator{directory}->path();
+    std::filesystem::resize_file(entry, std::filesystem::file_size(entry) - 3);
+    EXPECT_EQ(nullptr, cache.load(program, machine.heap()));
+}
+
+TEST_F(BytecodeCacheTest, EntriesOfAnotherSourceAreIgnored)
+{
+    // Made to look like a collision: the entry of one source renamed and rekeyed as another's
+    constexpr std::string_view first = "print \"first\";";
+    constexpr std::string_view second = "print \"other\";";
+    vm::BytecodeCache cache{directory};
+    vm::VM machine;
+    cache.store(first, compile(machine, std::string{first}));
+    std::filesystem::path entry = std::filesystem::directory_iterator{directory}->path();
+
+    std::string bytes;
+    {
+        std::ifstream file{entry, std::ios::binary};
+        bytes.assign(std::istreambuf_iterator<char>{file}, {});
+    }
+    std::uint64_t key = vm::BytecodeCache::hash(second);
+    std::memcpy(bytes.data() + 12, &key, sizeof(key));
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.dbc", static_cast<unsigned long long>(key));
+    std::ofstream{directory / name, std::ios::binary} << bytes;
+    EXPECT_EQ(nullptr, cache.load(second, machine.heap()));
+    EXPECT_NE(nullptr, cache.load(first, machine.heap()));
+}
+
+TEST_F(BytecodeCacheTest, OperandsOutOfRangeAreRefused)
+{
+    constexpr std::string_view source = "print 1;";
+    vm::BytecodeCache cache{directory};
+    vm::VM machine;
+    cache.store(source, compile(machine, std::string{source}));
+    std::filesystem::path entry = std::filesystem::directory_iterator{directory}->path();
+    std::string bytes;
+    {
+        std::ifstream file{entry, std::ios::binary};
+        bytes.assign(std::istreambuf_iterator<char>{file}, {});
+    }
+
+    // The script's code starts with the constant 1, index 0, which is made to point past the table
+    const std::string load{static_cast<char>(vm::OpCode::Constant), '\0', '\0', static_cast<char>(vm::OpCode::Print)};
+    std::size_t at = bytes.find(load);
+    ASSERT_NE(std::string::npos, at);
+    bytes[at + 2] = 7;
+    std::ofstream{entry, std::ios::binary | std::ios::trunc} << bytes;
+    EXPECT_EQ(nullptr, cache.load(source, machine.heap()));
+}
+
+TEST_F(BytecodeCacheTest, CodeThatMisusesTheStackIsRefused)
+{
+    constexpr std::string_view source = "print 1;";
+    vm::BytecodeCache cache{directory};
+    vm::VM machine;
+    cache.store(source, compile(machine, std::string{source}));
+    std::filesystem::path entry = std::filesystem::directory_iterator{directory}->path();
+    std::string bytes;
+    {
+        std::ifstream file{entry, std::ios::binary};
+        bytes.assign(std::istreambuf_iterator<char>{file}, {});
+    }
+    auto op = [](vm::OpCode code) { return static_cast<char>(code); };
+    const std::string script{op(vm::OpCode::Constant), '\0', '\0', op(vm::OpCode::Print), op(vm::OpCode::Nil),
+                             op(vm::OpCode::Return)};
+    std::size_t at = bytes.find(script);
+    ASSERT_NE(std::string::npos, at);
+
+    // Each is as long as the script's code and passes every check but that of the stack's depth
+    const std::string underflow{op(vm::OpCode::Pop), op(vm::OpCode::Pop), op(vm::OpCode::Pop),
+                                op(vm::OpCode::Pop), op(vm::OpCode::Nil), op(vm::OpCode::Return)};
+    const std::string localPastTop{op(vm::OpCode::GetLocal), '\5', op(vm::OpCode::Print), op(vm::OpCode::Nil),
+                                   op(vm::OpCode::Nil), op(vm::OpCode::Return)};
+    const std::string argumentsPastTop{op(vm::OpCode::Nil), op(vm::OpCode::Call), '\3', op(vm::OpCode::Pop),
+                                       op(vm::OpCode::Nil), op(vm::OpCode::Return)};
+    const std::string fallsOffTheEnd{op(vm::OpCode::Nil), op(vm::OpCode::Pop), op(vm::OpCode::Nil),
+                                     op(vm::OpCode::Pop), op(vm::OpCode::Nil), op(vm::OpCode::Pop)};
+    for (const std::string &code : {underflow, localPastTop, argumentsPastTop, fallsOffTheEnd}) {
+        std::string patched = bytes;
+        patched.replace(at, code.size(), code);
+        std::ofstream{entry, std::ios::binary | std::ios::trunc} << patched;
+        EXPECT_EQ(nullptr, cache.load(source, machine.heap()));
+    }
+    std::ofstream{entry, std::ios::binary | std::ios::trunc} << bytes;
+    EXPECT_NE(nullptr, cache.load(source, machine.heap()));
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 
 #include <driver.h>
@@ -14,3 +16,74 @@ TEST(DriverTest, Smoke)
 
     ASSERT_EQ("Hello, world!\n", ss.str());
 }
+
+TEST(DriverTest, RunsSeveralFilesAsOneProgram)
+{
+    auto directory = std::filesystem::temp_directory_path() / "draft_driver_test";
+    std::filesystem::create_directories(directory);
+    std::vector<std::string> paths;
+    for (int i = 0; i < 8; i++) {
+        paths.push_back((directory / ("module" + std::to_string(i) + ".lox")).string());
+        std::ofstream{paths.back()} << "fun f" << i << "() { return " << i << "; }\n";
+    }
+    paths.push_back((directory / "main.lox").string());
+    std::ofstream{paths.back()} << "var total = 0;\n"
+                                << "total = total + f0() + f1() + f2() + f3() + f4() + f5() + f6() + f7();\n"
+                                << "print total;\n";
+
+    Driver::Options options;
+    options.jobs = 4;
+    Driver::configure(options);
+    testing::internal::CaptureStdout();
+    int status = Driver::runFiles(paths);
+    std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(exit::success, status);
+    EXPECT_TRUE(output.ends_with("28.000000\n"));
+
+    // An error is reported in the file it is in, and nothing runs
+    std::ofstream{paths[3]} << "fun f3() { return 3 }\n";
+    testing::internal::CaptureStderr();
+    testing::internal::CaptureStdout();
+    status = Driver::runFiles(paths);
+    testing::internal::GetCapturedStdout();
+    std::string errors = testing::internal::GetCapturedStderr();
+    Driver::configure(Driver::Options{});
+    EXPECT_EQ(exit::dataerr, status);
+    EXPECT_NE(std::string::npos, errors.find("in " + paths[3] + "]"));
+    std::filesystem::remove_all(directory);
+}
+
+TEST(DriverTest, PromptKeepsWhatEarlierLinesDeclared)
+{
+    // The folded constant is a node of the optimizer, called for after its line has run
+    std::istringstream input{"fun scale(x) { return x * (2 + 3); }\n"
+                             "class Point { init(x) { this.x = scale(x); } }\n"
+                             "fun broken( {\n"
+                             "print missing;\n"
+                             "var p = Point(4);\n"
+                             "print p.x + scale(1);\n"};
+    testing::internal::CaptureStderr();
+    testing::internal::CaptureStdout();
+    int status = Driver::runPrompt(input);
+    std::string output = testing::internal::GetCapturedStdout();
+    std::string errors = testing::internal::GetCapturedStderr();
+    EXPECT_EQ(exit::success, status);
+    EXPECT_NE(std::string::npos, output.find("25.000000\n"));
+    EXPECT_NE(std::string::npos, errors.find("parameter name"));
+    EXPECT_NE(std::string::npos, errors.find("Undefined variable 'missing'"));
+
+    // The VM also goes on after a runtime error, with the globals of the lines before it
+    std::istringstream lines{"var a = 1;\nprint nil + 1;\nprint a + 1;\n"};
+    Driver::Options options;
+    options.engine = Driver::Engine::VM;
+    Driver::configure(options);
+    testing::internal::CaptureStderr();
+    testing::internal::CaptureStdout();
+    status = Driver::runPrompt(lines);
+    output = testing::internal::GetCapturedStdout();
+    errors = testing::internal::GetCapturedStderr();
+    Driver::configure(Driver::Options{});
+    EXPECT_EQ(exit::success, status);
+    EXPECT_NE(std::string::npos, output.find("2.000000\n"));
+    EXPECT_NE(std::string::npos, errors.find("Operands must be two numbers or two strings"));
+}
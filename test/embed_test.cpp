@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include <embed.h>
+
+using namespace draft;
+using namespace draft::object;
+
+TEST(EmbedTest, RunsOnceAndCallsMany)
+{
+    std::ostringstream output;
+    embed::Context context{output};
+    embed::ProgramPtr rules = embed::Program::compile(R"(
+var calls = 0;
+fun price(base, member, code) {
+    calls = calls + 1;
+    if (member) return base * 0.5;
+    if (code == "half") return base / 2;
+    return base;
+}
+print "loaded";
+)");
+    ASSERT_TRUE(rules->ok());
+    ASSERT_TRUE(context.run(rules).ok());
+    EXPECT_EQ("loaded\n", output.str());
+
+    EXPECT_EQ(Object{Number{50}}, context.call("price", 100, true, "").value);
+    EXPECT_EQ(Object{Number{42}}, context.call("price", 42.0, false, std::string{"none"}).value);
+    CallablePtr price = context.function("price");
+    ASSERT_NE(nullptr, price);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(Object{Number{5}}, context.call(price, 10, nullptr, "half").value);
+    }
+    EXPECT_EQ(Object{Number{102}}, *context.global("calls"));
+}
+
+TEST(EmbedTest, ErrorsAreValues)
+{
+    embed::ProgramPtr broken = embed::Program::compile("var = 1;\nreturn 2;");
+    EXPECT_FALSE(broken->ok());
+    ASSERT_EQ(1u, broken->errors().size());
+    EXPECT_EQ(1u, broken->errors()[0].line);
+
+    std::ostringstream output;
+    embed::Context context{output};
+    EXPECT_FALSE(context.run(broken).ok());
+    embed::ProgramPtr failing = embed::Program::compile("fun f(x) {\n  return x + nil;\n}\nprint \"before\";\nf(1);\n");
+    ASSERT_TRUE(failing->ok());
+    embed::Result result = context.run(failing);
+    ASSERT_EQ(1u, result.errors.size());
+    EXPECT_EQ(2u, result.errors[0].line);
+    EXPECT_EQ("before\n", output.str());
+
+    // The context goes on after an error, with what was defined before it
+    EXPECT_EQ("Expected 1 arguments but got 2", context.call("f", 1, 2).errors.at(0).message);
+    EXPECT_FALSE(context.call("missing").ok());
+    EXPECT_FALSE(context.call("f", 1).ok());
+    EXPECT_TRUE(context.run(embed::Program::compile("fun g(x) { return f; }")).ok());
+    EXPECT_FALSE(context.call("g", "x").value == Object{Null{}});
+}
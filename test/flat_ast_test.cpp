@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <ast_printer.h>
+#include <flat_ast.h>
+#include <interpreter.h>
+#include <lexer.h>
+#include <parser.h>
+#include <resolver.h>
+
+using namespace draft;
+
+namespace {
+
+std::string print(std::span<Stmt *const> statements)
+{
+    AstPrinter printer;
+    std::string printed;
+    for (Stmt *stmt : statements) {
+        printed += printer.print(stmt) + "\n";
+    }
+    return printed;
+}
+
+std::string interpret(std::span<Stmt *const> statements)
+{
+    Interpreter interpreter;
+    testing::internal::CaptureStdout();
+    interpreter.interpret(statements);
+    return testing::internal::GetCapturedStdout();
+}
+
+constexpr auto program = R"(
+class A { init(n) { this.n = n; } get() { return this.n; } }
+class B < A { get() { return super.get() * 2; } }
+fun count(limit) {
+    var total = 0;
+    for (var i = 0; i < limit; i = i + 1) { if (i == 2) total = total + 10; else total = total + i; }
+    return total;
+}
+var greeting = "hi" + " " + "there";
+print greeting;
+print B(21).get();
+print count(5) or nil;
+print !(1 < 2) and -3 >= -4;
+)";
+
+}  // namespace
+
+TEST(FlatAstTest, RoundTripsThroughTheAdapter)
+{
+    Lexer lexer{program};
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser{tokens};
+    std::vector<Stmt *> statements = parser.parse();
+    Resolver{}.resolve(statements);
+
+    FlatAst ast = FlatAst::flatten(statements);
+    EXPECT_EQ(statements.size(), ast.statements().size());
+    EXPECT_EQ(FlatAst::Kind::Class, ast.node(ast.statements()[0]).kind);
+    EXPECT_EQ("A", ast.token(ast.node(ast.statements()[0]).token).lexeme);
+
+    memory::Arena arena;
+    std::vector<Stmt *> expanded = ast.expand(arena);
+    EXPECT_EQ(print(statements), print(expanded));
+    EXPECT_EQ("hi there\n42.000000\n18.000000\nfalse\n", interpret(expanded));
+    EXPECT_EQ(interpret(statements), interpret(expanded));
+}
+
+TEST(FlatAstTest, ListsAreLengthPrefixed)
+{
+    Lexer lexer{"fun f(a, b, c) { print a; print b; }"};
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser{tokens};
+    std::vector<Stmt *> statements = parser.parse();
+
+    FlatAst ast = FlatAst::flatten(statements);
+    const FlatAst::Node &function = ast.node(ast.statements()[0]);
+    ASSERT_EQ(FlatAst::Kind::FuncStmt, function.kind);
+    std::span<const FlatAst::Index> params = ast.list(function.lhs);
+    ASSERT_EQ(3u, params.size());
+    EXPECT_EQ("c", ast.token(params[2]).lexeme);
+    std::span<const FlatAst::Index> body = ast.list(function.lhs + 1 + 3);
+    ASSERT_EQ(2u, body.size());
+    EXPECT_EQ(FlatAst::Kind::Print, ast.node(body[1]).kind);
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include <compiler.h>
+#include <lexer.h>
+#include <parser.h>
+#include <resolver.h>
+#include <vm.h>
+
+using namespace draft;
+
+namespace {
+
+std::string runOnVm(vm::VM &machine, const std::string &code)
+{
+    Lexer lexer{code};
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser{tokens};
+    std::vector<Stmt *> statements = parser.parse();
+    Resolver resolver;
+    resolver.resolve(statements);
+
+    vm::Compiler compiler{machine.heap()};
+    vm::ObjFunction *script = compiler.compile(statements);
+    testing::internal::CaptureStdout();
+    machine.interpret(script);
+    return testing::internal::GetCapturedStdout();
+}
+
+}  // namespace
+
+TEST(GcTest, StressKeepsReachableObjects)
+{
+    vm::VM machine;
+    machine.heap().tune(vm::Heap::Tuning{0, 2.0, true});
+
+    std::string output = runOnVm(machine, R"(
+fun makeCounter() { var i = 0; fun count() { i = i + 1; return i; } return count; }
+class Node { init(value, next) { this.value = value; this.next = next; } sum() {
+  if (this.next == nil) return this.value; return this.value + this.next.sum(); } }
+var list = nil;
+for (var i = 1; i <= 10; i = i + 1) list = Node(i, list);
+var counter = makeCounter(); counter();
+var s = ""; for (var i = 0; i < 3; i = i + 1) s = s + "ab";
+print list.sum(); print counter(); print s;
+)");
+    EXPECT_EQ("55.000000\n2.000000\nababab\n", output);
+    EXPECT_GT(machine.heap().stats().collections, 0u);
+}
+
+TEST(GcTest, StressKeepsShapesAlive)
+{
+    vm::VM machine;
+    machine.heap().tune(vm::Heap::Tuning{0, 2.0, true});
+
+    std::string output = runOnVm(machine, R"(
+fun make() { class Local { init(n) { this.n = n; } } return Local; }
+var total = 0;
+for (var i = 0; i < 5; i = i + 1) { var o = make()(i); o.m = i; total = total + o.n + o.m; }
+print total;
+)");
+    EXPECT_EQ("20.000000\n", output);
+}
+
+TEST(GcTest, GarbageIsReclaimed)
+{
+    vm::VM machine;
+    machine.heap().tune(vm::Heap::Tuning{16 * 1024, 2.0, false});
+
+    runOnVm(machine, R"(
+class Point { init(x) { this.x = x; } }
+for (var i = 0; i < 10000; i = i + 1) { var p = Point(i); }
+)");
+    const vm::Heap::Stats &stats = machine.heap().stats();
+    EXPECT_GT(stats.collections, 0u);
+    EXPECT_GT(stats.objectsFreed, 9000u);
+    EXPECT_EQ(stats.bytesAllocated - stats.bytesFreed, machine.heap().size());
+}
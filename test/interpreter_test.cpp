@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+
+#include <driver.h>
+
+using namespace draft;
+
+namespace {
+
+// Output of the tree-walker, which follows the AST listing
+std::string run(const std::string &code, std::size_t maxDepth = Interpreter::DefaultMaxDepth)
+{
+    Driver::Options options;
+    options.maxCallDepth = maxDepth;
+    Driver::configure(options);
+    testing::internal::CaptureStdout();
+    Driver::run(code);
+    std::string output = testing::internal::GetCapturedStdout();
+    Driver::configure(Driver::Options{});
+    return output.substr(output.rfind("}\n") + 2);
+}
+
+}  // namespace
+
+TEST(InterpreterTest, TailCallsRunInConstantSpace)
+{
+    EXPECT_EQ("done\n", run(R"(
+fun loop(n) { if (n == 0) return "done"; return loop(n - 1); }
+print loop(100000);
+)", 100));
+    EXPECT_EQ("true\nfalse\n", run(R"(
+fun even(n) { if (n == 0) return true; return odd(n - 1); }
+fun odd(n) { if (n == 0) return false; return even(n - 1); }
+print even(50000); print odd(50000);
+)", 100));
+}
+
+TEST(InterpreterTest, TailCallsToMethodsAndNatives)
+{
+    EXPECT_EQ("3.000000\nok\ntrue\n", run(R"(
+class Counter {
+    init() { this.count = 0; }
+    up(n) { if (n == 0) return this.count; this.count = this.count + 1; return this.up(n - 1); }
+}
+print Counter().up(3);
+class Box { init(v) { this.v = v; } }
+fun make(v) { return Box(v); }
+print make("ok").v;
+fun now() { return clock(); }
+print now() > 0;
+)", 100));
+    // A function held in a field takes no receiver, in tail position or not
+    EXPECT_EQ("42.000000\n42.000000\n", run(R"(
+class A {}
+var a = A();
+fun g(x) { return x; }
+a.f = g;
+fun h() { return a.f(42); }
+print h();
+print a.f(42);
+)"));
+}
+
+TEST(InterpreterTest, NonTailRecursionHasLimitedDepth)
+{
+    constexpr auto code = "fun f(n) { if (n == 0) return 0; return 1 + f(n - 1); } print f(5000);";
+    EXPECT_EXIT(run(code), testing::ExitedWithCode(exit::software), "Stack overflow");
+    // Deeper limits get a native stack to match
+    EXPECT_EQ("5000.000000\n", run(code, 10000));
+    // And a value stack to match, past the slots every interpreter reserves
+    EXPECT_EQ("100000.000000\n", run("fun f(n) { if (n == 0) return 0; return 1 + f(n - 1); } print f(100000);", 200000));
+}
+
+TEST(InterpreterTest, FusedLoopsKeepTheirMeaning)
+{
+    // Each iteration of a body with declarations still gets a fresh environment once it's captured
+    EXPECT_EQ("1.000000\n3.000000\n", run(R"(
+fun f() {
+    var kept = nil;
+    for (var i = 0; i < 3; i = i + 1) {
+        var j = i;
+        fun g() { return j; }
+        if (i == 1) kept = g;
+    }
+    print kept();
+    var n = 3;
+    var k = 0;
+    while (k != n) { { k = k + 1; } }
+    print k;
+}
+f();
+)"));
+    // Operands that aren't numbers take the generic paths, errors included
+    EXPECT_EQ("ab\n", run(R"(
+fun f() { var s = "a"; var t = "b"; while (s != "ab") s = s + t; print s; }
+f();
+)"));
+    EXPECT_EXIT(run(R"(fun f() { var i = "a"; while (i < 3) i = i + 1; } f();)"),
+                testing::ExitedWithCode(exit::software), "Operands must be numbers");
+}
+
+TEST(InterpreterTest, StatsCountWhatTheProgramDoes)
+{
+    EXPECT_EQ("nil\n", run("print stats();"));
+
+    Driver::Options options;
+    options.stats = true;
+    Driver::configure(options);
+    testing::internal::CaptureStdout();
+    Driver::run(R"(
+class Point { init() { this.x = 1; } }
+fun f() { var p = Point(); var s = ""; for (var i = 0; i < 3; i = i + 1) { s = s + "x"; p.x; p.y; } }
+f();
+print stats();
+)");
+    std::string output = testing::internal::GetCapturedStdout();
+    Driver::configure(Driver::Options{});
+
+    auto counter = [&](const std::string &name) {
+        std::size_t at = output.find("\n" + name + " ");
+        return at == std::string::npos ? -1 : std::stol(output.substr(output.find_first_not_of(' ', at + name.size() + 1)));
+    };
+    // f, Point and stats
+    EXPECT_EQ(3, counter("calls"));
+    EXPECT_EQ(1, counter("instances"));
+    EXPECT_EQ(3, counter("concatenations"));
+    EXPECT_EQ(3, counter("field hits"));
+    EXPECT_EQ(3, counter("property misses"));
+    EXPECT_EQ(1, counter("nodes While"));
+    EXPECT_GT(counter("arena bytes"), 0);
+
+    // A program that fails still reports what it counted, after the error
+    Driver::configure(options);
+    EXPECT_EXIT(Driver::run("var a = 1; print nil + 1;"), testing::ExitedWithCode(exit::software),
+                "Operands must be two numbers or two strings\n(.|\n)*calls +0");
+    Driver::configure(Driver::Options{});
+}
+
+TEST(InterpreterTest, TimingNatives)
+{
+    EXPECT_EQ("true\ntrue\n", run(R"(
+var start = clock_ns();
+var cpu = cpu_time();
+for (var i = 0; i < 1000; i = i + 1) {}
+print clock_ns() >= start;
+print cpu_time() >= cpu;
+)"));
+
+    std::string output = run(R"(
+var calls = 0;
+fun work() { calls = calls + 1; }
+print bench(work, 5) >= 0;
+print calls;
+)");
+    EXPECT_EQ(0u, output.find("bench: 5 runs, mean "));
+    EXPECT_NE(std::string::npos, output.find(" ns\ntrue\n5.000000\n"));
+
+    EXPECT_EXIT(run("bench(clock, 0);"), testing::ExitedWithCode(exit::software), "iterations");
+    EXPECT_EXIT(run("fun f(a) {} bench(f, 1);"), testing::ExitedWithCode(exit::software), "no arguments");
+}
+
+TEST(InterpreterTest, ListsIndexGrowAndShrink)
+{
+    EXPECT_EQ("[1.000000, nil, b]\n3.000000\n9.000000\nb\n2.000000\n", run(R"(
+var l = [1, nil, "a"];
+l[2] = "b";
+print l;
+print len(l);
+var h = [];
+for (var i = 0; i < 3; i = i + 1) push(h, i * 2);
+print sum(map_add(h, 1));
+print pop(l);
+print len(l);
+)"));
+    EXPECT_EQ("32.000000\n", run("print dot([1, 2, 3], [4, 5, 6]);"));
+    // A list holding numbers only again, by pop or by set, is a list of numbers
+    EXPECT_EQ("3.000000\n6.000000\n", run(R"(
+var l = [1, 2];
+push(l, "a");
+pop(l);
+print sum(l);
+l[0] = nil;
+l[0] = 4;
+print sum(l);
+)"));
+
+    EXPECT_EXIT(run("var l = [1]; print l[1];"), testing::ExitedWithCode(exit::software), "List index out of range");
+    EXPECT_EXIT(run("var l = [1]; l[0.5] = 2;"), testing::ExitedWithCode(exit::software), "whole number");
+    EXPECT_EXIT(run("var s = \"ab\"; print s[0];"), testing::ExitedWithCode(exit::software), "Only lists and maps can be indexed");
+    EXPECT_EXIT(run("print sum([1, \"a\"]);"), testing::ExitedWithCode(exit::software), "list of numbers");
+    EXPECT_EXIT(run("pop([]);"), testing::ExitedWithCode(exit::software), "empty list");
+}
+
+TEST(InterpreterTest, MapsLookUpAnyKey)
+{
+    EXPECT_EQ("1.000000\nnil\n3.000000\ntrue\nfalse\n[2.000000, b]\n[[1.000000], x]\n", run(R"(
+var m = {"a": 1, "b": 2};
+print m["a"];
+print m["c"];
+m[2] = [1];
+print len(m);
+print remove(m, "a");
+print has(m, "a");
+m["b"] = "x";
+print keys(m);
+print values(m);
+)"));
+}
+
+TEST(InterpreterTest, GeneratorsAndTasks)
+{
+    EXPECT_EQ("0.000000\n1.000000\nend\nnil\ntrue\n", run(R"(
+fun count(n) { var i = 0; while (i < n) { yield i; i = i + 1; } return "end"; }
+var c = count(2);
+print c(); print c(); print c(); print c();
+print done(c);
+)"));
+    // Tasks take turns at each yield and sleep, and the program waits for those left
+    EXPECT_EQ("a\nb\na\nb\nab\nlast\n", run(R"(
+fun work(name) { var i = 0; while (i < 2) { print name; sleep(0.01); i = i + 1; } return name; }
+fun a() { return work("a"); }
+fun b() { return work("b"); }
+var ta = async(a);
+var tb = async(b);
+print await(ta) + await(tb);
+fun last() { yield; print "last"; }
+async(last());
+)"));
+    // A generator called in tail position still makes a coroutine
+    EXPECT_EQ("1.000000\n2.000000\n", run(R"(
+fun gen() { yield 1; yield 2; }
+fun f() { return gen(); }
+var co = f();
+print co(); print co();
+)"));
+}
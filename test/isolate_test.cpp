@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <builtin.h>
+#include <isolate.h>
+#include <obj_list.h>
+#include <obj_map.h>
+
+using namespace draft;
+using namespace draft::object;
+
+TEST(IsolateTest, SpawnedProgramsAnswerTheirParent)
+{
+    Isolate::Id child = Isolate::spawn("var n = receive(); send(parent(), n * n);", Isolate::Main);
+    Isolate::send(child, Number{12});
+    EXPECT_EQ(Object{Number{144}}, Isolate::receive(Isolate::Main));
+
+    // Every isolate knows the main one as a parent, and the main one has none
+    Isolate::spawn("send(parent(), parent());", Isolate::Main);
+    EXPECT_EQ(Object{Number{Isolate::Main}}, Isolate::receive(Isolate::Main));
+    EXPECT_FALSE(Isolate::parent(Isolate::Main).has_value());
+    Isolate::joinAll();
+}
+
+TEST(IsolateTest, MessagesAreCopies)
+{
+    auto list = std::make_shared<List>();
+    auto map = std::make_shared<Map>();
+    map->set(String{"list"}, list);
+    list->push(Number{1});
+    list->push(map);
+
+    Isolate::send(Isolate::Main, map);
+    list->push(Number{2});
+    Object message = Isolate::receive(Isolate::Main);
+    auto copy = std::get<MapPtr>(message);
+    EXPECT_NE(map, copy);
+    auto copied = std::get<ListPtr>(*copy->find(String{"list"}));
+    EXPECT_EQ(2u, copied->size());
+    // The cycle back to the map is copied as a cycle
+    EXPECT_EQ(Object{copy}, copied->get(1));
+
+    EXPECT_THROW(Isolate::send(Isolate::Main, CallablePtr{}), NativeError);
+    EXPECT_THROW(Isolate::send(1000, Number{1}), NativeError);
+    map->remove(String{"list"});
+    copy->remove(String{"list"});
+}
+
+TEST(IsolateTest, ReceiveGivesNilOnceNothingCanArrive)
+{
+    // Both wait for the other, so neither will ever be sent anything
+    Isolate::spawn("send(parent(), receive());", Isolate::Main);
+    EXPECT_EQ(Object{Null{}}, Isolate::receive(Isolate::Main));
+    Isolate::joinAll();
+
+    Isolate::spawn("print 1;", Isolate::Main);
+    Isolate::joinAll();
+    EXPECT_EQ(Object{Null{}}, Isolate::receive(Isolate::Main));
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <sstream>
+
+#include <driver.h>
+#include <embed.h>
+#include <jit.h>
+#include <lexer.h>
+#include <parser.h>
+#include <resolver.h>
+
+using namespace draft;
+
+namespace {
+
+// Compiles the first statement parsed, a function declaration
+const jit::Code *compile(Parser &parser, std::vector<Stmt *> &statements)
+{
+    statements = parser.parse();
+    Resolver{}.resolve(statements);
+    return jit::compiler().compile(static_cast<FuncStmt *>(statements.at(0)));
+}
+
+std::string run(const std::string &code)
+{
+    Driver::configure(Driver::Options{Driver::Engine::TreeWalker});
+    testing::internal::CaptureStdout();
+    Driver::run(code);
+    std::string output = testing::internal::GetCapturedStdout();
+    Driver::configure(Driver::Options{});
+    return output.substr(output.rfind("}\n") + 2);
+}
+
+}  // namespace
+
+TEST(JitTest, RunsLoopsAndBranches)
+{
+    constexpr auto code = R"(fun f(n, limit) {
+    var total = 0;
+    var i = 0;
+    while (i < n and !(i >= limit)) {
+        { var half = i / 2; if (half == 2 or -half < -3) total = total + half; else total = total - 1; }
+        i = i + 1;
+    }
+    if (total > 100) return true;
+    return total;
+})";
+    Lexer lexer{code};
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser{tokens};
+    std::vector<Stmt *> statements;
+    const jit::Code *compiled = compile(parser, statements);
+    ASSERT_NE(nullptr, compiled);
+
+    auto call = [compiled](double n, double limit, jit::Code::Kind &kind) {
+        std::array<double, 2> arguments{n, limit};
+        return compiled->run(arguments.data(), kind);
+    };
+    jit::Code::Kind kind = jit::Code::Kind::Nil;
+    // Halves 2, 3.5, 4 and 4.5 are added and the six others each take 1 away
+    EXPECT_EQ(8, call(10, 100, kind));
+    EXPECT_EQ(jit::Code::Kind::Number, kind);
+    EXPECT_EQ(-3, call(10, 3, kind));
+    EXPECT_EQ(1, call(1000, 1000, kind));
+    EXPECT_EQ(jit::Code::Kind::Boolean, kind);
+}
+
+TEST(JitTest, RejectsWhatItCannotCompile)
+{
+    for (std::string code : {"fun f(a) { print a; }", "fun f(a) { return g(a); }", "fun f(a) { return a + x; }",
+                             "fun f(a) { var s = \"s\"; return a; }", "fun f(a) { if (a) return 1; }",
+                             "fun f(a) { fun g() { return a; } return 1; }"}) {
+        Lexer lexer{code};
+        std::vector<Token> tokens = lexer.scanTokens();
+        Parser parser{tokens};
+        std::vector<Stmt *> statements;
+        EXPECT_EQ(nullptr, compile(parser, statements)) << code;
+    }
+}
+
+TEST(JitTest, HotFunctionsKeepTheirResults)
+{
+    // Guard failures on strings and booleans fall back to the interpreter
+    EXPECT_EQ("1999000.000000\n30.000000\nab\ntrue\n", run(R"(
+fun add(a, b) { return a + b; }
+fun sum(n) { var t = 0; var i = 0; while (i <= n) { t = t + i; i = i + 1; } return t; }
+var total = 0;
+for (var i = 0; i < 2000; i = i + 1) total = add(total, sum(1) * i);
+print total;
+print add(10, 20);
+print add("a", "b");
+fun same(a, b) { return a == b; }
+for (var i = 0; i < 2000; i = i + 1) same(i, i);
+print same(true, true);
+)"));
+}
+
+TEST(JitTest, CodeGoesWithItsTree)
+{
+    // Reset between the two, the arena makes the second function where the first one was
+    const std::array<std::pair<std::string, double>, 2> functions{
+        {{"fun f(a) { return a + 1; }", 4}, {"fun f(a) { return a * 2; }", 6}}};
+    memory::Arena arena;
+    for (const auto &[code, expected] : functions) {
+        Lexer lexer{code};
+        Parser parser{lexer, arena};
+        std::vector<Stmt *> statements;
+        const jit::Code *native = compile(parser, statements);
+        ASSERT_NE(nullptr, native);
+        double argument = 3;
+        jit::Code::Kind kind = jit::Code::Kind::Nil;
+        EXPECT_EQ(expected, native->run(&argument, kind)) << code;
+        arena.reset();
+    }
+}
+
+TEST(JitTest, LoopsAfterAnErrorCountForTheirOwnFunction)
+{
+    // `bad` is gone by the time the next program loops, which must not count for it
+    std::ostringstream output;
+    embed::Context context{output};
+    auto failing = context.run(embed::Program::compile(R"(
+fun bad() { var i = 0; while (i < 3) i = i + 1; return nil + i; }
+bad();
+)"));
+    EXPECT_FALSE(failing.ok());
+    EXPECT_TRUE(context.run(embed::Program::compile("bad = nil; var i = 0; while (i < 2000) i = i + 1; print i;")).ok());
+    EXPECT_EQ("2000.000000\n", output.str());
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <type_traits>
+
+#include <lexer.h>
+#include <scan.h>
+
+using namespace draft;
+
+TEST(LexerTest, TokensViewTheSource)
+{
+    static_assert(std::is_trivially_copyable_v<Token>);
+    static_assert(sizeof(Token) <= 24);
+
+    std::string code{"var answer = 42;\nprint 'a b';"};
+    Lexer lexer{code};
+    std::vector<Token> tokens = lexer.scanTokens();
+    ASSERT_EQ(9, tokens.size());
+
+    EXPECT_EQ(Token::Kind::Var, tokens[0].kind);
+    EXPECT_EQ("answer", tokens[1].lexeme);
+    EXPECT_EQ(code.data() + 4, tokens[1].lexeme.data());
+    EXPECT_EQ(2, tokens[6].line);
+    EXPECT_EQ(Token::Kind::EndOfFile, tokens[8].kind);
+}
+
+TEST(LexerTest, LiteralsAreDecodedOnDemand)
+{
+    std::string code{"3.25 \"quoted\" name"};
+    Lexer lexer{code};
+    std::vector<Token> tokens = lexer.scanTokens();
+    ASSERT_EQ(4, tokens.size());
+
+    EXPECT_EQ(object::Object{3.25}, tokens[0].literal());
+    EXPECT_EQ(object::Object{object::String{"quoted"}}, tokens[1].literal());
+    EXPECT_EQ(object::Object{object::Null{}}, tokens[2].literal());
+}
+
+TEST(LexerTest, RunScannersCrossChunkBoundaries)
+{
+    for (std::size_t length : {0, 1, 15, 16, 17, 31, 33, 100}) {
+        std::string blanks;
+        for (std::size_t i = 0; i < length; i++) {
+            blanks += i % 3 == 0 ? '\n' : (i % 3 == 1 ? ' ' : '\t');
+        }
+        std::uint32_t lines = 0;
+        EXPECT_EQ(length, scan::skipWhitespace(blanks + "x", 0, lines));
+        EXPECT_EQ((length + 2) / 3, lines);
+
+        std::string word(length, 'a');
+        EXPECT_EQ(length, scan::skipAlphaNumeric(word + "Z_9-", 0) - 3);
+        EXPECT_EQ(length, scan::skipDigits(std::string(length, '7') + "a", 0));
+
+        lines = 0;
+        std::string text = blanks + "\"";
+        EXPECT_EQ(length, scan::find(text, 0, '"', lines));
+        EXPECT_EQ((length + 2) / 3, lines);
+    }
+    std::uint32_t lines = 0;
+    EXPECT_EQ(5, scan::find("abcde", 0, '"', lines));
+}
+
+TEST(LexerTest, LongTokensAndComments)
+{
+    std::string name(40, 'n');
+    std::string code = "// " + std::string(50, '-') + "\nvar " + name + " = \"" + std::string(20, 's') + "\n\";\n" +
+                       "12345678901234567890.5;";
+    Lexer lexer{code};
+    std::vector<Token> tokens = lexer.scanTokens();
+    ASSERT_EQ(8, tokens.size());
+    EXPECT_EQ(name, tokens[1].lexeme);
+    EXPECT_EQ(2, tokens[1].line);
+    EXPECT_EQ(3, tokens[4].line);
+    EXPECT_EQ(Token::Kind::NumberLiteral, tokens[5].kind);
+    EXPECT_EQ("12345678901234567890.5", tokens[5].lexeme);
+    EXPECT_EQ(4, tokens[5].line);
+}
+
+TEST(LexerTest, StreamedChunksMatchWholeBuffer)
+{
+    std::string code = "var s = \"one\ntwo\nthree\";\n// comment\nfun f(a, b) { return a <= b; }\n" +
+                       std::string(70, 'x') + " = 1.5;\nprint 'tail'";
+    std::vector<Token> expected = Lexer{code}.scanTokens();
+
+    for (std::size_t chunkSize : {1, 2, 7, 16, 64, 4096}) {
+        std::istringstream stream{code};
+        SourceReader reader{stream, chunkSize};
+        Lexer lexer{reader};
+        for (const Token &token : expected) {
+            Token streamed = lexer.next();
+            EXPECT_EQ(token.kind, streamed.kind) << chunkSize;
+            EXPECT_EQ(token.lexeme, streamed.lexeme) << chunkSize;
+            EXPECT_EQ(token.line, streamed.line) << chunkSize;
+        }
+        EXPECT_EQ(Token::Kind::EndOfFile, lexer.next().kind);
+    }
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <obj_list.h>
+
+using namespace draft;
+using namespace draft::object;
+
+TEST(ListTest, NumbersStayPackedUntilAnotherTypeArrives)
+{
+    List list{std::vector<Object>{1.0, 2.0}};
+    ASSERT_TRUE(list.isNumeric());
+    list.push(3.0);
+    list.set(0, 4.0);
+    EXPECT_EQ((std::vector<Number>{4.0, 2.0, 3.0}), (std::vector<Number>{list.numbers().begin(), list.numbers().end()}));
+
+    list.set(1, String{"two"});
+    EXPECT_FALSE(list.isNumeric());
+    EXPECT_TRUE(list.numbers().empty());
+    EXPECT_EQ(Object{4.0}, list.get(0));
+    EXPECT_EQ(Object{String{"two"}}, list.get(1));
+    EXPECT_EQ(Object{3.0}, list.pop());
+    list.pop();
+    list.pop();
+    // Numbers only again, a list is packed again for the bulk operations
+    list.push(1.0);
+    EXPECT_TRUE(list.isNumeric());
+    EXPECT_EQ((std::vector<Number>{1.0}), (std::vector<Number>{list.numbers().begin(), list.numbers().end()}));
+    list.push(Null{});
+    list.set(1, 2.0);
+    EXPECT_TRUE(list.isNumeric());
+    EXPECT_EQ(2u, list.numbers().size());
+
+    EXPECT_FALSE((List{std::vector<Object>{1.0, Null{}}}.isNumeric()));
+}
+
+TEST(ListTest, KernelsCoverTheTail)
+{
+    for (std::size_t size = 0; size < 11; size++) {
+        std::vector<Number> values;
+        Number expected = 0;
+        for (std::size_t i = 0; i < size; i++) {
+            values.push_back(static_cast<Number>(i + 1));
+            expected += static_cast<Number>((i + 1) * (i + 1));
+        }
+        EXPECT_EQ(static_cast<Number>(size * (size + 1) / 2), sum(values));
+        EXPECT_EQ(expected, dot(values, values));
+
+        std::vector<Number> sums(size);
+        add(values, 0.5, sums);
+        for (std::size_t i = 0; i < size; i++) {
+            EXPECT_EQ(values[i] + 0.5, sums[i]);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <unordered_map>
+
+#include <obj_list.h>
+#include <obj_map.h>
+
+using namespace draft;
+using namespace draft::object;
+
+TEST(MapTest, MatchesAReferenceThroughGrowthAndRemoval)
+{
+    Map map;
+    std::unordered_map<int, int> reference;
+    std::mt19937 random{42};
+    for (int step = 0; step < 20000; step++) {
+        int key = static_cast<int>(random() % 2000);
+        Object boxed = static_cast<Number>(key);
+        if (random() % 3 == 0) {
+            EXPECT_EQ(reference.erase(key) == 1, map.remove(boxed));
+        } else {
+            map.set(boxed, static_cast<Number>(step));
+            reference[key] = step;
+        }
+    }
+    ASSERT_EQ(reference.size(), map.size());
+    for (int key = 0; key < 2000; key++) {
+        const Object *value = map.find(static_cast<Number>(key));
+        auto it = reference.find(key);
+        ASSERT_EQ(it != reference.end(), value != nullptr);
+        if (value) {
+            EXPECT_EQ(Object{static_cast<Number>(it->second)}, *value);
+        }
+    }
+}
+
+TEST(MapTest, KeysCompareByValueOrIdentity)
+{
+    Map map;
+    auto list = std::make_shared<List>();
+    map.set(String{"1"}, 1.0);
+    map.set(1.0, 2.0);
+    map.set(true, 3.0);
+    map.set(Null{}, 4.0);
+    map.set(list, 5.0);
+    map.set(-0.0, 6.0);
+    EXPECT_EQ(6u, map.size());
+
+    EXPECT_EQ(Object{1.0}, *map.find(String{"1"}));
+    EXPECT_EQ(Object{2.0}, *map.find(1.0));
+    EXPECT_EQ(Object{3.0}, *map.find(true));
+    EXPECT_EQ(Object{4.0}, *map.find(Null{}));
+    EXPECT_EQ(Object{5.0}, *map.find(list));
+    EXPECT_EQ(Object{6.0}, *map.find(0.0));
+    EXPECT_EQ(nullptr, map.find(std::make_shared<List>()));
+    EXPECT_EQ(nullptr, map.find(false));
+
+    // Entries keep insertion order, the last one filling the place of a removed one
+    map.remove(1.0);
+    ASSERT_EQ(5u, map.entries().size());
+    EXPECT_EQ(Object{String{"1"}}, map.entries()[0].key);
+    EXPECT_EQ(Object{-0.0}, map.entries()[1].key);
+    EXPECT_EQ(Object{true}, map.entries()[2].key);
+}
+
+TEST(MapTest, PrintsItsEntries)
+{
+    auto map = std::make_shared<Map>();
+    map->set(String{"a"}, 1.0);
+    map->set(2.0, std::make_shared<List>(std::vector<Object>{String{"x"}}));
+    map->set(String{"self"}, map);
+    EXPECT_EQ("{a: 1.000000, 2.000000: [x], self: {...}}", obj2str(map));
+    map->remove(String{"self"});
+}
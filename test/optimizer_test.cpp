@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <ast_printer.h>
+#include <driver.h>
+#include <lexer.h>
+#include <optimizer.h>
+#include <parser.h>
+#include <resolver.h>
+
+using namespace draft;
+
+namespace {
+
+std::string optimizeAndPrint(const std::string &code, int level)
+{
+    Lexer lexer{code};
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser{tokens};
+    std::vector<Stmt *> statements = parser.parse();
+    Resolver{}.resolve(statements);
+    Optimizer optimizer{level};
+    optimizer.optimize(statements);
+
+    AstPrinter printer;
+    std::string printed;
+    for (Stmt *stmt : statements) {
+        printed += printer.print(stmt) + "\n";
+    }
+    return printed;
+}
+
+// The statement printed last, after the declarations it needs
+std::string lastOf(const std::string &printed)
+{
+    return printed.substr(printed.rfind('\n', printed.size() - 2) + 1);
+}
+
+std::string runAt(int level, const std::string &code)
+{
+    Driver::configure(Driver::Options{Driver::Engine::TreeWalker, {}, level});
+    testing::internal::CaptureStdout();
+    Driver::run(code);
+    std::string output = testing::internal::GetCapturedStdout();
+    Driver::configure(Driver::Options{});
+    return output;
+}
+
+}  // namespace
+
+TEST(OptimizerTest, FoldsConstants)
+{
+    EXPECT_EQ("PrintStmt{Lit{5.000000}}\n", optimizeAndPrint("print (1 + 2) * 3 - 4;", 1));
+    EXPECT_EQ("PrintStmt{Lit{ab}}\n", optimizeAndPrint(R"(print "a" + "b";)", 1));
+    EXPECT_EQ("PrintStmt{Lit{true}}\n", optimizeAndPrint("print !nil == (2 >= 1);", 1));
+    EXPECT_EQ("PrintStmt{Var{x}}\n", lastOf(optimizeAndPrint("var x; print false or x;", 1)));
+    // Left for the run-time error
+    EXPECT_EQ("PrintStmt{BinOp{'-', Lit{s}, Lit{1.000000}}}\n", optimizeAndPrint(R"(print "s" - 1;)", 1));
+    EXPECT_EQ("PrintStmt{{BinOp{'+', Lit{1.000000}, Lit{2.000000}}}}\n",
+              optimizeAndPrint("print (1 + 2);", 0));
+}
+
+TEST(OptimizerTest, RemovesDeadBranches)
+{
+    EXPECT_EQ("PrintStmt{Lit{2.000000}}\n", optimizeAndPrint("if (1 > 2) print 1; else print 2;", 1));
+    EXPECT_EQ("", optimizeAndPrint("if (nil) print 1; while (false) print 2; 3;", 1));
+    EXPECT_EQ(optimizeAndPrint("fun f() { return 1; }", 1),
+              optimizeAndPrint("fun f() { return 1; print 2; }", 1));
+
+    // Methods go through the same rewrites as functions, though the listing doesn't show them
+    Lexer lexer{"class A { m() { return 1; print 2; } }"};
+    Parser parser{lexer};
+    std::vector<Stmt *> statements = parser.parse();
+    Resolver{}.resolve(statements);
+    Optimizer optimizer{1};
+    optimizer.optimize(statements);
+    auto klass = dynamic_cast<Class *>(statements.at(0));
+    ASSERT_NE(nullptr, klass);
+    EXPECT_EQ(1, klass->methods.at(0)->body.size());
+}
+
+TEST(OptimizerTest, ReducesStrength)
+{
+    EXPECT_EQ("PrintStmt{BinOp{'*', Var{x}, Lit{0.250000}}}\n",
+              lastOf(optimizeAndPrint("var x = 1; print x / 4;", 2)));
+    EXPECT_EQ("PrintStmt{BinOp{'/', Var{x}, Lit{3.000000}}}\n",
+              lastOf(optimizeAndPrint("var x = 1; print x / 3;", 2)));
+    EXPECT_EQ("PrintStmt{BinOp{'-', Var{x}, Var{x}}}\n",
+              lastOf(optimizeAndPrint("var x = 1; print (x - x) * 1;", 2)));
+    // x may be a string, for which x * 1 is an error
+    EXPECT_EQ("PrintStmt{BinOp{'*', Var{x}, Lit{1.000000}}}\n",
+              lastOf(optimizeAndPrint("var x = 1; print x * 1;", 2)));
+}
+
+TEST(OptimizerTest, KeepsBehaviourAtEveryLevel)
+{
+    constexpr auto code = R"(
+fun fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); print "unreachable"; }
+var total = 0;
+for (var i = 0; i < 10; i = i + 1) { if (true and i > 4) total = total + fib(i) / 2; }
+print total * 1;
+print -(-total);
+print !!(total > 3);
+print "a" + "b" == "ab";
+if (false) { var hidden = 1; print hidden; }
+{ var a = 1; var b = 2; print a + b * (3 - 1); }
+)";
+    std::string reference = runAt(0, code);
+    EXPECT_EQ(reference, runAt(1, code));
+    EXPECT_EQ(reference, runAt(2, code));
+}
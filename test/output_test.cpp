@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <sstream>
+
+#include <output.h>
+
+using namespace draft;
+
+TEST(OutputTest, WritesOnceTheBufferFills)
+{
+    std::ostringstream stream;
+    Output output{stream, 8};
+    output.write("abc");
+    output.endLine();
+    EXPECT_EQ("", stream.str());
+    output.write("defgh");
+    EXPECT_EQ("abc\n", stream.str());
+    output.write("longer than the buffer");
+    EXPECT_EQ("abc\ndefghlonger than the buffer", stream.str());
+    output.endLine();
+    output.flush();
+    EXPECT_EQ("abc\ndefghlonger than the buffer\n", stream.str());
+}
+
+TEST(OutputTest, UnbufferedWritesEveryLine)
+{
+    std::ostringstream stream;
+    Output output{stream, 0};
+    output.write("a");
+    output.endLine();
+    EXPECT_EQ("a\n", stream.str());
+}
+
+TEST(OutputTest, NumbersPrintLikeToString)
+{
+    for (double number : {0.0, -0.0, 1.0, -2.5, 0.1, 1.0 / 3, 1e-7, 123456789.125, 1e300, -1.7976931348623157e308,
+                          double{INFINITY}, -double{INFINITY}}) {
+        std::ostringstream stream;
+        {
+            Output output{stream};
+            output.writeNumber(number);
+        }
+        EXPECT_EQ(std::to_string(number), stream.str());
+    }
+}
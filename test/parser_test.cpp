@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <ast_printer.h>
+#include <lexer.h>
+#include <parser.h>
+
+using namespace draft;
+
+namespace {
+
+std::string parseAndPrint(const std::string &code)
+{
+    Lexer lexer{code};
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser{tokens};
+    AstPrinter printer;
+    std::string printed;
+    for (Stmt *stmt : parser.parse()) {
+        printed += printer.print(stmt) + "\n";
+    }
+    return printed;
+}
+
+}  // namespace
+
+TEST(ParserTest, PrecedenceAndAssociativity)
+{
+    EXPECT_EQ("PrintStmt{BinOp{'-', BinOp{'-', Lit{1.000000}, BinOp{'*', Lit{2.000000}, Lit{3.000000}}}, "
+              "Lit{4.000000}}}\n",
+              parseAndPrint("print 1 - 2 * 3 - 4;"));
+    EXPECT_EQ("PrintStmt{Logic{or, Logic{and, BinOp{'<', Lit{1.000000}, Lit{2.000000}}, "
+              "BinOp{'==', Lit{true}, UnOp{'!', Lit{nil}}}}, Lit{false}}}\n",
+              parseAndPrint("print 1 < 2 and true == !nil or false;"));
+    EXPECT_EQ("ExprStmt{Assign{a, Set{c}}}\n", parseAndPrint("a = b.c = 1 + 2;"));
+}
+
+TEST(ParserTest, ListsAndIndexing)
+{
+    EXPECT_EQ("PrintStmt{Index{Index{List{List{Lit{1.000000}}, List{}}, Lit{0.000000}}, Lit{0.000000}}}\n",
+              parseAndPrint("print [[1], []][0][0];"));
+    EXPECT_EQ("ExprStmt{SetIndex{Get{b}, BinOp{'+', Var{i}, Lit{1.000000}}, Var{c}}}\n",
+              parseAndPrint("a.b[i + 1] = c;"));
+    EXPECT_EQ("Var{m, Map{Lit{a}: Lit{1.000000}, Var{k}: List{}}}\nExprStmt{SetIndex{Var{m}, Lit{a}, Map{}}}\n",
+              parseAndPrint("var m = {\"a\": 1, k: []}; m[\"a\"] = {};"));
+}
+
+TEST(ParserTest, Yield)
+{
+    EXPECT_EQ("Function{g, , Yield{Lit{1.000000}}, Yield{}}\n", parseAndPrint("fun g() { yield 1; yield; }"));
+}
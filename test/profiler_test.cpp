@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <builtin.h>
+#include <driver.h>
+#include <profiler.h>
+
+using namespace draft;
+
+TEST(ProfilerTest, SamplesFoldIntoStacks)
+{
+    Profiler profiler{""};
+    NativeFunction clock{"clock", 0, nullptr};
+    std::vector<object::Callable *> stack{&clock};
+    profiler.sample(stack);
+    profiler.sample(stack);
+    profiler.sample({});
+    profiler.count(&clock);
+    EXPECT_EQ("<script> 1\n<script>;clock 2\n", profiler.folded());
+    EXPECT_NE(std::string::npos, profiler.table().find("clock"));
+}
+
+TEST(ProfilerTest, ProfilesTheTreeWalker)
+{
+    auto path = std::filesystem::temp_directory_path() / "draft-profiler-test.folded";
+    Driver::Options options;
+    options.profile = path.string();
+    Driver::configure(options);
+    testing::internal::CaptureStdout();
+    testing::internal::CaptureStderr();
+    Driver::run(R"(
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+print fib(20);
+)");
+    testing::internal::GetCapturedStdout();
+    std::string table = testing::internal::GetCapturedStderr();
+    Driver::configure(Driver::Options{});
+
+    // Calls are counted exactly, whatever the samples
+    std::istringstream rows{table};
+    std::string row;
+    bool counted = false;
+    while (std::getline(rows, row)) {
+        counted = counted or (row.starts_with("fib:2 ") and row.ends_with(" 21891"));
+    }
+    EXPECT_TRUE(counted) << table;
+
+    std::ifstream file{path};
+    std::string line;
+    std::size_t samples = 0;
+    while (std::getline(file, line)) {
+        EXPECT_TRUE(line.starts_with("<script>")) << line;
+        samples += std::stoul(line.substr(line.rfind(' ') + 1));
+    }
+    EXPECT_GT(samples, 0u);
+    std::filesystem::remove(path);
+}
+
+TEST(ProfilerTest, CountsTheCallsBenchMakes)
+{
+    auto path = std::filesystem::temp_directory_path() / "draft-profiler-bench-test.folded";
+    Driver::Options options;
+    options.profile = path.string();
+    Driver::configure(options);
+    testing::internal::CaptureStdout();
+    testing::internal::CaptureStderr();
+    Driver::run(R"(
+fun leaf() { return 1; }
+fun work() { return leaf(); }
+bench(work, 7);
+)");
+    testing::internal::GetCapturedStdout();
+    std::string table = testing::internal::GetCapturedStderr();
+    Driver::configure(Driver::Options{});
+    std::filesystem::remove(path);
+
+    // work() hands over to leaf() in its own frame, not in that of bench()
+    std::istringstream rows{table};
+    std::string row;
+    std::size_t counted = 0;
+    while (std::getline(rows, row)) {
+        counted += (row.starts_with("bench ") and row.ends_with(" 1")) or
+                   (row.starts_with("work:3 ") and row.ends_with(" 7")) or
+                   (row.starts_with("leaf:2 ") and row.ends_with(" 7"));
+    }
+    EXPECT_EQ(3u, counted) << table;
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <fstream>
+
 #include <source.h>
 
 using namespace draft;
@@ -48,3 +51,65 @@ print "world";
     ASSERT_EQ(2, pos2_8.line);
     ASSERT_EQ(8, pos2_8.column);
 }
+
+TEST(SourceTest, KeepsUtf8AndDecodesOnDemand)
+{
+    std::string code{"print \"Ӏx\";\nvar 𝄞 = 1;\n"};
+    Source source{code};
+    ASSERT_EQ(code, source.text());
+
+    ASSERT_EQ(U'Ӏ', source.charAt(7));
+    ASSERT_EQ(U'x', source.charAt(9));
+    ASSERT_EQ(9, source.positionAt(9).column);
+    ASSERT_EQ(U'𝄞', source.charAt(17));
+    ASSERT_EQ(U'1', source.charAt(24));
+    ASSERT_EQ(2, source.positionAt(24).line);
+    ASSERT_EQ(9, source.positionAt(24).column);
+    ASSERT_EQ("var 𝄞 = 1;\n", source.lineAt(2));
+    ASSERT_EQ(U'�', Source{"\xC0\xAF"}.charAt(0));
+}
+
+TEST(SourceTest, MapsFilesInPlace)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "draft_source_test.lox";
+    std::ofstream{path, std::ios::binary} << "print 1;\nprint 2;\n";
+
+    std::optional<Source> source = Source::map(path.string());
+    std::filesystem::remove(path);
+    ASSERT_TRUE(source.has_value());
+    ASSERT_EQ("print 1;\nprint 2;\n", source->text());
+    ASSERT_EQ(2, source->positionAt(9).line);
+    ASSERT_FALSE(Source::map(path.string()).has_value());
+}
+
+TEST(SourceTest, IndexesLinesAndValidatesAcrossBlocks)
+{
+    std::string code;
+    for (int i = 0; i < 40; i++) {
+        code += i % 5 == 0 ? "\n" : (i % 5 == 1 ? "Ӏ" : (i % 5 == 2 ? "€ abc" : "𝄞 x;"));
+    }
+    Source source{code};
+    ASSERT_EQ(code.size(), source.invalidOffset());
+
+    std::uint32_t line = 1;
+    std::size_t lineStart = 0;
+    for (std::size_t offset = 0; offset < code.size(); offset++) {
+        Source::Position pos = source.positionAt(offset);
+        ASSERT_EQ(line, pos.line) << offset;
+        if ((code[offset] & 0xC0) != 0x80) {
+            std::u32string prefix = Source::fromStdString(code.substr(lineStart, offset - lineStart));
+            ASSERT_EQ(prefix.size() + 1, pos.column) << offset;
+        }
+        if (code[offset] == '\n') {
+            line++;
+            lineStart = offset + 1;
+        }
+    }
+
+    for (std::string invalid : {"\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xE2\x82"}) {
+        std::string text = std::string(20, 'a') + invalid + "\nb\n";
+        Source broken{text};
+        ASSERT_EQ(20, broken.invalidOffset()) << invalid;
+        ASSERT_EQ("b\n", broken.lineAt(2));
+    }
+}
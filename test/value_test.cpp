@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <heap.h>
+
+using namespace draft::vm;
+
+TEST(ValueTest, Immediates)
+{
+    EXPECT_TRUE(Value::nil().isNil());
+    EXPECT_FALSE(Value::nil().isBool());
+    EXPECT_FALSE(Value::nil().isNumber());
+
+    EXPECT_TRUE(Value::boolean(true).isBool());
+    EXPECT_TRUE(Value::boolean(true).asBool());
+    EXPECT_FALSE(Value::boolean(false).asBool());
+    EXPECT_FALSE(Value::boolean(false).isNil());
+
+    EXPECT_TRUE(Value::number(-1.5).isNumber());
+    EXPECT_EQ(-1.5, Value::number(-1.5).asNumber());
+    EXPECT_FALSE(Value::number(0).isObj());
+}
+
+TEST(ValueTest, NanIsStillANumber)
+{
+    Value nan = Value::number(std::nan(""));
+    EXPECT_TRUE(nan.isNumber());
+    EXPECT_FALSE(valuesEqual(nan, nan));
+
+    Value negativeNan = Value::number(-std::nan(""));
+    EXPECT_TRUE(negativeNan.isNumber());
+    EXPECT_FALSE(negativeNan.isObj());
+}
+
+TEST(ValueTest, Objects)
+{
+    ObjString string{"draft"};
+    Value value = Value::object(&string);
+    EXPECT_TRUE(value.isObj());
+    EXPECT_FALSE(value.isNumber());
+    EXPECT_EQ(&string, value.asObj());
+    EXPECT_TRUE(isObjType(value, ObjType::String));
+    EXPECT_EQ("draft", toString(value));
+}
+
+TEST(ValueTest, StringsAreInterned)
+{
+    Heap heap;
+    ObjString *ab = heap.makeString("ab");
+    EXPECT_EQ(ab, heap.makeString("ab"));
+    EXPECT_EQ(ab, heap.concatenate(heap.makeString("a"), heap.makeString("b")));
+    EXPECT_NE(ab, heap.makeString("ba"));
+    EXPECT_TRUE(valuesEqual(Value::object(ab), Value::object(heap.makeString(std::string{"a"} + "b"))));
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <driver.h>
+
+using namespace draft;
+
+namespace {
+
+std::string runWith(Driver::Engine engine, const std::string &code)
+{
+    Driver::configure(Driver::Options{engine});
+    testing::internal::CaptureStdout();
+    Driver::run(code);
+    return testing::internal::GetCapturedStdout();
+}
+
+void expectSameOutput(const std::string &code)
+{
+    std::string reference = runWith(Driver::Engine::TreeWalker, code);
+    std::string output = runWith(Driver::Engine::VM, code);
+    Driver::configure(Driver::Options{});
+    EXPECT_EQ(reference, output);
+}
+
+}  // namespace
+
+TEST(VmTest, Arithmetic)
+{
+    expectSameOutput(R"(print 1 + 2 * 3 - 4 / 2; print -(5 - 7); print 7 >= 7; print 1 != 2;)");
+}
+
+TEST(VmTest, Strings)
+{
+    expectSameOutput(R"(var s = "a"; s = s + "b"; print s; print s == "ab"; print !nil;)");
+}
+
+TEST(VmTest, ControlFlow)
+{
+    expectSameOutput(R"(
+for (var i = 0; i < 3; i = i + 1) { if (i == 1) print "one"; else print i; }
+var n = 0; while (n < 5) n = n + 2; print n;
+print nil or "default"; print false and "never";
+)");
+}
+
+TEST(VmTest, Closures)
+{
+    expectSameOutput(R"(
+fun makeCounter() { var i = 0; fun count() { i = i + 1; return i; } return count; }
+var counter = makeCounter(); counter(); print counter();
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+print fib(15);
+)");
+}
+
+TEST(VmTest, Classes)
+{
+    expectSameOutput(R"(
+class Base { init(x) { this.x = x; } get() { return this.x; } name() { return "base"; } }
+class Derived < Base { init(x) { super.init(x * 2); } name() { return "derived " + super.name(); } }
+var d = Derived(21); print d.get(); print d.name(); print d.missing; print d;
+)");
+}
+
+TEST(VmTest, LocalScopes)
+{
+    expectSameOutput(R"(
+fun outer() {
+  var a = "a";
+  class P { hi() { return "P" + a; } }
+  class C < P { init() { this.tag = "C"; } hi() { fun inner() { return this.tag + super.hi(); } return inner(); } }
+  var b = "b";
+  print C().hi() + b;
+  { var x = 1; var y = 2; { var z = x + y; fun g() { return x + y + z; } x = 10; print g(); } }
+  return C;
+}
+print outer()().hi();
+)");
+}
+
+TEST(VmTest, Fields)
+{
+    expectSameOutput(R"(
+class P { init(x) { this.x = x; this.y = 0; } sum() { return this.x + this.y; } }
+var a = P(1); var b = P(2); a.y = 10; a.x = a.x + 1; b.z = "z";
+print a.sum(); print b.sum(); print b.z; print a.z;
+)");
+}
+
+TEST(VmTest, PolymorphicProperties)
+{
+    expectSameOutput(R"(
+class A { init() { this.v = "a"; } } class B { init() { this.w = 0; this.v = "b"; } }
+class C { v() { return "c"; } } class D { init() { this.x = 1; this.y = 2; this.v = "d"; } }
+class E < C { init() { this.v = "e"; } }
+fun show(o) { print o.v; }
+show(A()); show(B()); show(D()); show(E()); show(A()); print C().v();
+var p = A(); p.extra = 1; show(p); var q = B(); q.v = "q"; show(q);
+)");
+}
+
+TEST(VmTest, DeepInheritance)
+{
+    expectSameOutput(R"(
+class A { init(x) { this.x = x; } who() { return "a"; } base() { return "base " + this.who(); } }
+class B < A { who() { return "b"; } }
+class C < B { }
+class D < C { init(x) { super.init(x + 1); } who() { return "d " + super.who(); } }
+var d = D(1); print d.x; print d.who(); print d.base(); print C(5).x; print C(0).base();
+)");
+}
+
+TEST(VmTest, Invoke)
+{
+    expectSameOutput(R"(
+class A { init(n) { this.n = n; } add(k) { return this.n + k; } who() { return "a"; } }
+class B < A { init(n) { super.init(n * 10); } who() { return "b" + super.who(); } self() { return this; } }
+var b = B(2); print b.add(3); print b.who(); print b.self().self().n;
+var m = b.add; print m(1); print b.init(7).n;
+fun twice(x) { return x * 2; } b.f = twice; print b.f(4);
+)");
+}
+
+TEST(VmTest, EarlyReturns)
+{
+    expectSameOutput(R"(
+fun find(n) { for (var i = 0; i < 10; i = i + 1) { var j = 0; while (j < 2) { if (i == n) return i * 100; j = j + 1; } } return "none"; }
+fun noValue() { { return; } print "unreachable"; }
+class Box { init(v) { if (v == nil) return; this.v = v; } }
+print find(3); print noValue(); print Box(nil).v; print Box(4).v;
+fun count(n) { var i = 0; while (true) { i = i + 1; if (i >= n) return i; } }
+print count(5); print find(3) + count(2);
+)");
+}
+
+TEST(VmTest, CapturedEnvironmentsSurviveCalls)
+{
+    expectSameOutput(R"(
+fun keep(x) { fun get() { return x; } return get; }
+fun noise(y) { var z = y * 2; return z; }
+var a = keep("a"); noise(1); var b = keep("b"); noise(2);
+print a() + b();
+var first; var second;
+for (var i = 0; i < 2; i = i + 1) { var v = i; fun f() { return v; } if (i == 0) first = f; else second = f; }
+print first(); print second();
+)");
+}
+
+TEST(VmTest, OperandTypesChangeAfterQuickening)
+{
+    constexpr auto code = R"(
+fun add(a, b) { return a + b; }
+fun same(a, b) { return a == b; }
+fun less(a, b) { return a < b; }
+print add(1, 2); print add("a", "b"); print add(3, 4); print add("c", "d");
+print same(1, 1); print same("x", "x"); print same(nil, 1); print same(2, 3);
+for (var i = 0; i < 3; i = i + 1) print less(i, 1);
+)";
+    // The output follows the AST listing
+    EXPECT_TRUE(runWith(Driver::Engine::TreeWalker, code)
+                    .ends_with("3.000000\nab\n7.000000\ncd\ntrue\ntrue\nfalse\nfalse\ntrue\nfalse\nfalse\n"));
+    expectSameOutput(code);
+}